@@ -0,0 +1,111 @@
+# generates nets/boda_test_res: a tiny residual-style net with random (but fixed) weights, for use by tests that must
+# run on any backend (i.e. with --rtc='(be=cpu)') and without any large downloaded models. it has conv+BatchNorm+Scale
+# blocks, residual Eltwise sums, a Concat, 1x1 and 3x3 (stride 1) convs, and a chain of 1x1 convs.
+
+# also generates nets/boda_test_res_folded: the same net, but with each BatchNorm/Scale folded (here, in double
+# precision) into the conv before it. so, it is an independent reference for boda's own folding.
+
+# usage (from the boda root dir): python pysrc/gen-test-net.py
+# note: requires protoc; writes {train_val.prototxt,best.caffemodel} in nets/boda_test_res and nets/boda_test_res_folded
+
+import random, math, os, subprocess
+
+random.seed(1234)
+def rnd(n, s): return [random.gauss(0, s) for _ in range(n)]
+
+layers = [] # prototxt layer strings
+W = {} # layer name -> list of (shape, data) blobs
+
+def conv(name, bot, top, cin, cout, k, pad=0, stride=1, bias=False):
+    p = "num_output: %d kernel_size: %d pad: %d stride: %d" % (cout, k, pad, stride)
+    if not bias: p += " bias_term: false"
+    layers.append('layer { name: "%s" type: "Convolution" bottom: "%s" top: "%s" convolution_param { %s } }' % (name, bot, top, p))
+    W[name] = [((cout, cin, k, k), rnd(cout*cin*k*k, 1.0/math.sqrt(cin*k*k)))]
+    if bias: W[name].append(((cout,), rnd(cout, 0.1)))
+def bn(name, top, c):
+    layers.append('layer { name: "%s" type: "BatchNorm" bottom: "%s" top: "%s" batch_norm_param { use_global_stats: true } }' % (name, top, top))
+    sf = 2.0 # non-unit scale factor, so that it must be applied to the mean/var blobs
+    W[name] = [((c,), [random.gauss(0, 0.2)*sf for _ in range(c)]), ((c,), [random.uniform(0.5, 2.0)*sf for _ in range(c)]), ((1,), [sf])]
+def scale(name, top, c):
+    layers.append('layer { name: "%s" type: "Scale" bottom: "%s" top: "%s" scale_param { bias_term: true } }' % (name, top, top))
+    W[name] = [((c,), [random.uniform(0.5, 1.5) for _ in range(c)]), ((c,), rnd(c, 0.2))]
+def relu(name, top):
+    layers.append('layer { name: "%s" type: "ReLU" bottom: "%s" top: "%s" }' % (name, top, top))
+def pool(name, bot, top, k, s):
+    layers.append('layer { name: "%s" type: "Pooling" bottom: "%s" top: "%s" pooling_param { pool: MAX kernel_size: %d stride: %d } }' % (name, bot, top, k, s))
+def elt(name, a, b, top):
+    layers.append('layer { name: "%s" type: "Eltwise" bottom: "%s" bottom: "%s" top: "%s" eltwise_param { operation: SUM } }' % (name, a, b, top))
+def concat(name, bots, top):
+    layers.append('layer { name: "%s" type: "Concat" %s top: "%s" }' % (name, " ".join('bottom: "%s"' % b for b in bots), top))
+
+def cbs(name, bot, cin, cout, k, pad=0, do_relu=True): # conv + BatchNorm + Scale (+ ReLU)
+    conv(name, bot, name, cin, cout, k, pad)
+    bn("bn_"+name, name, cout); scale("scale_"+name, name, cout)
+    if do_relu: relu(name+"_relu", name)
+
+cbs("conv1", "data", 3, 8, 3, 1)
+pool("pool1", "conv1", "pool1", 2, 2)
+cbs("res2a_branch1", "pool1", 8, 16, 1, do_relu=False)
+cbs("res2a_branch2a", "pool1", 8, 4, 1)
+cbs("res2a_branch2b", "res2a_branch2a", 4, 4, 3, 1)
+cbs("res2a_branch2c", "res2a_branch2b", 4, 16, 1, do_relu=False)
+elt("res2a", "res2a_branch1", "res2a_branch2c", "res2a"); relu("res2a_relu", "res2a")
+cbs("res2b_branch2a", "res2a", 16, 4, 1)
+cbs("res2b_branch2b", "res2b_branch2a", 4, 4, 3, 1)
+cbs("res2b_branch2c", "res2b_branch2b", 4, 16, 1, do_relu=False)
+elt("res2b", "res2a", "res2b_branch2c", "res2b"); relu("res2b_relu", "res2b")
+conv("cat_a", "res2b", "cat_a", 16, 8, 1, bias=True); relu("cat_a_relu", "cat_a")
+conv("cat_b", "res2b", "cat_b", 16, 8, 3, 1, bias=True); relu("cat_b_relu", "cat_b")
+concat("cat", ["cat_a", "cat_b"], "cat")
+conv("k1a", "cat", "k1a", 16, 32, 1, bias=True); relu("k1a_relu", "k1a")
+conv("k1b", "k1a", "k1b", 32, 16, 1, bias=True); relu("k1b_relu", "k1b")
+conv("outc", "k1b", "outc", 16, 10, 3, 1, bias=True)
+
+def fold(layers, W):
+    out_layers = []; OW = {}
+    for l in layers:
+        name = l.split('"')[1]; typ = l.split('"')[3]
+        if typ in ("BatchNorm", "Scale"):
+            cname = l.split('top: "')[1].split('"')[0] # always in-place on the output of a conv
+            f, b = OW[cname]
+            cout = len(b[1])
+            if typ == "BatchNorm":
+                m, v, sf = [x[1] for x in W[name]]
+                isf = 1.0/sf[0]
+                a = [1.0/math.sqrt(v[k]*isf + 1e-5) for k in range(cout)]
+                c = [-m[k]*isf*a[k] for k in range(cout)]
+            else:
+                a = W[name][0][1]; c = W[name][1][1]
+            per = len(f[1])//cout
+            OW[cname] = ((f[0], [f[1][i]*a[i//per] for i in range(len(f[1]))]), (b[0], [a[k]*b[1][k] + c[k] for k in range(cout)]))
+            continue
+        if typ == "Convolution":
+            out_layers.append(l.replace(" bias_term: false", ""))
+            bl = W[name]
+            if len(bl) == 1: bl = bl + [((bl[0][0][0],), [0.0]*bl[0][0][0])]
+            OW[name] = tuple(bl)
+        else:
+            out_layers.append(l)
+    return out_layers, dict((k, list(v)) for k, v in OW.items())
+
+def write(name, layers, W):
+    out_dir = os.path.join("nets", name)
+    if not os.path.isdir(out_dir): os.makedirs(out_dir)
+    hdr = 'name: "%s"\ninput: "data"\ninput_dim: 1\ninput_dim: 3\ninput_dim: 16\ninput_dim: 16\n' % name
+    open(os.path.join(out_dir, "train_val.prototxt"), "w").write(hdr + "\n".join(layers) + "\n")
+    pt = 'name: "%s"\n' % name
+    for l in layers:
+        lname = l.split('"')[1]; typ = l.split('"')[3]
+        if lname not in W: continue
+        pt += 'layer { name: "%s" type: "%s"\n' % (lname, typ)
+        for shape, data in W[lname]:
+            pt += '  blobs { shape { %s } %s }\n' % (" ".join("dim: %d" % d for d in shape), " ".join("data: %.9g" % x for x in data))
+        pt += '}\n'
+    p = subprocess.Popen(["protoc", "-Isrc/ext", "--encode=caffe.NetParameter", "src/ext/caffe.proto"],
+                         stdin=subprocess.PIPE, stdout=open(os.path.join(out_dir, "best.caffemodel"), "wb"))
+    p.communicate(pt)
+    if p.returncode: raise RuntimeError("protoc failed")
+
+write("boda_test_res", layers, W)
+folded_layers, folded_W = fold(layers, W)
+write("boda_test_res_folded", folded_layers, folded_W)
@@ -414,7 +414,7 @@ namespace boda
       assert_st( t.elems_sz() == o.elems_sz() );
       T const * const te = static_cast<T const *>(t.rp_elems());
       T const * const oe = static_cast<T const *>(o.rp_elems());
-      for( uint32_t i = 0; i != t.elems_sz(); ++i ) { if( te[i] < oe[i] ) { ret=1; return; } }
+      for( uint32_t i = 0; i != t.elems_sz(); ++i ) { if( te[i] != oe[i] ) { ret = te[i] < oe[i]; return; } }
     }
   };
   // note: more like shortlex then lexigographic order, since an nda with lesser dims (i.e. shorter) is less.
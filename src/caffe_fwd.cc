@@ -53,6 +53,8 @@ namespace boda
     virtual void run_fwd( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns );
     virtual string get_info_log( void ) { return string(); }
     virtual void set_det_drop_seed( uint32_t const & det_drop_seed_ ) { boda_stub_caffe_set_det_drop_seed( det_drop_seed_ ); }
+    // note: caffe's mode and device are per-thread state (Caffe::Get() is thread-local)
+    virtual void bind_to_thread( void ) { Caffe::set_mode(Caffe::GPU); Caffe::SetDevice(gpu_id); }
   };
 
   void init_caffe( uint32_t const gpu_id ) {
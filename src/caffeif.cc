@@ -14,6 +14,7 @@
 #include"imagenet_util.H"
 #include<algorithm>
 #include<iostream>
+#include<emmintrin.h>
 #include"caffe.pb.h" 
 
 namespace boda 
@@ -46,6 +47,209 @@ namespace boda
     }
   }
 
+  // batched version of the above: fills in_batch slots [0,imgs.size()) with imgs
+  void subtract_mean_and_copy_imgs_to_batch( p_nda_t const & in_batch, vect_p_img_t const & imgs ) {
+    assert_st( imgs.size() <= in_batch->dims.dims(0) );
+    for( uint32_t i = 0; i != imgs.size(); ++i ) { subtract_mean_and_copy_img_to_batch( in_batch, i, imgs[i] ); }
+  }
+
+  // resampling taps along one dim that match resample_to_size() (up to its rounding to u8 after each step): nearest
+  // 2x upsampling while smaller than out_sz, then 2x box downsampling while the result would still be at least out_sz
+  // (copying the last pel if odd), then one final area-weighted downsample of less than 2x (using the same fixed-point
+  // spans and weights as downsample_w_transpose()). the steps are composed here, so each output pel is just a weighted
+  // sum of input pels, and its weights sum to (nearly) 1.
+  struct resamp_taps_t {
+    vect_uint32_t beg; // for each output pel, the index of its first tap in src/wt (with an extra end index at the end)
+    vect_uint32_t src;
+    vect_float wt;
+
+    typedef vector< std::map< uint32_t, double > > vect_taps_t; // per-pel (src pel -> weight)
+    // apply one step to taps: the new pel i is the sum over (j,w) in step[i] of w * (old pel j)
+    static void compose( vect_taps_t & taps, vect_taps_t const & step ) {
+      vect_taps_t ret( step.size() );
+      for( uint32_t i = 0; i != step.size(); ++i ) {
+	for( std::map< uint32_t, double >::const_iterator j = step[i].begin(); j != step[i].end(); ++j ) {
+	  for( std::map< uint32_t, double >::const_iterator k = taps[j->first].begin(); k != taps[j->first].end(); ++k ) {
+	    ret[i][k->first] += j->second * k->second;
+	  }
+	}
+      }
+      taps.swap( ret );
+    }
+    static vect_taps_t box_2x_step( uint32_t const n ) { // as downsample_w_transpose_2x()
+      vect_taps_t step( (n+1) >> 1 );
+      for( uint32_t i = 0; i != step.size(); ++i ) {
+	if( (i*2+1) == n ) { step[i][i*2] = 1.0; } // odd n: copy last pel
+	else { step[i][i*2] = 0.5; step[i][i*2+1] = 0.5; }
+      }
+      return step;
+    }
+    static vect_taps_t area_step( uint32_t const n, uint32_t const ds ) { // as downsample_w_transpose(), for ds in (n/2,n)
+      vect_taps_t step( ds );
+      uint16_t const scale = (uint64_t(ds)<<16)/n;
+      uint32_t const inv_scale = (uint64_t(1)<<46)/scale;
+      uint64_t const max_src_x = uint64_t(n)<<30;
+      double const wscale = double(scale) / double(uint64_t(1)<<46);
+      for( uint32_t i = 0; i != ds; ++i ) {
+	uint64_t const sx1_fp = uint64_t( i ) * inv_scale;
+	uint32_t const sx1 = sx1_fp >> 30;
+	uint64_t const sx2_fp = std::min( max_src_x, sx1_fp + inv_scale );
+	uint32_t const sx2 = sx2_fp >> 30;
+	uint64_t const sx1_w = ( 1U << 30 ) - (sx1_fp - (uint64_t(sx1)<<30));
+	uint64_t const sx2_w = sx2_fp - (uint64_t(sx2)<<30);
+	step[i][sx1] += sx1_w * wscale;
+	if( sx2 - sx1 == 2 ) { step[i][sx1+1] += double(uint64_t(1)<<30) * wscale; }
+	if( sx2_w ) { step[i][sx2] += sx2_w * wscale; }
+      }
+      return step;
+    }
+
+    resamp_taps_t( uint32_t const in_sz, uint32_t const out_sz ) {
+      assert_st( in_sz && out_sz );
+      vect_taps_t taps( in_sz );
+      for( uint32_t i = 0; i != in_sz; ++i ) { taps[i][i] = 1.0; }
+      while( taps.size() < out_sz ) { // as upsample_2x_to_size()
+	vect_taps_t step( taps.size() * 2 );
+	for( uint32_t i = 0; i != step.size(); ++i ) { step[i][i>>1] = 1.0; }
+	compose( taps, step );
+      }
+      while( ((taps.size()+1) >> 1) >= out_sz ) { compose( taps, box_2x_step( taps.size() ) ); } // as downsample_2x_to_size()
+      uint32_t const n = taps.size();
+      if( n != out_sz ) { compose( taps, ((out_sz<<1) == n) ? box_2x_step( n ) : area_step( n, out_sz ) ); }
+      assert_st( taps.size() == out_sz );
+      for( uint32_t i = 0; i != out_sz; ++i ) {
+	beg.push_back( src.size() );
+	for( std::map< uint32_t, double >::const_iterator j = taps[i].begin(); j != taps[i].end(); ++j ) {
+	  src.push_back( j->first );
+	  wt.push_back( j->second );
+	}
+      }
+      beg.push_back( src.size() );
+    }
+  };
+
+  // convert a row of w (even) YUYV pels (4 bytes per 2 pels: y0 u y1 v) to planar float R, G, and B rows. this uses
+  // the same formula as yuva2rgba(), but without rounding to u8 (the result is still clipped to [0,255]).
+  static void yuyv_row_to_rgb_float( float * const r, float * const g, float * const b, 
+				     uint8_t const * const src, uint32_t const w ) {
+    uint32_t x = 0;
+#if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const lo_bytes = _mm_set1_epi16( 0x00ff );
+    __m128i const lo_halves = _mm_set1_epi32( 0x0000ffff );
+    __m128 const y_off = _mm_set1_ps( 16.0f ), uv_off = _mm_set1_ps( 128.0f ), clip_max = _mm_set1_ps( 255.0f );
+    __m128 const y_r = _mm_set1_ps( 1.164f ), v_r = _mm_set1_ps( 1.596f ), v_g = _mm_set1_ps( 0.813f );
+    __m128 const u_g = _mm_set1_ps( 0.391f ), u_b = _mm_set1_ps( 2.018f );
+    for( ; x + 8 <= w; x += 8 ) { // 8 pels (16 bytes) per iteration
+      __m128i const px = _mm_loadu_si128( (__m128i const *)(src + x*2) );
+      __m128i const ys = _mm_and_si128( px, lo_bytes ); // y0 .. y7 (as u16s)
+      __m128i const uvs = _mm_srli_epi16( px, 8 ); // u0 v0 u1 v1 u2 v2 u3 v3 (as u16s)
+      __m128 const us = _mm_sub_ps( _mm_cvtepi32_ps( _mm_and_si128( uvs, lo_halves ) ), uv_off ); // u0 .. u3
+      __m128 const vs = _mm_sub_ps( _mm_cvtepi32_ps( _mm_srli_epi32( uvs, 16 ) ), uv_off ); // v0 .. v3
+      for( uint32_t h = 0; h != 2; ++h ) { // each half is 4 pels, sharing 2 u/v pairs
+	__m128 const yf = _mm_mul_ps( y_r, _mm_sub_ps( _mm_cvtepi32_ps( h ? _mm_unpackhi_epi16( ys, zero ) : 
+									   _mm_unpacklo_epi16( ys, zero ) ), y_off ) );
+	__m128 const uf = h ? _mm_unpackhi_ps( us, us ) : _mm_unpacklo_ps( us, us );
+	__m128 const vf = h ? _mm_unpackhi_ps( vs, vs ) : _mm_unpacklo_ps( vs, vs );
+	__m128 const rf = _mm_add_ps( yf, _mm_mul_ps( v_r, vf ) );
+	__m128 const gf = _mm_sub_ps( _mm_sub_ps( yf, _mm_mul_ps( v_g, vf ) ), _mm_mul_ps( u_g, uf ) );
+	__m128 const bf = _mm_add_ps( yf, _mm_mul_ps( u_b, uf ) );
+	_mm_storeu_ps( r + x + h*4, _mm_min_ps( _mm_max_ps( rf, _mm_setzero_ps() ), clip_max ) );
+	_mm_storeu_ps( g + x + h*4, _mm_min_ps( _mm_max_ps( gf, _mm_setzero_ps() ), clip_max ) );
+	_mm_storeu_ps( b + x + h*4, _mm_min_ps( _mm_max_ps( bf, _mm_setzero_ps() ), clip_max ) );
+      }
+    }
+#endif
+    for( ; x < w; x += 2 ) { // remainder (or all pels if no SSE2). note: same op order as above, so same results.
+      uint8_t const * const s = src + x*2;
+      float const uf = float(s[1]) - 128.0f;
+      float const vf = float(s[3]) - 128.0f;
+      for( uint32_t i = 0; i != 2; ++i ) {
+	float const yf = 1.164f*(float(s[i*2]) - 16.0f);
+	r[x+i] = std::min( std::max( yf + 1.596f*vf, 0.0f ), 255.0f );
+	g[x+i] = std::min( std::max( (yf - 0.813f*vf) - 0.391f*uf, 0.0f ), 255.0f );
+	b[x+i] = std::min( std::max( yf + 2.018f*uf, 0.0f ), 255.0f );
+      }
+    }
+  }
+
+  // fused version of yuva2rgba() (per-pel, as in capture_t::process_image()) + resample_to_size() +
+  // subtract_mean_and_copy_img_to_batch(): reads a raw YUYV frame (i.e. a V4L2 capture buffer) and writes the
+  // resampled, mean-subtracted, BGR planar result directly into in_batch slot img_ix, with no intermediate images. each
+  // output row is produced by converting only the input rows under it to float RGB (reusing the last converted row,
+  // which is often shared with the previous output row), then resampling (see resamp_taps_t) vertically and then
+  // horizontally. note: results differ slightly from the unfused path, since
+  // there is no rounding to u8 before or during resampling.
+  void yuyv_resample_subtract_mean_to_batch( p_nda_t const & in_batch, uint32_t const img_ix, 
+					     uint8_t const * const yuyv, u32_pt_t const & yuyv_sz ) {
+    timer_t t("yuyv_resample_subtract_mean_to_batch");
+    dims_t const & ibd = in_batch->dims;
+    assert_st( img_ix < ibd.dims(0) );
+    assert_st( 3 == ibd.dims(1) );
+    assert_st( ibd.strides(3) == 1 ); // we write rows of in_batch directly
+    assert_st( !(yuyv_sz.d[0] & 1) );
+    p_nda_float_t in_batch_float = make_shared<nda_float_t>( in_batch ); // FIXME: checks type, but only works for float
+    uint32_t const w = yuyv_sz.d[0];
+    uint32_t const out_w = ibd.dims(3);
+    uint32_t const out_h = ibd.dims(2);
+    resamp_taps_t const xt( w, out_w );
+    resamp_taps_t const yt( yuyv_sz.d[1], out_h );
+    uint32_t const * const xt_beg = &xt.beg[0];
+    uint32_t const * const xt_src = &xt.src[0];
+    float const * const xt_wt = &xt.wt[0];
+    float mean[3];
+    for( uint32_t c = 0; c < 3; ++c ) { mean[c] = float(uint8_t(u32_rgba_inmc >> (c*8))); }
+
+#pragma omp parallel
+    {
+      vect_float rgb( 3*w ); // one converted input row, as planar R, G, B rows
+      uint32_t rgb_src_y = uint32_t_const_max; // input row currently in rgb
+      vect_float acc( 3*w ); // the vertically resampled input rows under one output row, as planar R, G, B rows
+#pragma omp for schedule(static)
+      for( uint32_t y = 0; y < out_h; ++y ) {
+	std::fill( acc.begin(), acc.end(), 0.0f );
+	for( uint32_t ti = yt.beg[y]; ti != yt.beg[y+1]; ++ti ) {
+	  if( yt.src[ti] != rgb_src_y ) {
+	    rgb_src_y = yt.src[ti];
+	    yuyv_row_to_rgb_float( &rgb[0], &rgb[w], &rgb[2*w], yuyv + size_t(rgb_src_y)*w*2, w );
+	  }
+	  float const wt = yt.wt[ti];
+	  for( uint32_t i = 0; i != 3*w; ++i ) { acc[i] += wt*rgb[i]; }
+	}
+	for( uint32_t c = 0; c < 3; ++c ) {
+	  float const * const acc_c = &acc[c*w];
+	  float * const out = &in_batch_float->at4( img_ix, 2-c, y, 0 ); // note: RGB -> BGR swap via the '2-c' here
+	  for( uint32_t x = 0; x < out_w; ++x ) {
+	    float v = 0.0f;
+	    for( uint32_t ti = xt_beg[x]; ti != xt_beg[x+1]; ++ti ) { v += xt_wt[ti]*acc_c[xt_src[ti]]; }
+	    out[x] = v - mean[c];
+	  }
+	}
+      }
+    }
+  }
+
+  // inverse of subtract_mean_and_copy_img_to_batch(): adds back the mean and writes in_batch slot img_ix to img (which
+  // must be the same size). useful to display what the net sees, when in_batch wasn't filled from an image.
+  void copy_batch_to_img_add_mean( p_nda_t const & in_batch, uint32_t const img_ix, p_img_t const & img ) {
+    dims_t const & ibd = in_batch->dims;
+    assert_st( img_ix < ibd.dims(0) );
+    assert_st( 3 == ibd.dims(1) );
+    assert_st( img->sz.d[0] == ibd.dims(3) );
+    assert_st( img->sz.d[1] == ibd.dims(2) );
+    p_nda_float_t in_batch_float = make_shared<nda_float_t>( in_batch ); // FIXME: checks type, but only works for float
+#pragma omp parallel for	  
+    for( uint32_t y = 0; y < ibd.dims(2); ++y ) {
+      for( uint32_t x = 0; x < ibd.dims(3); ++x ) {
+	uint8_t rgb[3];
+	for( uint32_t c = 0; c < 3; ++c ) {
+	  rgb[c] = clip_to_u8( in_batch_float->at4( img_ix, 2-c, y, x ) + float(uint8_t(u32_rgba_inmc >> (c*8))) );
+	}
+	img->set_pel( {x,y}, rgba_to_pel( rgb[0], rgb[1], rgb[2] ) );
+      }
+    }
+  }
+
   void chans_to_area( uint32_t & out_s, u32_pt_t & out_sz, u32_pt_t const & in_sz, uint32_t in_chan ) {
     out_s = u32_ceil_sqrt( in_chan );
     out_sz = in_sz.scale( out_s );
@@ -101,7 +305,15 @@ namespace boda
     }
   }
 
-  p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out( void ) { return conv_pipe->run_one_blob_in_one_blob_out( in_batch, conv_fwd ); }
+  p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out( void ) { 
+    if( is_incr() ) { return run_one_blob_in_one_blob_out_incr(); }
+    return run_one_blob_in_one_blob_out_full();
+  }
+  p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out_full( void ) { 
+    if( is_tiled() ) { return run_one_blob_in_one_blob_out_tiled(); }
+    bind_fwd_pipe( conv_pipe );
+    return conv_pipe->run_one_blob_in_one_blob_out( in_batch, conv_fwd ); 
+  }
   p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out_upsamp( void ) { 
     return conv_pipe_upsamp->run_one_blob_in_one_blob_out( in_batch, conv_fwd_upsamp );
   }
@@ -160,6 +372,281 @@ namespace boda
     return from_pipe->get_single_top_node()->dims;
   }
 
+  // create a pipe for the net with the given input dims, sharing the layer blobs already loaded into conv_pipe
+  p_conv_pipe_t run_cnet_t::create_pipe_sharing_blobs( map_str_uint32_t const & in_dims_ ) {
+    p_conv_pipe_t ret = create_pipe_from_param( net_param, in_dims_, out_node_name, add_bck_ops );
+    ret->op_params = conv_pipe->op_params;
+    ret->layer_blobs = conv_pipe->layer_blobs;
+    return ret;
+  }
+
+  // after setup_cnet(), switch to new input dims (i.e. a new input image size) without re-reading the trained net or
+  // re-init()ing conv_fwd: the pipe is re-created for the new dims (sharing the already-loaded layer blobs), conv_fwd
+  // is rebind()ed to it, and in_batch is re-allocated. when tiled, conv_fwd stays bound to its current fwd_pipe.
+  void run_cnet_t::rebind_in_dims( map_str_uint32_t const & in_dims_ ) {
+    assert_st( net_param && conv_pipe && conv_fwd );
+    if( enable_upsamp_net ) { rt_err( "rebind_in_dims(): unsupported with enable_upsamp_net" ); }
+    in_dims = in_dims_;
+    conv_pipe = create_pipe_sharing_blobs( in_dims );
+    if( !is_tiled() ) { bind_fwd_pipe( conv_pipe ); }
+    in_batch.reset( new nda_float_t( conv_pipe->get_data_img_dims() ) );
+    if( is_incr() ) {
+      incr_prev_in.reset(); // next incremental run must be a full one
+      p_conv_pipe_t const old_tile_pipe = incr_tile_pipe;
+      setup_incr_tile_pipe();
+      if( conv_fwd_incr && incr_tile_pipe ) { 
+	if( old_tile_pipe ) { conv_fwd_incr->rebind( incr_tile_pipe ); }
+	else { rt_err( "rebind_in_dims(): incremental mode with conv_fwd_incr set, but the original in_dims were too small to tile" ); }
+      }
+    }
+  }
+
+  void run_cnet_t::bind_fwd_pipe( p_conv_pipe_t const & cp ) {
+    if( fwd_pipe == cp ) { return; }
+    fwd_pipe = cp;
+    conv_fwd->rebind( fwd_pipe );
+  }
+
+  map_str_uint32_t run_cnet_t::get_tile_in_dims( u32_pt_t const & tile_in_sz ) const {
+    map_str_uint32_t ret = in_dims;
+    ret["y"] = tile_in_sz.d[1]; ret["x"] = tile_in_sz.d[0];
+    return ret;
+  }
+
+  // return the input window to run as a tile to compute the output pels in out_box: the (valid-mode) support of
+  // out_box, with its nc moved back to a multiple of the support stride, and clipped to the input. the stride alignment
+  // makes the pels of the tile (at every layer) line up with those of the untiled net, and the clipping makes tiles on
+  // the edges of the input see the same (net) padding there as the untiled net. so, every output pel in out_box is
+  // computed from exactly the same values as in the untiled net. elsewhere, the tile's own padding only affects
+  // (unused) output pels outside out_box.
+  u32_box_t run_cnet_t::get_tile_in_box( u32_box_t const & out_box ) {
+    conv_support_info_t const & csi = get_out_csi(0);
+    i32_box_t need_in_box;
+    unchecked_out_box_to_in_box( need_in_box, u32_to_i32( out_box ), cm_valid, csi );
+    i32_pt_t const in_nc = floor_div( need_in_box.p[0], csi.support_stride ) * u32_to_i32( csi.support_stride );
+    i32_pt_t const full_in_sz = u32_to_i32( get_xy_dims( conv_pipe->get_data_img_dims() ) );
+    return i32_to_u32( i32_box_t( max( in_nc, i32_pt_t() ), min( need_in_box.p[1], full_in_sz ) ) );
+  }
+
+  // copy the xy_sz window of src starting at src_nc into the window of dst starting at dst_nc, for all imgs and chans
+  void copy_xy_window( p_nda_float_t const & dst, u32_pt_t const & dst_nc, 
+		       p_nda_float_t const & src, u32_pt_t const & src_nc, u32_pt_t const & xy_sz ) {
+    dims_t const & dd = dst->dims;
+    dims_t const & sd = src->dims;
+    assert_st( (dd.dsz("img") == sd.dsz("img")) && (dd.dsz("chan") == sd.dsz("chan")) );
+    assert_st( (dst_nc + xy_sz).both_dims_le( get_xy_dims( dd ) ) && (src_nc + xy_sz).both_dims_le( get_xy_dims( sd ) ) );
+    float * const dp = dst->elems_ptr();
+    float const * const sp = src->elems_ptr();
+    for( uint32_t img = 0; img != dd.dsz("img"); ++img ) {
+      for( uint32_t chan = 0; chan != dd.dsz("chan"); ++chan ) {
+	for( uint32_t y = 0; y != xy_sz.d[1]; ++y ) {
+	  uint32_t const dix = img*dd.dstride("img") + chan*dd.dstride("chan") + (dst_nc.d[1]+y)*dd.dstride("y");
+	  uint32_t const six = img*sd.dstride("img") + chan*sd.dstride("chan") + (src_nc.d[1]+y)*sd.dstride("y");
+	  for( uint32_t x = 0; x != xy_sz.d[0]; ++x ) {
+	    dp[dix + (dst_nc.d[0]+x)*dd.dstride("x")] = sp[six + (src_nc.d[0]+x)*sd.dstride("x")];
+	  }
+	}
+      }
+    }
+  }
+
+  // run the net over in_batch as a grid of tiles of (at most) tile_out_sz output pels each, and stitch the tile outputs
+  // into the (full) output. see get_tile_in_box() for how the tiles are chosen such that the result matches an untiled
+  // run (up to rounding, as the per-tile-size kernel variants may sum in a different order). only tile-sized
+  // activations are allocated: the tiles are run grouped by input size, and conv_fwd is rebind()ed to a new tile_pipe
+  // when the size changes. since only the tiles on the input edges can differ in size from the interior ones, there
+  // are at most 9 such sizes.
+  p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out_tiled( void ) {
+    timer_t t("run_cnet_tiled");
+    p_nda_float_t out_batch = make_shared< nda_float_t >( get_out_dims(0) );
+    run_tiles( out_batch, get_out_blks( tile_out_sz ) );
+    return out_batch;
+  }
+
+  // the grid of blk_sz output blocks covering the output (in raster order; blocks on the right/bottom may be smaller)
+  vect_u32_box_t run_cnet_t::get_out_blks( u32_pt_t const & blk_sz ) {
+    vect_u32_box_t ret;
+    u32_pt_t const out_sz = get_out_sz(0);
+    for( uint32_t y = 0; y < out_sz.d[1]; y += blk_sz.d[1] ) {
+      for( uint32_t x = 0; x < out_sz.d[0]; x += blk_sz.d[0] ) {
+	ret.push_back( u32_box_t( u32_pt_t(x,y), min( u32_pt_t(x,y) + blk_sz, out_sz ) ) );
+      }
+    }
+    return ret;
+  }
+
+  // compute the output pels in each of out_boxes, each as a tile (see get_tile_in_box()), and store them into out_batch
+  void run_cnet_t::run_tiles( p_nda_float_t const & out_batch, vect_u32_box_t const & out_boxes ) {
+    u32_pt_t const & support_stride = get_out_csi(0).support_stride;
+    vector< std::pair< u32_box_t, u32_box_t > > tiles; // (in_box,out_box) for each tile
+    for( vect_u32_box_t::const_iterator i = out_boxes.begin(); i != out_boxes.end(); ++i ) {
+      tiles.push_back( std::make_pair( get_tile_in_box( *i ), *i ) );
+    }
+    std::stable_sort( tiles.begin(), tiles.end(), []( std::pair< u32_box_t, u32_box_t > const & a, 
+						       std::pair< u32_box_t, u32_box_t > const & b ) { 
+			return a.first.sz() < b.first.sz(); } );
+    for( vector< std::pair< u32_box_t, u32_box_t > >::const_iterator i = tiles.begin(); i != tiles.end(); ++i ) {
+      u32_pt_t const tile_in_sz = i->first.sz();
+      if( get_xy_dims( fwd_pipe->get_data_img_dims() ) != tile_in_sz ) {
+	bind_fwd_pipe( create_pipe_sharing_blobs( get_tile_in_dims( tile_in_sz ) ) );
+      }
+      p_nda_float_t const tile_in = make_shared< nda_float_t >( fwd_pipe->get_data_img_dims() );
+      copy_xy_window( tile_in, u32_pt_t(), in_batch, i->first.p[0], tile_in_sz );
+      p_nda_float_t const tile_out = fwd_pipe->run_one_blob_in_one_blob_out( tile_in, conv_fwd );
+      // as the tile's nc is a multiple of the support stride, tile output pels are offset by nc/stride from untiled ones
+      u32_pt_t const tile_out_nc = i->second.p[0] - ( i->first.p[0] / support_stride );
+      copy_xy_window( out_batch, i->second.p[0], tile_out, tile_out_nc, i->second.sz() );
+    }
+  }
+
+  // incremental mode: all tiles have incr_tile_out_sz_ output pels, and are run with the same input size, which is
+  // the largest input window (see get_tile_in_box()) of any such tile, rounded up so that it differs from the full
+  // input size by a multiple of the support stride. this lets every tile window be moved back from the far input edges
+  // to fit (see run_incr_tiles()) while staying stride-aligned. if the tile windows would be as large as the input in
+  // both dims, there is no point in tiling, and incremental runs are always full ones.
+  void run_cnet_t::setup_incr_tile_pipe( void ) {
+    incr_tile_pipe.reset();
+    conv_support_info_t const & csi = get_out_csi(0);
+    if( csi.support_sz.is_zeros() ) { return; } // global support: every change dirties the whole output
+    u32_pt_t const out_sz = get_out_sz(0);
+    u32_pt_t const full_in_sz = get_xy_dims( conv_pipe->get_data_img_dims() );
+    incr_tile_out_sz_ = min( incr_tile_out_sz, out_sz );
+    u32_pt_t const max_nc = out_sz - incr_tile_out_sz_;
+    u32_pt_t tile_in_sz;
+    for( uint32_t i = 0; i <= std::max( max_nc.d[0], max_nc.d[1] ); ++i ) {
+      u32_pt_t const nc = min( u32_pt_t( i, i ), max_nc );
+      tile_in_sz = max( tile_in_sz, get_tile_in_box( u32_box_t( nc, nc + incr_tile_out_sz_ ) ).sz() );
+    }
+    for( uint32_t d = 0; d != 2; ++d ) {
+      uint32_t const s = csi.support_stride.d[d];
+      tile_in_sz.d[d] = full_in_sz.d[d] - ( (full_in_sz.d[d] - tile_in_sz.d[d]) / s ) * s;
+    }
+    if( tile_in_sz == full_in_sz ) { return; }
+    incr_tile_pipe = create_pipe_sharing_blobs( get_tile_in_dims( tile_in_sz ) );
+  }
+
+  // cover the dirty output blocks with tiles: scanning the blocks in raster order, place a tile at each dirty block not
+  // yet covered (moved back from the far output edges to fit), which also covers all the blocks it contains. so,
+  // adjacent dirty blocks are merged into (overlapping) tiles.
+  vect_u32_box_t run_cnet_t::get_incr_tiles( vect_uint8_t const & out_blk_dirty, u32_pt_t const & num_out_blks ) {
+    u32_pt_t const out_sz = get_out_sz(0);
+    vect_u32_box_t const out_blks = get_out_blks( incr_out_blk_sz );
+    assert_st( out_blks.size() == out_blk_dirty.size() );
+    vect_uint8_t covered( out_blks.size(), 0 );
+    vect_u32_box_t ret;
+    for( uint32_t i = 0; i != out_blks.size(); ++i ) {
+      if( (!out_blk_dirty[i]) || covered[i] ) { continue; }
+      u32_pt_t const nc = min( out_blks[i].p[0], out_sz - incr_tile_out_sz_ );
+      u32_box_t const tile( nc, nc + incr_tile_out_sz_ );
+      ret.push_back( tile );
+      u32_pt_t const blk_nc = ceil_div( tile.p[0], incr_out_blk_sz );
+      u32_pt_t const blk_end = min( ceil_div( tile.p[1], incr_out_blk_sz ), num_out_blks );
+      for( uint32_t by = blk_nc.d[1]; by != blk_end.d[1]; ++by ) {
+	for( uint32_t bx = blk_nc.d[0]; bx != blk_end.d[0]; ++bx ) {
+	  uint32_t const bix = by*num_out_blks.d[0]+bx;
+	  if( tile.contains( out_blks[bix] ) ) { covered[bix] = 1; }
+	}
+      }
+      assert_st( covered[i] );
+    }
+    return ret;
+  }
+
+  // compute each of out_boxes (each of incr_tile_out_sz_ output pels) as a tile, using incr_tile_pipe, into incr_out.
+  // each tile's input window is the tile's get_tile_in_box(), extended to the tile pipe's input size, and moved back
+  // from the far input edges to fit. as the tile pipe's input size differs from the full one by a multiple of the
+  // support stride, the window stays stride-aligned, and if the tile's input box reaches a far input edge, so does the
+  // window. so, just as for get_tile_in_box(), the output pels in the tile are the same as in the untiled net.
+  void run_cnet_t::run_incr_tiles( vect_u32_box_t const & out_boxes ) {
+    u32_pt_t const & support_stride = get_out_csi(0).support_stride;
+    p_has_conv_fwd_t const & tile_fwd = conv_fwd_incr ? conv_fwd_incr : conv_fwd;
+    if( !conv_fwd_incr ) { bind_fwd_pipe( incr_tile_pipe ); }
+    u32_pt_t const tile_in_sz = get_xy_dims( incr_tile_pipe->get_data_img_dims() );
+    u32_pt_t const win_max_nc = get_xy_dims( in_batch->dims ) - tile_in_sz;
+    p_nda_float_t const tile_in = make_shared< nda_float_t >( incr_tile_pipe->get_data_img_dims() );
+    for( vect_u32_box_t::const_iterator i = out_boxes.begin(); i != out_boxes.end(); ++i ) {
+      u32_box_t const in_box = get_tile_in_box( *i );
+      assert_st( in_box.sz().both_dims_le( tile_in_sz ) );
+      u32_pt_t const win_nc = min( in_box.p[0], win_max_nc );
+      copy_xy_window( tile_in, u32_pt_t(), in_batch, win_nc, tile_in_sz );
+      p_nda_float_t const tile_out = incr_tile_pipe->run_one_blob_in_one_blob_out( tile_in, tile_fwd );
+      u32_pt_t const tile_out_nc = i->p[0] - ( win_nc / support_stride );
+      copy_xy_window( incr_out, i->p[0], tile_out, tile_out_nc, i->sz() );
+    }
+    incr_in_pels += out_boxes.size() * uint64_t( tile_in_sz.dims_prod() );
+  }
+
+  // incremental mode (i.e. for video from a mostly-static camera): diff in_batch against the input of the previous run,
+  // at the granularity of the support stride (i.e. one output pel's worth of input). each changed input block dirties
+  // the output pels whose (any-valid) support it lies in, which accounts for the growth of the dirty region through all
+  // the layers of the net. the dirty output pels are rounded out to incr_out_blk_sz blocks, which are covered by tiles
+  // (see get_incr_tiles()), and only those are recomputed (see run_incr_tiles()) into the cached output of the previous
+  // run. if the tiles (with their halos) would cost too much compared to a full run (or there is no previous run, or
+  // the net has global support), a full run is done instead.
+  p_nda_float_t run_cnet_t::run_one_blob_in_one_blob_out_incr( void ) {
+    timer_t t("run_cnet_incr");
+    conv_support_info_t const & csi = get_out_csi(0);
+    u32_pt_t const in_sz = get_xy_dims( in_batch->dims );
+    bool do_full = (!incr_prev_in) || (!incr_tile_pipe);
+    if( !do_full ) {
+      // find changed input blocks
+      dims_t const & id = in_batch->dims;
+      u32_pt_t const & in_blk_sz = csi.support_stride;
+      u32_pt_t const num_in_blks = ceil_div( in_sz, in_blk_sz );
+      vect_uint8_t in_blk_dirty( num_in_blks.dims_prod(), 0 );
+      float const * const ip = in_batch->elems_ptr();
+      float const * const pp = incr_prev_in->elems_ptr();
+      for( uint32_t ic = 0; ic != id.dsz("img")*id.dsz("chan"); ++ic ) {
+	for( uint32_t y = 0; y != in_sz.d[1]; ++y ) {
+	  uint32_t const row_ix = ic*id.dstride("chan") + y*id.dstride("y");
+	  uint8_t * const blk_row = &in_blk_dirty[ (y/in_blk_sz.d[1])*num_in_blks.d[0] ];
+	  for( uint32_t x = 0; x != in_sz.d[0]; ++x ) {
+	    uint32_t const ix = row_ix + x*id.dstride("x");
+	    if( fabs( ip[ix] - pp[ix] ) > incr_diff_thresh ) { blk_row[x/in_blk_sz.d[0]] = 1; }
+	  }
+	}
+      }
+      // map changed input blocks to dirty output blocks
+      u32_pt_t const out_sz = get_out_sz(0);
+      u32_pt_t const num_out_blks = ceil_div( out_sz, incr_out_blk_sz );
+      vect_uint8_t out_blk_dirty( num_out_blks.dims_prod(), 0 );
+      for( uint32_t by = 0; by != num_in_blks.d[1]; ++by ) {
+	for( uint32_t bx = 0; bx != num_in_blks.d[0]; ++bx ) {
+	  if( !in_blk_dirty[by*num_in_blks.d[0]+bx] ) { continue; }
+	  u32_pt_t const in_nc = u32_pt_t(bx,by)*in_blk_sz;
+	  i32_box_t dirty_out_box;
+	  in_box_to_out_box( dirty_out_box, u32_box_t( in_nc, min( in_nc + in_blk_sz, in_sz ) ), cm_any_valid, csi );
+	  dirty_out_box = i32_box_t( max( dirty_out_box.p[0], i32_pt_t() ), min( dirty_out_box.p[1], u32_to_i32( out_sz ) ) );
+	  if( !dirty_out_box.is_strictly_normalized() ) { continue; } // no output depends on this block
+	  u32_box_t const dirty_blks = i32_to_u32( dirty_out_box );
+	  u32_pt_t const blk_nc = dirty_blks.p[0] / incr_out_blk_sz;
+	  u32_pt_t const blk_end = ceil_div( dirty_blks.p[1], incr_out_blk_sz );
+	  for( uint32_t oy = blk_nc.d[1]; oy != blk_end.d[1]; ++oy ) {
+	    for( uint32_t ox = blk_nc.d[0]; ox != blk_end.d[0]; ++ox ) { out_blk_dirty[oy*num_out_blks.d[0]+ox] = 1; }
+	  }
+	}
+      }
+      vect_u32_box_t const tiles = get_incr_tiles( out_blk_dirty, num_out_blks );
+      double const tiles_cost = double( tiles.size() ) * get_xy_dims( incr_tile_pipe->get_data_img_dims() ).dims_prod();
+      if( tiles_cost > incr_max_cost_frac * in_sz.dims_prod() ) { do_full = 1; }
+      else if( !tiles.empty() ) {
+	timer_t t("run_cnet_incr_part");
+	run_incr_tiles( tiles );
+      }
+    }
+    if( do_full ) {
+      timer_t t("run_cnet_incr_full");
+      incr_out = run_one_blob_in_one_blob_out_full();
+      incr_in_pels += in_sz.dims_prod();
+    }
+    if( !incr_prev_in ) { incr_prev_in = make_shared< nda_float_t >( in_batch->dims ); }
+    incr_prev_in->copy_elems_with_reshape( *in_batch );
+    // return a copy, so that the caller may modify it without corrupting the cached output
+    p_nda_float_t ret = make_shared< nda_float_t >( incr_out->dims );
+    ret->copy_elems_with_reshape( *incr_out );
+    return ret;
+  }
+
   void run_cnet_t::setup_cnet( nesi_init_arg_t * const nia ) {
     assert( !net_param );
     net_param = parse_and_upgrade_net_param_from_text_file( ptt_fn );
@@ -170,7 +657,23 @@ namespace boda
     copy_matching_layer_blobs_from_param_to_pipe( trained_net, conv_pipe );
 
     assert_st( conv_fwd );
-    conv_fwd->init( conv_pipe, nia );
+    if( is_tiled() ) {
+      if( !tile_out_sz.both_dims_non_zero() ) { rt_err( "tile_out_sz must be non-zero in both dims (or zero to disable tiling)" ); }
+      if( enable_upsamp_net ) { rt_err( "tile_out_sz is unsupported with enable_upsamp_net" ); }
+      if( get_out_csi(0).support_sz.is_zeros() ) { 
+	rt_err( "tile_out_sz is unsupported for nets where each output depends on the whole input (i.e. global pooling)" ); }
+      fwd_pipe = create_pipe_sharing_blobs( get_tile_in_dims( get_tile_in_box( u32_box_t( u32_pt_t(), tile_out_sz ) ).sz() ) );
+    } else { fwd_pipe = conv_pipe; }
+    conv_fwd->init( fwd_pipe, nia );
+    if( is_incr() ) {
+      if( !incr_out_blk_sz.both_dims_non_zero() ) { 
+	rt_err( "incr_out_blk_sz must be non-zero in both dims (or zero to disable incremental mode)" ); }
+      if( !incr_out_blk_sz.both_dims_le( incr_tile_out_sz ) ) { rt_err( "incr_tile_out_sz must be at least incr_out_blk_sz in both dims" ); }
+      if( enable_upsamp_net ) { rt_err( "incr_out_blk_sz is unsupported with enable_upsamp_net" ); }
+      incr_in_pels = 0;
+      setup_incr_tile_pipe();
+      if( conv_fwd_incr && incr_tile_pipe ) { conv_fwd_incr->init( incr_tile_pipe, nia ); }
+    }
 
     // setup batch
     assert_st( !in_batch );
@@ -232,6 +735,20 @@ namespace boda
   void cnet_predict_t::main( nesi_init_arg_t * nia ) { 
     setup_cnet( nia );
     setup_predict();
+    if( !img_in_fns.empty() ) {
+      vect_p_img_t imgs;
+      for( vect_filename_t::const_iterator i = img_in_fns.begin(); i != img_in_fns.end(); ++i ) {
+	imgs.push_back( make_shared< img_t >() );
+	imgs.back()->load_fn( i->exp );
+      }
+      vect_p_vect_anno_t const img_annos = do_predict_batch( imgs, 1, 0 );
+      assert_st( img_annos.size() == img_in_fns.size() );
+      for( uint32_t i = 0; i != img_annos.size(); ++i ) {
+	printf( "---- %s -----\n", str(img_in_fns[i].exp).c_str() );
+	for( vect_anno_t::const_iterator ai = img_annos[i]->begin(); ai != img_annos[i]->end(); ++ai ) { printstr( ai->str ); }
+      }
+      return;
+    }
     p_img_t img_in( new img_t );
     img_in->load_fn( img_in_fn.exp );
     do_predict( img_in, 1 );
@@ -363,15 +880,62 @@ namespace boda
   p_vect_anno_t cnet_predict_t::do_predict( p_img_t const & img_in, bool const print_to_terminal ) {
     p_img_t img_in_ds = resample_to_size( img_in, conv_pipe->get_data_img_xy_dims_3_chans_only() );
     subtract_mean_and_copy_img_to_batch( in_batch, 0, img_in_ds );
+    return do_predict_in_batch( print_to_terminal );
+  }
+
+  // run the net(s) on the current in_batch (i.e. as filled by the caller, perhaps with
+  // yuyv_resample_subtract_mean_to_batch()), and predict from the outputs
+  p_vect_anno_t cnet_predict_t::do_predict_in_batch( bool const print_to_terminal ) {
     p_nda_float_t out_batch = run_one_blob_in_one_blob_out();
     p_nda_float_t out_batch_upsamp;
     if( enable_upsamp_net ) { out_batch_upsamp = run_one_blob_in_one_blob_out_upsamp(); }
     return do_predict( out_batch, out_batch_upsamp, print_to_terminal );
   }
 
+  // runs the net once per group of up to get_max_batch_imgs() images, and then fans the per-slot outputs back out into
+  // one anno list per image. only the single-scale case (where each image occupies exactly one batch slot) is
+  // handled. if indep_imgs is true, each image gets its own fresh (unfiltered) pred_state in batch_pred_state, and
+  // pred_state is unchanged. otherwise, the images are treated as consecutive frames of a single stream, and are
+  // applied to pred_state in order, as if do_predict() had been called once per image.
+  vect_p_vect_anno_t cnet_predict_t::do_predict_batch( vect_p_img_t const & imgs, bool const indep_imgs,
+						       bool const print_to_terminal ) {
+    if( !( (scale_infos.size() == 1) && (scale_infos.back().bix == 0) && (!enable_upsamp_net) ) ) {
+      rt_err( "do_predict_batch() only supports the single-scale case (one image per batch slot)" );
+    }
+    uint32_t const max_batch_imgs = get_max_batch_imgs();
+    assert_st( max_batch_imgs );
+    u32_pt_t const in_xy_sz = conv_pipe->get_data_img_xy_dims_3_chans_only();
+    vect_p_vect_anno_t ret;
+    if( indep_imgs ) { batch_pred_state.clear(); batch_pred_state.resize( imgs.size(), pred_state ); }
+    for( uint32_t bb = 0; bb < imgs.size(); bb += max_batch_imgs ) {
+      uint32_t const be = std::min( uint32_t(imgs.size()), bb + max_batch_imgs );
+      vect_p_img_t batch_imgs;
+      for( uint32_t i = bb; i != be; ++i ) { batch_imgs.push_back( resample_to_size( imgs[i], in_xy_sz ) ); }
+      subtract_mean_and_copy_imgs_to_batch( in_batch, batch_imgs );
+      p_nda_float_t out_batch = run_one_blob_in_one_blob_out();
+      for( uint32_t i = bb; i != be; ++i ) {
+	if( indep_imgs ) { 
+	  vect_pred_state_t & ips = batch_pred_state[i];
+	  for( vect_pred_state_t::iterator j = ips.begin(); j != ips.end(); ++j ) { j->filt_prob_init = 0; j->to_disp = 0; }
+	  pred_state.swap( ips ); 
+	}
+	do_predict_scales( out_batch, p_nda_float_t(), i - bb );
+	ret.push_back( pred_state_to_annos( print_to_terminal ) );
+	if( indep_imgs ) { pred_state.swap( batch_pred_state[i] ); }
+      }
+    }
+    return ret;
+  }
+
   p_vect_anno_t cnet_predict_t::do_predict( p_nda_float_t const & out_batch, p_nda_float_t const & out_batch_upsamp, 
 					    bool const print_to_terminal ) {
+    do_predict_scales( out_batch, out_batch_upsamp, 0 );
+    return pred_state_to_annos( print_to_terminal );
+  }
 
+  // fills in pred_state for all scales, reading each scale's outputs from batch slot (bix + bix_off)
+  void cnet_predict_t::do_predict_scales( p_nda_float_t const & out_batch, p_nda_float_t const & out_batch_upsamp, 
+					  uint32_t const & bix_off ) {
     for( vect_scale_info_t::iterator i = scale_infos.begin(); i != scale_infos.end(); ++i ) {
       p_nda_float_t scale_batch = i->from_upsamp_net ? out_batch_upsamp : out_batch;
       dims_t const & sbd = scale_batch->dims;
@@ -380,8 +944,8 @@ namespace boda
 
       dims_t img_b = sbd;
       dims_t img_e = img_b;
-      img_b.dims(0) = i->bix;
-      img_e.dims(0) = i->bix + 1;
+      img_b.dims(0) = i->bix + bix_off;
+      img_e.dims(0) = i->bix + bix_off + 1;
       img_b.dims(1) = 0;
       img_e.dims(1) = sbd.dims(1);
       img_b.dims(2) = i->feat_box.p[0].d[1];
@@ -392,7 +956,6 @@ namespace boda
       assert_st( img_b.fits_in( img_e ) );
       do_predict_region( scale_batch, img_b, img_e, i->psb );
     }
-    return pred_state_to_annos( print_to_terminal );
   }
 
 
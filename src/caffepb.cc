@@ -15,6 +15,9 @@
 #include"rand_util.H"
 #include"imagenet_util.H"
 #include"img_io.H"
+#if defined(__SSE2__)
+#include<emmintrin.h>
+#endif
 
 // we get this function from our hacked-up version of
 // upgrade_proto.cpp, so we can upgrade NetParameters from V1->V2 the
@@ -222,14 +225,22 @@ namespace boda
 	fill_in_conv_op_from_param( conv_op, cp );
 	assert_st( cp.num_output() >= 0 ); // should zero be allowed?
 	conv_op->set_u32( "out_chans", cp.num_output() );
+	if( cp.group() != 1 ) { // only set when grouped; ungrouped convs have no groups param
+	  if( lp.type() != Convolution_coi.type ) { rt_err( "group != 1 is only supported for Convolution; layer: " + lp.name() ); }
+	  conv_op->set_u32( "groups", cp.group() );
+	}
 	assert_st( conv_op->has( "kern_sz" ) ); // FIXME: convolutions *must* specify kernel size, i think? check in caffe
 	// add (make explicit) filts and biases as inputs 
 	conv_op->bots.push_back( lp.name() + "_filts" );
 	conv_op->bots.push_back( lp.name() + "_biases" );
 	//conv_pipe->some_kinda_node_names.push_back( {filts,biases}_node_name ); // FIXME?
       } else if( lp.type() == ReLU_coi.type ) {
-      } else if( lp.type() == Scale_coi.type ) { // FIXME: actually read params
-      } else if( lp.type() == BatchNorm_coi.type ) { // FIXME: actually read params
+      } else if( lp.type() == Scale_coi.type ) {
+	caffe::ScaleParameter const & p = lp.scale_param();
+	conv_op->set_u32( "bias_term", p.bias_term() );
+      } else if( lp.type() == BatchNorm_coi.type ) {
+	caffe::BatchNormParameter const & p = lp.batch_norm_param();
+	conv_op->set( "eps", make_scalar_nda(float(p.eps())));
       } else if( lp.type() == Dropout_coi.type ) {
 	//rt_err( "TODO: handle dropout" );
         if( !add_bck_ops ) { // if not adding bck ops, treat dropout as no-op
@@ -305,7 +316,12 @@ namespace boda
       } else if( lp.type() == Accuracy_coi.type ) {
 	conv_op.reset(); // for now, just silently ignore acc layers.
       } else if( lp.type() == Concat_coi.type ) { // no parameters to get
-      } else if( lp.type() == Eltwise_coi.type ) { // FIXME: actually read params
+      } else if( lp.type() == Eltwise_coi.type ) {
+	caffe::EltwiseParameter const & p = lp.eltwise_param();
+	for( int32_t i = 0; i != p.coeff_size(); ++i ) {
+	  if( p.coeff(i) != 1.0f ) { rt_err( "unhandled Eltwise layer with non-unit coeffs: " + lp.name() ); }
+	}
+	conv_op->set_u32( "elt_op", p.operation() );
       } else {
 	conv_op.reset(); printf( "warning: ignoring layer with lp.type()=%s\n", str(lp.type()).c_str() );
       }
@@ -335,26 +351,107 @@ namespace boda
     return net_param;
   }
   
+  // minimal protobuf wire-format scanner for caffe::Datum. rather than using caffe::Datum::ParseFromArray(), which
+  // would copy the (large) data field into a std::string, we just find the fields we need in place. we follow protobuf
+  // semantics where it matters here: for repeated instances of non-repeated fields, the last one wins, and unknown fields
+  // are skipped. see caffe.proto for the field numbers.
+  struct datum_wire_t {
+    uint32_t chans;
+    uint32_t height;
+    uint32_t width;
+    uint32_t label;
+    uint8_t const * data;
+    uint64_t data_sz;
+    bool has_chans, has_height, has_width, has_data, has_float_data, encoded;
+    datum_wire_t( void ) : chans(0), height(0), width(0), label(0), data(0), data_sz(0), has_chans(0), has_height(0),
+			   has_width(0), has_data(0), has_float_data(0), encoded(0) { }
+  };
+
+  bool read_wire_varint( uint8_t const * & p, uint8_t const * const e, uint64_t & v ) {
+    v = 0;
+    for( uint32_t shift = 0; shift < 64; shift += 7 ) {
+      if( p == e ) { return 0; }
+      uint8_t const b = *(p++);
+      v |= uint64_t(b & 0x7f) << shift;
+      if( !(b & 0x80) ) { return 1; }
+    }
+    return 0; // too long
+  }
+
+  bool scan_datum_wire( datum_wire_t & dw, uint8_t const * p, uint8_t const * const e ) {
+    while( p != e ) {
+      uint64_t tag, v;
+      if( !read_wire_varint( p, e, tag ) ) { return 0; }
+      uint32_t const field = tag >> 3;
+      uint32_t const wire_type = tag & 7;
+      if( wire_type == 0 ) { // varint
+	if( !read_wire_varint( p, e, v ) ) { return 0; }
+	if( 0 ) { }
+	else if( field == 1 ) { dw.chans = uint32_t(v); dw.has_chans = 1; }
+	else if( field == 2 ) { dw.height = uint32_t(v); dw.has_height = 1; }
+	else if( field == 3 ) { dw.width = uint32_t(v); dw.has_width = 1; }
+	else if( field == 5 ) { dw.label = uint32_t(v); }
+	else if( field == 6 ) { dw.has_float_data = 1; } // note: not a valid encoding of float_data, but don't ignore it
+	else if( field == 7 ) { dw.encoded = bool(v); }
+      } else if( wire_type == 2 ) { // length-delimited
+	if( !read_wire_varint( p, e, v ) ) { return 0; }
+	if( v > uint64_t(e - p) ) { return 0; }
+	if( field == 4 ) { dw.data = p; dw.data_sz = v; dw.has_data = 1; }
+	else if( (field == 6) && v ) { dw.has_float_data = 1; } // packed float_data
+	p += v;
+      } else if( wire_type == 5 ) { // 32-bit
+	if( uint64_t(e - p) < 4 ) { return 0; }
+	if( field == 6 ) { dw.has_float_data = 1; } // unpacked float_data
+	p += 4;
+      } else if( wire_type == 1 ) { // 64-bit
+	if( uint64_t(e - p) < 8 ) { return 0; }
+	p += 8;
+      } else { return 0; } // groups (or invalid wire type); not used by caffe.proto
+    }
+    return 1;
+  }
+
+  // out[i] = float(in[i]) - sub, for i in [0,sz)
+  void u8_to_float_sub( float * const out, uint8_t const * const in, uint32_t const sz, float const sub ) {
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    __m128 const sub_v = _mm_set1_ps( sub );
+    for( ; (i + 16) <= sz; i += 16 ) {
+      __m128i const v8 = _mm_loadu_si128( (__m128i const *)(in + i) );
+      __m128i const lo16 = _mm_unpacklo_epi8( v8, zero );
+      __m128i const hi16 = _mm_unpackhi_epi8( v8, zero );
+      _mm_storeu_ps( out + i +  0, _mm_sub_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo16, zero ) ), sub_v ) );
+      _mm_storeu_ps( out + i +  4, _mm_sub_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo16, zero ) ), sub_v ) );
+      _mm_storeu_ps( out + i +  8, _mm_sub_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi16, zero ) ), sub_v ) );
+      _mm_storeu_ps( out + i + 12, _mm_sub_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi16, zero ) ), sub_v ) );
+    }
+#endif
+    for( ; i < sz; ++i ) { out[i] = float(in[i]) - sub; }
+  }
+
+  // note: bytes must remain valid only for the duration of the call. in particular, they may point directly into
+  // lmdb's read-only map, as no copy of the datum's data is made.
   uint32_t parse_datum_into( p_nda_float_t & out, uint32_t const out_ix, void const * const bytes, uint32_t const bytes_sz ) {
-    caffe::Datum caffe_datum;
-    bool const cdp_ret = caffe_datum.ParseFromArray( bytes, bytes_sz );
-    assert_st( cdp_ret );
+    datum_wire_t dw;
+    bool const scan_ret = scan_datum_wire( dw, (uint8_t const *)bytes, (uint8_t const *)bytes + bytes_sz );
+    if( !scan_ret ) { rt_err( "failed to parse datum: malformed protobuf wire data" ); }
 
-    bool const has_data = caffe_datum.has_data();
-    bool const has_float_data = caffe_datum.float_data_size();
+    bool const has_data = dw.has_data;
+    bool const has_float_data = dw.has_float_data;
     if( has_data + has_float_data != 1 ) {
       rt_err( strprintf( "datum must have exactly 1 of data and float_data, but: has_data=%s has_float_data=%s\n", 
 			 str(has_data).c_str(), str(has_float_data).c_str() ) );
     }
     if( has_float_data ) { rt_err( "TODO: datum has float_data handling." ); }
-    if( caffe_datum.encoded() ) { rt_err( "TODO: datum encoded=1 handling." ); }
-    if( !caffe_datum.has_channels() ) { rt_err( "datum missing channels field" ); }
-    if( !caffe_datum.has_height() ) { rt_err( "datum missing height field" ); }
-    if( !caffe_datum.has_width() ) { rt_err( "datum missing width field" ); }
+    if( dw.encoded ) { rt_err( "TODO: datum encoded=1 handling." ); }
+    if( !dw.has_chans ) { rt_err( "datum missing channels field" ); }
+    if( !dw.has_height ) { rt_err( "datum missing height field" ); }
+    if( !dw.has_width ) { rt_err( "datum missing width field" ); }
 
-    uint32_t const chans = caffe_datum.channels();
-    uint32_t const hi = caffe_datum.width();
-    uint32_t const wi = caffe_datum.height();
+    uint32_t const chans = dw.chans;
+    uint32_t const hi = dw.width;
+    uint32_t const wi = dw.height;
 
     if( !out ) { out.reset( new nda_float_t( dims_t( { 1, chans, hi, wi }, "float" ) ) ); }
 
@@ -377,22 +474,20 @@ namespace boda
 
     float * const ret_data = out->elems_ptr() + (out_ix * (chans*wo*ho));
 
-    if( chans*hi*wi != caffe_datum.data().size() ) {
+    if( chans*hi*wi != dw.data_sz ) {
       rt_err( strprintf( "inconsistency in datum data size vs datum dims: chans=%s hi=%s wi=%s so chans*h*w=%s but caffe_datum.data().size()=%s\n", 
-			 str(chans).c_str(), str(hi).c_str(), str(wi).c_str(), str(chans*hi*wi).c_str(), str(caffe_datum.data().size()).c_str() ) );
+			 str(chans).c_str(), str(hi).c_str(), str(wi).c_str(), str(chans*hi*wi).c_str(), str(dw.data_sz).c_str() ) );
     }
-    uint8_t const * const caffe_data = (uint8_t const *)(&caffe_datum.data()[0]);
+    uint8_t const * const caffe_data = dw.data;
 
     for( uint32_t c = 0; c < chans; ++c ) {
+      // note: data is assumed to be in BGR format
+      float const mean = float(uint8_t(u32_bgra_inmc >> (c*8)));
       for( uint32_t y = 0; y < wo; ++y ) {
-	for( uint32_t x = 0; x < ho; ++x ) {
-	  uint8_t const v = caffe_data[(c * hi + yi + y ) * wi + xi + x];
-	  // note: data is assumed to be in BGR format
-	  ret_data[ ( c * ho + y ) * wo + x ] = v - float(uint8_t(u32_bgra_inmc >> (c*8)));
-	}
+	u8_to_float_sub( ret_data + ( c * ho + y ) * wo, caffe_data + (c * hi + yi + y ) * wi + xi, ho, mean );
       }
     }
-    return caffe_datum.label();
+    return dw.label;
   }
 
   p_datum_t parse_datum( void const * const bytes, uint32_t const bytes_sz ) {
@@ -531,11 +626,17 @@ namespace boda
 
     // add dim names (and maybe do other fixups) for specific known layer types
     if( dest_lp.type() == Convolution_coi.type ) {
-      assert( blobs.size() == 2 ); // filts, biases
+      assert_st( (blobs.size() == 1) || (blobs.size() == 2) ); // filts, [biases]
       dims_t & fd = blobs.at(0)->dims;
       // for filter blobs, assume they are in the following format:
       assert_st( fd.sz() == 4 );
       fd.names(0) = "out_chan"; fd.names(1) = "in_chan"; fd.names(2) = "y"; fd.names(3) = "x";
+      if( blobs.size() == 1 ) { // bias_term: false, so make explicit zero biases
+	p_nda_float_t biases( new nda_float_t( dims_t( vect_uint32_t{ fd.dims(0) }, vect_string{ "out_chan" }, "float" ) ) );
+	float * const bp = biases->elems_ptr();
+	for( uint32_t i = 0; i != biases->elems_sz(); ++i ) { bp[i] = 0.0f; }
+	blobs.push_back( biases );
+      }
 
       dims_t & bd = blobs.at(1)->dims;
       // for 'old style' bias blobs, squwish out leading size 1 dims
@@ -258,39 +258,112 @@ namespace boda
     p_capture_t capture; //NESI(default="()",help="capture from camera options")    
     p_cnet_predict_t cnet_predict; //NESI(default="()",help="cnet running options")    
     p_filename_t img_in_fn; //NESI(help="optional: if specified, use as filename for single input image instead of using camera")
+    uint32_t max_batch_wait_ms; //NESI(default=0,help="if non-zero, enable dynamic batching: buffer captured frames until either the input batch (in_dims img) is full or this many ms have passed since the first buffered frame, then classify them all with a single forward pass.")
+    uint32_t fused_in_batch; //NESI(default=0,help="if non-zero, convert each captured (raw YUYV) frame directly into the net's input batch in a single pass, skipping the full-size RGBA and resampled intermediate images. if disp, the displayed image is then recreated from the input batch. not supported with dynamic batching.")
+    uint32_t disp; //NESI(default=1,help="if zero, run without a display window (i.e. for timing): frames are still captured and classified, but no display copies of them are made.")
     p_asio_fd_t cap_afd;
     disp_win_t disp_win;
     p_img_t in_img;
+    vect_p_img_t pending_imgs;
+    p_deadline_timer_t batch_timer;
+    p_cap_proc_thread_t proc_thread; // if capture->cap_thread (and no dynamic batching), runs proc_frame() on its own thread
+
+    // resample and classify a captured frame, and return a function to display the results. if proc_thread, this runs
+    // on the proc thread, and the returned function on the display thread.
+    disp_func_t proc_frame( p_img_t const & cap_img ) {
+      p_img_t const ds_img = resample_to_size( cap_img, in_img->sz );
+      return disp_frame( ds_img, cnet_predict->do_predict( ds_img, 0 ) );
+    }
+    // as above, but for a raw YUYV frame (see fused_in_batch)
+    disp_func_t proc_raw_frame( uint8_t const * const yuyv ) {
+      yuyv_resample_subtract_mean_to_batch( cnet_predict->in_batch, 0, yuyv, capture->cap_res );
+      p_img_t ds_img; // display copy of the frame, recreated from in_batch (only if there is a display)
+      if( disp ) { ds_img = make_p_img_t( in_img->sz ); copy_batch_to_img_add_mean( cnet_predict->in_batch, 0, ds_img ); }
+      return disp_frame( ds_img, cnet_predict->do_predict_in_batch( 0 ) );
+    }
+    disp_func_t disp_frame( p_img_t const & ds_img, p_vect_anno_t const & annos ) {
+      if( !disp ) { return []{}; }
+      return [this,ds_img,annos]{
+	in_img->share_pels_from( ds_img );
+	disp_win.update_img_annos( 0, annos );
+	disp_win.update_disp_imgs();
+      };
+    }
 
     void on_cap_read( error_code const & ec ) { 
       assert_st( !ec );
-      capture->on_readable( 1 );
-      p_img_t ds_img = resample_to_size( capture->cap_img, in_img->sz );
-      in_img->share_pels_from( ds_img );
-      disp_win.update_img_annos( 0, cnet_predict->do_predict( in_img, 0 ) );
-      disp_win.update_disp_imgs();
+      if( fused_in_batch ) {
+	disp_func_t disp_func;
+	capture->on_readable_raw( [this,&disp_func]( uint8_t const * const yuyv ) { disp_func = proc_raw_frame( yuyv ); } );
+	if( disp_func ) { disp_func(); } // note: run after on_readable_raw(), so the capture buffer is released first
+      }
+      else if( !capture->on_readable( 1 ) ) { } // no new frame (possible with cap_thread)
+      else if( max_batch_wait_ms ) {
+	pending_imgs.push_back( resample_to_size( capture->cap_img, in_img->sz ) );
+	if( pending_imgs.size() >= cnet_predict->get_max_batch_imgs() ) { batch_timer->cancel(); flush_pending_imgs(); }
+	else if( pending_imgs.size() == 1 ) { // first frame of a new batch: start the wait
+	  batch_timer->expires_from_now( microseconds( max_batch_wait_ms * 1000 ) );
+	  batch_timer->async_wait( bind( &capture_classify_t::on_batch_timer, this, _1 ) ); 
+	}
+      } else { proc_frame( capture->cap_img )(); }
       setup_capture_on_read( *cap_afd, &capture_classify_t::on_cap_read, this );
     }
+    // note: a wait that completed just before being canceled may still run here with !ec; at worst this causes an
+    // early flush of a partial batch, which is harmless.
+    void on_batch_timer( error_code const & ec ) { 
+      if( ec || pending_imgs.empty() ) { return; }
+      flush_pending_imgs();
+    }
+    // frames are consecutive, so we run them through pred_state in order (indep_imgs=0) and display only the latest.
+    void flush_pending_imgs( void ) {
+      vect_p_vect_anno_t const img_annos = cnet_predict->do_predict_batch( pending_imgs, 0, 0 );
+      if( disp ) {
+	in_img->share_pels_from( pending_imgs.back() );
+	disp_win.update_img_annos( 0, img_annos.back() );
+	disp_win.update_disp_imgs();
+      }
+      pending_imgs.clear();
+    }
     virtual void main( nesi_init_arg_t * nia ) { 
+      if( fused_in_batch && max_batch_wait_ms ) { 
+	rt_err( "fused_in_batch is not supported with dynamic batching (max_batch_wait_ms)" ); 
+      }
       cnet_predict->setup_cnet( nia );
       cnet_predict->setup_predict(); 
       in_img.reset( new img_t );
       in_img->set_sz_and_alloc_pels( cnet_predict->conv_pipe->get_data_img_xy_dims_3_chans_only() );
-      disp_win.disp_setup( in_img );
+      if( disp ) { disp_win.disp_setup( in_img ); }
       io_service_t & io = get_io( &disp_win );
+      p_io_work_t io_work;
+      batch_timer.reset( new deadline_timer_t( io ) );
       if( img_in_fn ) { // single static image as input
         p_img_t file_img = make_shared< img_t >();
         file_img->load_fn( img_in_fn->exp ); 
         p_img_t ds_img = resample_to_size( file_img, in_img->sz );
         in_img->share_pels_from( ds_img );
-        disp_win.update_img_annos( 0, cnet_predict->do_predict( in_img, 0 ) );
-        disp_win.update_disp_imgs();
+        p_vect_anno_t const annos = cnet_predict->do_predict( in_img, 0 );
+        if( disp ) { 
+	  disp_win.update_img_annos( 0, annos );
+	  disp_win.update_disp_imgs();
+	}
       } else { // from camera
         capture->cap_start();
-        cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
-        setup_capture_on_read( *cap_afd, &capture_classify_t::on_cap_read, this );
+	if( !disp ) { io_work.reset( new io_service_t::work( io ) ); } // no window, so run until killed
+	// note: dynamic batching is driven by asio timers, so it stays on the display thread. with cap_thread, frames
+	// still come from the capture thread (via get_fd()) in that case.
+	if( capture->cap_thread && !max_batch_wait_ms ) {
+	  proc_thread.reset( new cap_proc_thread_t( capture.get(), [&io]( disp_func_t const & f ) { io.post( f ); },
+						    [this]( p_cap_frame_t const & f ) { 
+						      return fused_in_batch ? proc_raw_frame( f->yuyv.get() ) : 
+							proc_frame( capture->frame_img( f ) ); } ) );
+	} else {
+	  cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
+	  setup_capture_on_read( *cap_afd, &capture_classify_t::on_cap_read, this );
+	}
       }
       io.run();
+      capture->cap_stop(); // note: must precede proc_thread.reset(), as it stops the proc thread's frame source.
+      proc_thread.reset();
     }
   };
 
@@ -300,20 +373,47 @@ namespace boda
     virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
     p_capture_t capture; //NESI(default="()",help="capture from camera options")    
     p_run_cnet_t run_cnet; //NESI(default="(out_node_name=conv3)",help="cnet running options")
+    uint32_t fused_in_batch; //NESI(default=0,help="if non-zero, convert each captured (raw YUYV) frame directly into the net's input batch in a single pass, skipping the full-size RGBA and resampled intermediate images. if disp, the displayed input image is then recreated from the input batch.")
+    uint32_t disp; //NESI(default=1,help="if zero, run without a display window (i.e. for timing): frames are still captured and run through the net, but no display copies of them (or of their features) are made.")
     p_img_t in_img;
     p_img_t feat_img;
     p_asio_fd_t cap_afd;
     disp_win_t disp_win;
+    p_cap_proc_thread_t proc_thread; // if capture->cap_thread, runs proc_frame() on its own thread
+
+    // resample a captured frame and run the net on it, and return a function to display it and its features. if
+    // proc_thread, this runs on the proc thread, and the returned function on the display thread.
+    disp_func_t proc_frame( p_img_t const & cap_img ) {
+      p_img_t const ds_img = resample_to_size( cap_img, in_img->sz );
+      subtract_mean_and_copy_img_to_batch( run_cnet->in_batch, 0, ds_img );
+      return disp_frame( ds_img, run_cnet->run_one_blob_in_one_blob_out() );
+    }
+    // as above, but for a raw YUYV frame (see fused_in_batch)
+    disp_func_t proc_raw_frame( uint8_t const * const yuyv ) {
+      yuyv_resample_subtract_mean_to_batch( run_cnet->in_batch, 0, yuyv, capture->cap_res );
+      p_img_t ds_img; // display copy of the frame, recreated from in_batch (only if there is a display)
+      if( disp ) { ds_img = make_p_img_t( in_img->sz ); copy_batch_to_img_add_mean( run_cnet->in_batch, 0, ds_img ); }
+      return disp_frame( ds_img, run_cnet->run_one_blob_in_one_blob_out() );
+    }
+    // note: the features are copied out of out_batch here (i.e. on the proc thread), as the net may reuse it.
+    disp_func_t disp_frame( p_img_t const & ds_img, p_nda_float_t const & out_batch ) {
+      if( !disp ) { return []{}; }
+      p_img_t const ds_feat_img = make_p_img_t( feat_img->sz );
+      copy_batch_to_img( out_batch, 0, ds_feat_img, u32_box_t{} );
+      return [this,ds_img,ds_feat_img]{
+	in_img->share_pels_from( ds_img );
+	feat_img->share_pels_from( ds_feat_img );
+	disp_win.update_disp_imgs();
+      };
+    }
 
     void on_cap_read( error_code const & ec ) { 
       assert_st( !ec );
-      capture->on_readable( 1 );
-      p_img_t ds_img = resample_to_size( capture->cap_img, in_img->sz );
-      in_img->share_pels_from( ds_img );
-      subtract_mean_and_copy_img_to_batch( run_cnet->in_batch, 0, in_img );
-      p_nda_float_t out_batch = run_cnet->run_one_blob_in_one_blob_out();
-      copy_batch_to_img( out_batch, 0, feat_img, u32_box_t{} );
-      disp_win.update_disp_imgs();
+      if( fused_in_batch ) {
+	disp_func_t disp_func;
+	capture->on_readable_raw( [this,&disp_func]( uint8_t const * const yuyv ) { disp_func = proc_raw_frame( yuyv ); } );
+	if( disp_func ) { disp_func(); } // note: run after on_readable_raw(), so the capture buffer is released first
+      } else if( capture->on_readable( 1 ) ) { proc_frame( capture->cap_img )(); }
       setup_capture_on_read( *cap_afd, &capture_feats_t::on_cap_read, this );
     }
 
@@ -411,13 +511,24 @@ namespace boda
       feat_img->set_sz_and_alloc_pels( feat_img_sz );
 
       capture->cap_start();
-      disp_win.disp_setup( vect_p_img_t{feat_img,in_img} );
-      register_lb_handler( disp_win, &capture_feats_t::on_lb, this );
-
       io_service_t & io = get_io( &disp_win );
-      cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
-      setup_capture_on_read( *cap_afd, &capture_feats_t::on_cap_read, this );
+      p_io_work_t io_work;
+      if( disp ) {
+	disp_win.disp_setup( vect_p_img_t{feat_img,in_img} );
+	register_lb_handler( disp_win, &capture_feats_t::on_lb, this );
+      } else { io_work.reset( new io_service_t::work( io ) ); } // no window, so run until killed
+      if( capture->cap_thread ) {
+	proc_thread.reset( new cap_proc_thread_t( capture.get(), [&io]( disp_func_t const & f ) { io.post( f ); },
+						  [this]( p_cap_frame_t const & f ) { 
+						    return fused_in_batch ? proc_raw_frame( f->yuyv.get() ) : 
+						      proc_frame( capture->frame_img( f ) ); } ) );
+      } else {
+	cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
+	setup_capture_on_read( *cap_afd, &capture_feats_t::on_cap_read, this );
+      }
       io.run();
+      capture->cap_stop(); // note: must precede proc_thread.reset(), as it stops the proc thread's frame source.
+      proc_thread.reset();
     }
   };
 
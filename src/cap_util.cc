@@ -18,6 +18,8 @@
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <linux/videodev2.h>
 
 namespace boda 
@@ -33,6 +35,106 @@ namespace boda
 
   p_run_cnet_t make_p_run_cnet_t_init_and_check_unused_from_lexp( p_lexp_t const & lexp, nesi_init_arg_t * const nia );
 
+  // lock-free single-slot 'latest frame wins' buffer from one producer thread to one consumer thread, implemented as a
+  // triple buffer. the producer never blocks on the consumer: publishing replaces any not-yet-consumed frame (which is
+  // then dropped), and the consumer always gets the newest published frame.
+  struct latest_frame_slot_t {
+    p_cap_frame_t bufs[3];
+    std::atomic< uint8_t > mid; // index of the middle (published) buf, or'd with fresh_bit if not yet consumed
+    uint8_t back; // producer-owned buf
+    uint8_t front; // consumer-owned buf
+    static uint8_t const fresh_bit = 4;
+    latest_frame_slot_t( void ) : mid(1), back(0), front(2) { }
+    p_cap_frame_t const & get_back( void ) { return bufs[back]; }
+    // publish the back buf, and return true if an unconsumed frame was dropped to do so
+    bool publish( void ) { uint8_t const old = mid.exchange( back | fresh_bit ); back = old & 3; return old & fresh_bit; }
+    // return the latest published frame (valid until the next consume()), or null if there is no new one
+    p_cap_frame_t consume( void ) {
+      if( !(mid.load() & fresh_bit) ) { return p_cap_frame_t(); }
+      front = mid.exchange( front ) & 3;
+      return bufs[front];
+    }
+  };
+
+  // dequeues frames from cap on a background thread, copying out their raw data and publishing them to latest_frame,
+  // and signaling ev_fd on each publish. this lets slow frame consumers (i.e. cnet forward) skip frames without
+  // stalling V4L2 dequeueing. the object (and ev_fd) outlive stop_thread(), so that any consumer blocked waiting on
+  // ev_fd can be woken and see that capture stopped.
+  struct cap_thread_t {
+    capture_t * const cap;
+    int ev_fd; // eventfd signaled on each publish to latest_frame (and on stop)
+    latest_frame_slot_t latest_frame;
+    std::atomic< bool > stop; // set to stop the thread, or by the thread if it failed
+    std::exception_ptr err; // if set, the thread failed; rethrown by consume(). set before stop, so valid if stop.
+    uint64_t unconsumed_dropped_frames; // frames published but replaced before being consumed
+    std::thread thread;
+
+    cap_thread_t( capture_t * const cap_ ) : cap(cap_), ev_fd(-1), stop(0), unconsumed_dropped_frames(0) {
+      neg_one_fail( ev_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ), "eventfd" );
+      for( uint32_t i = 0; i != 3; ++i ) {
+	latest_frame.bufs[i] = make_shared< cap_frame_t >();
+	latest_frame.bufs[i]->yuyv = ma_p_uint8_t( cap->get_yuyv_sz(), 64 );
+	latest_frame.bufs[i]->img = make_shared< img_t >();
+	latest_frame.bufs[i]->img->set_sz_and_alloc_pels( cap->cap_res );
+	latest_frame.bufs[i]->img_valid = 0;
+      }
+      thread = std::thread( &cap_thread_t::run, this );
+    }
+    ~cap_thread_t( void ) { stop_thread(); close( ev_fd ); }
+    void stop_thread( void ) {
+      if( !thread.joinable() ) { return; }
+      stop = 1;
+      thread.join();
+      signal_ev_fd(); // wake any wait_for_frame()
+      if( cap->debug ) { printf( "unconsumed_dropped_frames=%s\n", str(unconsumed_dropped_frames).c_str() ); }
+    }
+    void signal_ev_fd( void ) {
+      uint64_t const one = 1;
+      neg_one_fail( write( ev_fd, &one, sizeof(one) ), "write" );
+    }
+
+    void run( void ) {
+      try {
+	pollfd pfd = { cap->cap_fd, POLLIN, 0 };
+	uint64_t next_seq = 0;
+	while( !stop ) {
+	  int const ret = poll( &pfd, 1, 100 ); // note: timeout so we notice stop
+	  if( ret == -1 ) { if( errno == EINTR ) { continue; } rt_err_errno( "poll" ); }
+	  if( !ret ) { continue; }
+	  p_cap_frame_t const & frame = latest_frame.get_back();
+	  uint64_t const read_but_dropped_frames_init = cap->read_but_dropped_frames;
+	  uint8_t * const yuyv = frame->yuyv.get();
+	  size_t const yuyv_sz = cap->get_yuyv_sz();
+	  if( !cap->read_frame( [yuyv,yuyv_sz]( uint8_t const * const p ) { memcpy( yuyv, p, yuyv_sz ); }, 1 ) ) { 
+	    continue; 
+	  }
+	  frame->img_valid = 0;
+	  next_seq += cap->read_but_dropped_frames - read_but_dropped_frames_init;
+	  frame->seq = next_seq++;
+	  frame->glass_time = cap->last_glass_time;
+	  frame->pub_time = get_cur_time();
+	  if( latest_frame.publish() ) { ++unconsumed_dropped_frames; }
+	  signal_ev_fd();
+	}
+      } catch( ... ) {
+	err = std::current_exception();
+	stop = 1;
+	signal_ev_fd();
+      }
+    }
+
+    // clear ev_fd and return the latest frame (valid until the next call), or null if there is no new one. note that
+    // ev_fd may be left signaled when there is no new frame (if one was published between clearing it and consuming).
+    p_cap_frame_t consume( void ) {
+      uint64_t cnt = 0;
+      if( read( ev_fd, &cnt, sizeof(cnt) ) == -1 ) { if( errno != EAGAIN ) { rt_err_errno( "read" ); } }
+      if( stop && err ) { std::rethrow_exception( err ); }
+      p_cap_frame_t const ret = latest_frame.consume();
+      if( ret ) { log_timer_since( "cap_pub_to_consume", ret->pub_time ); }
+      return ret;
+    }
+  };
+
   void capture_t::cap_start( void  ) { 
     if( !cap_img ) {
       cap_img.reset( new img_t );
@@ -42,9 +144,11 @@ namespace boda
     open_device();
     init_device();
     start_capturing();
+    if( cap_thread ) { cap_thr = make_shared< cap_thread_t >( this ); }
   }
 
   void capture_t::cap_stop( void ) {
+    if( cap_thr ) { cap_thr->stop_thread(); } // note: keep cap_thr (and its ev_fd) until destruction/restart
     if( cap_fd != -1 ) { 
       stop_capturing();
       buffers.clear();
@@ -53,17 +157,90 @@ namespace boda
     }
   }
 
+  capture_t::~capture_t( void ) { cap_stop(); }
+
   // read_req_t iface:
-  int capture_t::get_fd( void ) { assert_st( cap_fd != -1 ); return cap_fd; }
-  bool capture_t::on_readable( bool const want_frame ) { return read_frame( cap_img, want_frame ); }
+  int capture_t::get_fd( void ) { 
+    if( cap_thread ) { assert_st( cap_thr ); return cap_thr->ev_fd; }
+    assert_st( cap_fd != -1 ); return cap_fd; 
+  }
+  bool capture_t::on_readable( bool const want_frame ) { 
+    if( !cap_thread ) { return read_frame( cap_img, want_frame ); }
+    p_cap_frame_t const frame = cap_thr->consume();
+    if( !frame ) { return 0; }
+    // note: we convert into (rather than share the pels of a frame img with) cap_img, as users may rely on cap_img's
+    // pels being fixed
+    if( want_frame ) { process_image( cap_img, frame->yuyv.get(), get_yuyv_sz() ); }
+    return want_frame;
+  }
+
+  // if there is a new frame, call proc with its raw YUYV data (valid only during the call), and return true. without
+  // cap_thread, this is the V4L2 mmap()'d buffer itself, so there is no copy or conversion of the frame at all unless
+  // proc does one.
+  bool capture_t::on_readable_raw( raw_frame_func_t const & proc ) { 
+    if( !cap_thread ) { return read_frame( proc, 1 ); }
+    p_cap_frame_t const frame = cap_thr->consume();
+    if( !frame ) { return 0; }
+    proc( frame->yuyv.get() );
+    return 1;
+  }
+
+  // return frame (from wait_for_frame()) converted to an image, converting it if needed. the result is valid as long as
+  // frame is.
+  p_img_t const & capture_t::frame_img( p_cap_frame_t const & frame ) {
+    if( !frame->img_valid ) { process_image( frame->img, frame->yuyv.get(), get_yuyv_sz() ); frame->img_valid = 1; }
+    return frame->img;
+  }
+
+  // block until a new frame is availible and return it (valid until the next call), or return null if capture stopped
+  p_cap_frame_t capture_t::wait_for_frame( void ) {
+    if( !cap_thr ) { rt_err( "wait_for_frame() requires cap_thread=1 (and cap_start())" ); }
+    while( 1 ) {
+      p_cap_frame_t const ret = cap_thr->consume();
+      if( ret ) { return ret; }
+      if( cap_thr->stop ) { return ret; }
+      pollfd pfd = { cap_thr->ev_fd, POLLIN, 0 };
+      if( poll( &pfd, 1, -1 ) == -1 ) { if( errno != EINTR ) { rt_err_errno( "poll" ); } }
+    }
+  }
+
+  cap_proc_thread_t::cap_proc_thread_t( capture_t * const cap_, disp_post_func_t const & post_func_, 
+					cap_proc_func_t const & proc_func_ ) : 
+    cap(cap_), post_func(post_func_), proc_func(proc_func_), last_post_ix(0) {
+    if( !cap->cap_thread ) { rt_err( "frame processing on a separate thread requires capture cap_thread=1" ); }
+    thread = std::thread( &cap_proc_thread_t::run, this );
+  }
+  // note: cap->cap_stop() must be called before this, so that run() will return.
+  cap_proc_thread_t::~cap_proc_thread_t( void ) { thread.join(); }
+
+  void cap_proc_thread_t::run( void ) {
+    try {
+      while( p_cap_frame_t const frame = cap->wait_for_frame() ) {
+	disp_func_t const disp_func = proc_func( frame );
+	uint64_t const glass_time = frame->glass_time;
+	uint64_t const post_time = get_cur_time();
+	uint64_t const post_ix = ++last_post_ix;
+	post_func( [this,disp_func,glass_time,post_time,post_ix]{ 
+	    if( post_ix != last_post_ix ) { return; } // a newer result is already queued, so skip this stale one
+	    log_timer_since( "cap_proc_to_disp", post_time );
+	    disp_func();
+	    log_timer_since( "cap_glass_to_disp", glass_time );
+	  } );
+      }
+    } catch( ... ) {
+      std::exception_ptr const err = std::current_exception();
+      post_func( [err]{ std::rethrow_exception( err ); } );
+    }
+  }
 
 
   // V4L2 code
   void capture_t::process_image( p_img_t const & img, const void *p, int size )
   {
-    uint8_t const * src = (uint8_t const * )p;
     assert_st( !(cap_res.d[0] & 1) );
-    for( uint32_t i = 0; i != cap_res.d[1]; ++i ) {
+#pragma omp parallel for
+    for( uint32_t i = 0; i < cap_res.d[1]; ++i ) {
+      uint8_t const * src = (uint8_t const * )p + size_t(i)*cap_res.d[0]*2;
       for( uint32_t j = 0; j != cap_res.d[0]; j += 2 ) {
 	img->set_pel( {j+0, i}, yuva2rgba(src[0],src[1],src[3]) );
 	img->set_pel( {j+1, i}, yuva2rgba(src[2],src[1],src[3]) );
@@ -96,8 +273,28 @@ namespace boda
   }
 #endif
 
-  // read any availible frames, but only process the freshest/newest one (discarding any others)
-  bool capture_t::read_frame( p_img_t const & out_img, bool const want_frame )
+  // convert the capture timestamp of buf to get_cur_time() time, using the current offset between CLOCK_MONOTONIC (if
+  // that is what the driver uses for timestamps) and get_cur_time()'s clock. if the driver uses some other clock,
+  // return the current time (i.e. the dequeue time) instead.
+  static uint64_t get_glass_time( v4l2_buffer const & buf ) {
+    uint64_t const now = get_cur_time();
+    if( (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC ) { return now; }
+    timespec ts = {0};
+    neg_one_fail( clock_gettime( CLOCK_MONOTONIC, &ts ), "clock_gettime" );
+    uint64_t const mono_now = uint64_t(ts.tv_sec)*1000*1000*1000 + ts.tv_nsec;
+    uint64_t const mono_buf = uint64_t(buf.timestamp.tv_sec)*1000*1000*1000 + uint64_t(buf.timestamp.tv_usec)*1000;
+    uint64_t const age = (mono_now > mono_buf) ? (mono_now - mono_buf) : 0;
+    return (now > age) ? (now - age) : 0;
+  }
+
+  bool capture_t::read_frame( p_img_t const & out_img, bool const want_frame ) {
+    return read_frame( [this,&out_img]( uint8_t const * const p ) { process_image( out_img, p, get_yuyv_sz() ); }, 
+		       want_frame );
+  }
+
+  // read any availible frames, but only process the freshest/newest one (discarding any others). the newest frame's
+  // raw data is passed to proc directly from its V4L2 buffer, before the buffer is re-queued.
+  bool capture_t::read_frame( raw_frame_func_t const & proc, bool const want_frame )
   {
     uint32_t const read_but_dropped_frames_init = read_but_dropped_frames;
     timer_t t("read_frame");
@@ -116,7 +313,10 @@ namespace boda
 	switch (errno) {
 	case EAGAIN: // no frames left/availible, we're done no matter what
 	  if( last_buf_valid ) { // if we got a any frames, process the last one (only)
-	    if( want_frame ) { process_image( out_img, buffers[last_buf.index].get(), buf.bytesused); }
+	    if( want_frame ) { 
+	      last_glass_time = get_glass_time( last_buf );
+	      proc( buffers[last_buf.index].get() ); 
+	    }
 	    else { ++read_but_dropped_frames; }
 	    must_q_buf( cap_fd, last_buf );
 	  }
@@ -269,8 +469,8 @@ namespace boda
     neg_one_fail( epfd = epoll_create( 1 ), "epoll_create" );
     uint32_t const all_ev = EPOLLIN|EPOLLPRI|EPOLLOUT|EPOLLERR|EPOLLHUP|EPOLLET;
     epoll_event ev{ all_ev }; // EPOLLIN|EPOLLET };
-    ev.data.fd = cap_fd;
-    neg_one_fail( epoll_ctl( epfd, EPOLL_CTL_ADD, cap_fd, &ev ), "epoll_ctl" );
+    ev.data.fd = get_fd();
+    neg_one_fail( epoll_ctl( epfd, EPOLL_CTL_ADD, get_fd(), &ev ), "epoll_ctl" );
     //printf( "EPOLLIN=%s EPOLLPRI=%s EPOLLOUT=%s EPOLLERR=%s EPOLLHUP=%s EPOLLET=%s\n", str(EPOLLIN).c_str(), str(EPOLLPRI).c_str(), str(EPOLLOUT).c_str(), str(EPOLLERR).c_str(), str(EPOLLHUP).c_str(), str(EPOLLET).c_str() );
     for( uint32_t i = 0; i != 10; ) {
       int num_ev;
@@ -279,9 +479,9 @@ namespace boda
       if( num_ev == -1 ) { if( errno == EINTR ) { continue; } else { rt_err_errno("epoll_wait"); } }
       if( num_ev == 0 ) { rt_err("epoll timeout"); }
       assert_st( num_ev == 1 );
-      assert_st( ev.data.fd == cap_fd );
+      assert_st( ev.data.fd == get_fd() );
       //printf( "ev.events=%s\n", str(ev.events).c_str() );
-      if( read_frame( cap_img, 1 ) ) { ++i; printstr("."); } // got a frame
+      if( on_readable( 1 ) ) { ++i; printstr("."); } // got a frame
       else { printstr("-"); }
       fflush( stdout );
     }
@@ -23,22 +23,38 @@ namespace boda
       else if( op_name == "bconv" ) { gen_op_bconv(rcg); } 
       else if( op_name == "bconv_fb" ) { gen_op_bconv_fb(rcg); } 
       else if( op_name == "reduce" ) { gen_op_reduce(rcg); } 
+      else if( op_name == "wconv" ) { gen_op_wconv(rcg); } 
+      else if( op_name == "wconv_xpose_filts" ) { gen_op_wconv_xpose_filts(rcg); } 
+      else if( op_name == "wconv_xpose_in" ) { gen_op_wconv_xpose_in(rcg); } 
+      else if( op_name == "wconv_xpose_out" ) { gen_op_wconv_xpose_out(rcg); } 
+      else if( op_name == "i8conv" ) { gen_op_i8conv(rcg); } 
+      else if( op_name == "dwconv" ) { gen_op_dwconv(rcg); } 
     }
 
     void gen_op_reduce( rtc_call_gen_t * rcg ) {
       // FIXME: iterator over non-flat args and/or select ins arg directly, then do inner iter?
       for( vect_arg_decl_t::multi_iter i = rcg->rtc_func_template->arg_decls.multi_begin( &rcg->op ); !i.at_end(); ++i ) {
         if( i.ad().vn != "ins" ) { continue; }
-	rcg->line( "ins_ops", "v += "+i.vn()+"[GLOB_ID_1D];" ); 
+	rcg->line( "ins_ops", "v += load_float_from_rp_%("+i.vn()+"_tn)( GLOB_ID_1D, "+i.vn()+" );" ); 
       }
     }
     string maybe_add_relu( rtc_call_gen_t * rcg, string const & ve ) { 
       return rcg->op.get_u32("conv_has_relu") ? ( "max(0.0f,"+ve+")" ) : ve; 
     }
 
-    string add_bias_then_maybe_relu( rtc_call_gen_t * rcg, dims_t const & work, uint32_t const & tx, uint32_t const ty ) { 
+    // with conv_has_res=1 (see conv_pipe_fwd_t::maybe_fuse_eltwise()), out initially holds a residual, so we add the
+    // current value of the output element oe to ve (before any relu). oe is empty for output formats that can't do this.
+    string maybe_add_res_then_relu( rtc_call_gen_t * rcg, string const & ve, string const & oe ) { 
+      bool const conv_has_res = rcg->op.has("conv_has_res") && rcg->op.get_u32("conv_has_res");
+      if( !conv_has_res ) { return maybe_add_relu( rcg, ve ); }
+      if( oe.empty() ) { rt_err( "conv_has_res=1 is unsupported for this output format of func: " + rcg->op.get_func_name() ); }
+      return maybe_add_relu( rcg, "("+ve+" + "+oe+")" );
+    }
+
+    string add_bias_then_maybe_relu( rtc_call_gen_t * rcg, dims_t const & work, uint32_t const & tx, uint32_t const ty,
+                                     string const & oe ) { 
       string const ve = strprintf( "(out_tile[%s] + filts_strip[%s])", str((ty*work.dsz("out_chan")+tx)).c_str(), str(tx).c_str() );
-      return maybe_add_relu( rcg, ve );
+      return maybe_add_res_then_relu( rcg, ve, oe );
     }    
 
     void gen_op_bconv( rtc_call_gen_t * rcg ) {
@@ -142,24 +158,45 @@ namespace boda
 	if( (i+1)*rcg->rtc_call_geom.tpb > filts_smem_sz ) { 
 	  rcg->line( "filts_smem_loads", "if( "+ixe+" < %(filts_smem_sz) ) {" );eif = "}";}
 	// note: load is (always) contiguous
-	rcg->line( "filts_smem_loads", strprintf("filts_smem[%s] = filts[filts_off+(%%(tpb)*%s)];%s",ixe.c_str(),str(i).c_str(),eif.c_str()) );
+	rcg->line( "filts_smem_loads", strprintf("filts_smem[%s] = load_float_from_rp_%%(filts_tn)( filts_off+(%%(tpb)*%s), filts );%s",
+                                                 ixe.c_str(),str(i).c_str(),eif.c_str()) );
       }
+      rcg->set( "out_chan_bias_smem_load_iter", str( u32_ceil_div( rcg->get_arg_dims_by_name("filts").dstride("x"), 
+                                                                    rcg->rtc_call_geom.tpb ) ) );
+      gen_out_chan_smem_loads( rcg, "biases_smem_loads", vect_pair_str_str{{"filts_smem","biases"}} );
+    }
+
+    // load the per-out-chan values of each var (second) for the current block's out chans into the smem array (first),
+    // in the same order as the out chans of the filts in smem.
+    void gen_out_chan_smem_loads( rtc_call_gen_t * rcg, string const & sn, vect_pair_str_str const & smem_vns ) {
       // number of out chans per block; note: == work_out_chan_tile_dim*work_out_chan_dim
       uint32_t const filts_x_stride = rcg->get_arg_dims_by_name("filts").dstride("x"); 
       uint32_t const out_chan_bias_smem_load_iter = u32_ceil_div( filts_x_stride, rcg->rtc_call_geom.tpb );
-      rcg->set( "out_chan_bias_smem_load_iter", str(out_chan_bias_smem_load_iter) );
 
-      rcg->line( "biases_smem_loads","int32_t ocix; int32_t const ocix_base = %(GRP_ID_1D_out_chan_blk)*%(filts_x_stride);" );
+      rcg->line( sn,"int32_t ocix; int32_t const ocix_base = %(GRP_ID_1D_out_chan_blk)*%(filts_x_stride);" );
       for( uint32_t i = 0; i != out_chan_bias_smem_load_iter; ++i ) {
 	string const ixe = "(LOC_ID_1D + %(tpb) * "+str(i)+")";
 	string eif;
-	rcg->line( "biases_smem_loads", strprintf( "ocix = ocix_base + (%s %%%% %%(work_out_chan_tile_dim))*%%(work_out_chan_dim) + ( %s / %%(work_out_chan_tile_dim) );", ixe.c_str(), ixe.c_str() ) );
+	rcg->line( sn, strprintf( "ocix = ocix_base + (%s %%%% %%(work_out_chan_tile_dim))*%%(work_out_chan_dim) + ( %s / %%(work_out_chan_tile_dim) );", ixe.c_str(), ixe.c_str() ) );
 	if( (i+1)*rcg->rtc_call_geom.tpb > filts_x_stride ) { 
-	  rcg->line( "biases_smem_loads", "if( "+ixe+" < %(filts_x_stride) ) {" );eif = "}";}
+	  rcg->line( sn, "if( "+ixe+" < %(filts_x_stride) ) {" );eif = "}";}
 	// note: load is (always) contiguous
-	rcg->line( "biases_smem_loads", strprintf("if( ocix < %%(biases_out_chan_dim) ) {filts_smem[%s] = biases[ocix];}%s",ixe.c_str(),eif.c_str()) );
+        for( vect_pair_str_str::const_iterator j = smem_vns.begin(); j != smem_vns.end(); ++j ) {
+          rcg->line( sn, strprintf("if( ocix < %%(%s_out_chan_dim) ) {%s[%s] = load_float_from_rp_%%(%s_tn)( ocix, %s );}%s",
+                                   j->second.c_str(), j->first.c_str(), ixe.c_str(), j->second.c_str(), j->second.c_str(),
+                                   (j+1 == smem_vns.end()) ? eif.c_str() : "") );
+        }
       }
+    }
 
+    // for grouped convs, blocks never straddle groups (see gbt_tile_t::align_n_blk_to_grp()), so we can get the group
+    // for a block from its out_chan_blk. returns an expression for that group, or an empty string for ungrouped convs.
+    string get_out_chan_blk_grp( rtc_call_gen_t * rcg, uint32_t const blk_out_chans ) {
+      uint32_t const groups = rcg->op.has("groups") ? rcg->op.get_u32("groups") : 1;
+      if( groups == 1 ) { return string(); }
+      uint32_t const grp_out_chans = rcg->get_arg_dims_by_name( "biases" ).dsz("out_chan") / groups;
+      assert_st( !(grp_out_chans % blk_out_chans) );
+      return strprintf( "(%%(GRP_ID_1D_out_chan_blk)/%s)", str(grp_out_chans/blk_out_chans).c_str() );
     }
 
     void gen_op_conv( rtc_call_gen_t * rcg ) {
@@ -180,6 +217,10 @@ namespace boda
 	insert_nda_ix_exprs( rcg->tsvs, "pel_ix_" + str(i), must_find(rcg->all_ix_dims,"out_pel_ix"),
 			     strprintf( "(%%(pel_tile)*%%(work_pels_dim)+%s)", str(i).c_str() ) );
       }
+      // note: filts in_chan is per-group, so for grouped convs we offset it to the first in chan of the block's group
+      string const grp = get_out_chan_blk_grp( rcg, filts.dstride("x") );
+      string const in_chan = grp.empty() ? "%(filts_ix_out_chan_elem_in_chan)" :
+        ( "("+grp+"*%(filts_in_chan_dim)+%(filts_ix_out_chan_elem_in_chan))" );
       string const get_in = strprintf( 
 	"float v = 0;\n"
 	"      int const smem_in_ix_y = %%(out_pel_ix_y)*%%(stride_y_dim)+%%(filts_ix_out_chan_elem_y) - %%(in_pad_y_dim);\n"
@@ -187,12 +228,11 @@ namespace boda
 	"      if(smem_in_ix_y >= 0 && smem_in_ix_x >= 0 && \n"
 	"          %%(out_pel_ix_img) < %%(in_img_dim) && \n"
 	"         smem_in_ix_x < %%(in_x_dim) && smem_in_ix_y < %%(in_y_dim) ) {\n"
-	"        v = in[%%(out_pel_ix_img)*%%(in_img_stride) +\n"
-	"          %%(filts_ix_out_chan_elem_in_chan)*%%(in_chan_stride) +\n"
+	"        v = load_float_from_rp_%%(in_tn)( %%(out_pel_ix_img)*%%(in_img_stride) +\n"
+	"          %s*%%(in_chan_stride) +\n"
 	"          smem_in_ix_y*%%(in_y_stride) +\n"
-	"          smem_in_ix_x*%%(in_x_stride)];\n" 
-	"      }"
-				       );
+	"          smem_in_ix_x*%%(in_x_stride), in );\n" 
+	"      }", in_chan.c_str() );
       rcg->set( "get_in", get_in );
       for( uint32_t tx = 0; tx != work.dsz( "out_chan" ); ++tx ) {
 	rcg->line( "loads", strprintf( "filts_strip[%s] = filts_smem[%%(LOC_ID_1D_out_chan_tile)+%s*%%(work_out_chan_tile_dim)];",
@@ -221,13 +261,40 @@ namespace boda
 	for( uint32_t tx = 0; tx != work.dsz( "out_chan" ); ++tx ) {
 	  rcg->line( "fmas", strprintf( "out_tile[%s] += filts_strip[%s]*in_strip[%s];", 
 					  str((ty*work.dsz( "out_chan" )+tx)).c_str(), str(tx).c_str(), str(ty).c_str() ) );
-	  rcg->line( "stores", strprintf( "if( tcix[%s] < (%%(out_chan_dim)*%%(out_chan_stride)) ) { out[ tpix[%s] + tcix[%s] ] = %s; }",
-					    str(tx).c_str(), str(ty).c_str(), str(tx).c_str(), 
-					  add_bias_then_maybe_relu(rcg,work,tx,ty).c_str() ) );
+	  string const oix = "tpix["+str(ty)+"] + tcix["+str(tx)+"]";
+	  string const oe = "load_float_from_rp_%(out_tn)( "+oix+", out )";
+	  rcg->line( "stores", strprintf( "if( tcix[%s] < (%%(out_chan_dim)*%%(out_chan_stride)) ) { "
+                                          "store_float_to_rp_%%(out_tn)( %s, %s, out ); }",
+					    str(tx).c_str(), add_bias_then_maybe_relu(rcg,work,tx,ty,oe).c_str(), oix.c_str() ) );
 	}
       }
     }
 
+    void gen_op_dwconv( rtc_call_gen_t * rcg ) {
+      dims_t const & work = rcg->get_arg_dims_by_name( "work" );
+      dims_t const & filts = rcg->get_arg_dims_by_name( "filts" );
+      dims_t const & out = rcg->get_arg_dims_by_name( "out" );
+      assert_st( filts.dsz("in_chan") == 1 );
+      uint32_t const groups = rcg->op.get_u32( "groups" );
+      assert_st( !(out.dsz("chan") % groups) );
+      rcg->set( "chans_per_grp", str(out.dsz("chan") / groups) );
+      uint32_t const stride_x = get_xy_dims( rcg->get_arg_dims_by_name( "stride" ) ).d[0];
+      rcg->set( "in_row_sz", str( (work.dsz("x")-1)*stride_x + filts.dsz("x") ) );
+      for( uint32_t kx = 0; kx != filts.dsz("x"); ++kx ) {
+        for( uint32_t tx = 0; tx != work.dsz("x"); ++tx ) {
+          rcg->line( "fmas", strprintf( "out_tile[%s] += filts_reg[ky*%%(filts_x_dim)+%s]*in_row[%s];",
+                                        str(tx).c_str(), str(kx).c_str(), str(tx*stride_x+kx).c_str() ) );
+        }
+      }
+      for( uint32_t tx = 0; tx != work.dsz("x"); ++tx ) {
+        string const oix = "out_ix_base + "+str(tx)+"*%(out_x_stride)";
+        string const oe = "load_float_from_rp_%(out_tn)( "+oix+", out )";
+        rcg->line( "stores", strprintf( "if( (out_x_base+%s) < %%(out_x_dim) ) { store_float_to_rp_%%(out_tn)( %s, %s, out ); }",
+                                        str(tx).c_str(), maybe_add_res_then_relu( rcg, "(out_tile["+str(tx)+"] + bias)", oe ).c_str(),
+                                        oix.c_str() ) );
+      }
+    }
+
     void gen_op_ipconv( rtc_call_gen_t * rcg ) {
       dims_t const & work = rcg->get_arg_dims_by_name( "work" );
       //dims_t const & filts = get_arg_dims_by_name( "filts" );
@@ -417,7 +484,7 @@ namespace boda
           }
         }
       }
-      gen_sgemm_write_out( rcg, 0 );
+      gen_sgemm_write_out( rcg, 0, "c", "" );
     }
 
     void gen_sgemm_sm_load( rtc_call_gen_t * rcg, string const & code_sec, string const & vn, uint64_t const & sm_sz,
@@ -479,13 +546,26 @@ namespace boda
       uint64_t const blk_N = work.dsz("Nb")*work.dsz("Nt");
       uint32_t const b_sm_sz = blk_N*work.dsz("Kb");
       gen_sgemm_sm_load( rcg, "sm_loads", "b", b_sm_sz, blk_N, rcg->get_arg_dims_by_name("b"), 1 );
-      
+      gen_sgemm_sm_inner_loop( rcg, "a_sm_off", "b_sm_off" );
+      dims_t const & c_dims = rcg->get_arg_dims_by_name("c");
+      assert( c_dims.tinfo().is_float );
+      bool const half_to_float = (c_dims.tsz() == 2);
+      assert( half_to_float || (c_dims.tsz() == 4) );
+      gen_sgemm_write_out( rcg, half_to_float, "c", "" );
+    }
+    // inner loop for sgemm-like ops that load blocks of a and b into shared memory (see gen_sgemm_sm_load())
+    void gen_sgemm_sm_inner_loop( rtc_call_gen_t * rcg, string const & a_sm_off, string const & b_sm_off ) {
+      dims_t const & work = rcg->get_arg_dims_by_name( "work" );
+      uint64_t const blk_M = work.dsz("Mb")*work.dsz("Mt");
+      uint64_t const blk_N = work.dsz("Nb")*work.dsz("Nt");
       for( uint32_t Kb = 0; Kb != work.dsz("Kb"); ++Kb ) {
 	for( uint32_t Mt = 0; Mt != work.dsz("Mt"); ++Mt ) {
-	  rcg->line( "inner_loop_body", strprintf( "a_r[%s] = a_sm_off[%s];", str(Mt).c_str(), str(Mt+Kb*blk_M).c_str()));
+	  rcg->line( "inner_loop_body", strprintf( "a_r[%s] = %s[%s];", str(Mt).c_str(), a_sm_off.c_str(), 
+                                                   str(Mt+Kb*blk_M).c_str()));
 	}
 	for( uint32_t Nt = 0; Nt != work.dsz("Nt"); ++Nt ) {
-	  rcg->line( "inner_loop_body", strprintf( "b_r[%s] = b_sm_off[%s];", str(Nt).c_str(), str(Nt+Kb*blk_N).c_str()));
+	  rcg->line( "inner_loop_body", strprintf( "b_r[%s] = %s[%s];", str(Nt).c_str(), b_sm_off.c_str(), 
+                                                   str(Nt+Kb*blk_N).c_str()));
 	  //rcg->line( "inner_loop_body", strprintf( "b_r[%s] = b[k*%%(b_K_stride)+thr_N+%s];", str(Nt).c_str(), str(Nt).c_str() ) );
 	}
 	for( uint32_t Mt = 0; Mt != work.dsz("Mt"); ++Mt ) {
@@ -496,13 +576,10 @@ namespace boda
           }
         }
       }
-      dims_t const & c_dims = rcg->get_arg_dims_by_name("c");
-      assert( c_dims.tinfo().is_float );
-      bool const half_to_float = (c_dims.tsz() == 2);
-      assert( half_to_float || (c_dims.tsz() == 4) );
-      gen_sgemm_write_out( rcg, half_to_float );
     }
-    void gen_sgemm_write_out( rtc_call_gen_t * rcg, bool const & half_to_float ) {
+    // c_vn is the output var; c_add (if non-empty) is an expression added to each output value.
+    void gen_sgemm_write_out( rtc_call_gen_t * rcg, bool const & half_to_float, string const & c_vn, 
+                              string const & c_add ) {
       dims_t const & work = rcg->get_arg_dims_by_name( "work" );
       rcg->line( "outs_to_b_r", "switch(Mt) { " );
       for( uint32_t Mt = 0; Mt != work.dsz("Mt"); ++Mt ) {
@@ -516,11 +593,231 @@ namespace boda
       rcg->line( "outs_to_b_r", "} " );
 
       // note: for this section, there will be a local 'Mt' in scope, used to adjust c_off each iteration
+      string const maybe_add = c_add.empty() ? "" : (" + " + c_add);
       for( uint32_t Nt = 0; Nt != work.dsz("Nt"); ++Nt ) {
         if( half_to_float ) {
-          rcg->line( "stores", strprintf( "vstore_half( b_r[%s], c_off+%s, c );", str(Nt).c_str(), str(Nt).c_str() ) );  
+          rcg->line( "stores", strprintf( "vstore_half( b_r[%s]%s, %s_off+%s, %s );", str(Nt).c_str(), maybe_add.c_str(),
+                                          c_vn.c_str(), str(Nt).c_str(), c_vn.c_str() ) );  
         } else {
-          rcg->line( "stores", strprintf( "c[c_off+%s] = b_r[%s];", str(Nt).c_str(), str(Nt).c_str() ) );  
+          rcg->line( "stores", strprintf( "%s[%s_off+%s] = b_r[%s]%s;", c_vn.c_str(), c_vn.c_str(), str(Nt).c_str(), 
+                                          str(Nt).c_str(), maybe_add.c_str() ) );  
+        }
+      }
+    }
+
+    // winograd F(m x m,3x3) xform matrices, row major: BT is a x a, G is a x 3, AT is m x a (where a = m + 2). see
+    // Lavin & Gray, "Fast Algorithms for Convolutional Neural Networks". note that for both supported m, column 1 of
+    // AT is all ones, so a value added to winograd-domain element (1,1) is added to every output pel of the tile.
+    void get_wconv_mats( uint32_t const & m, vect_double & BT, vect_double & G, vect_double & AT ) {
+      if( m == 2 ) {
+        BT = { 1, 0,-1, 0,
+               0, 1, 1, 0,
+               0,-1, 1, 0,
+               0, 1, 0,-1 };
+        G = { 1,    0,   0,
+              0.5,  0.5, 0.5,
+              0.5, -0.5, 0.5,
+              0,    0,   1 };
+        AT = { 1, 1, 1, 0,
+               0, 1,-1,-1 };
+      } else if( m == 4 ) {
+        BT = { 4, 0,-5, 0, 1, 0,
+               0,-4,-4, 1, 1, 0,
+               0, 4,-4,-1, 1, 0,
+               0,-2,-1, 2, 1, 0,
+               0, 2,-1,-2, 1, 0,
+               0, 4, 0,-5, 0, 1 };
+        G = { 1.0/4,   0,       0,
+              -1.0/6, -1.0/6,  -1.0/6,
+              -1.0/6,  1.0/6,  -1.0/6,
+              1.0/24,  1.0/12,  1.0/6,
+              1.0/24, -1.0/12,  1.0/6,
+              0,       0,       1 };
+        AT = { 1, 1, 1, 1, 1, 0,
+               0, 1,-1, 2,-2, 0,
+               0, 1, 1, 4, 4, 0,
+               0, 1,-1, 8,-8, 1 };
+      } else { rt_err( "unsupported wconv_m=" + str(m) ); }
+    }
+
+    // returns a sparse (zero terms omitted) float expression for sum_i(coeffs[i]*terms[i])
+    string wconv_lin_comb( vect_double const & coeffs, vect_string const & terms ) {
+      assert_st( coeffs.size() == terms.size() );
+      string ret;
+      for( uint32_t i = 0; i != coeffs.size(); ++i ) {
+        double const c = coeffs[i];
+        if( c == 0 ) { continue; }
+        ret += ret.empty() ? ( (c < 0) ? "-" : "" ) : ( (c < 0) ? " - " : " + " );
+        if( fabs(c) != 1 ) { 
+          string cs = strprintf( "%.9g", fabs(c) );
+          if( cs.find_first_of(".e") == string::npos ) { cs += ".0"; }
+          ret += cs + "f*";
+        }
+        ret += terms[i];
+      }
+      return ret.empty() ? "0.0f" : ( "(" + ret + ")" );
+    }
+
+    // emits (into code section sec) the computation of res = L * X * L^T, where L is rows x cols and X (named x_vn,
+    // row-major) is cols x cols. for each element of res, store_fmt (which should contain two %s's) is formatted with
+    // the element's index and value expression and emitted. tmp_vn is used to name the row-transformed temporaries.
+    void gen_wconv_xform( rtc_call_gen_t * rcg, string const & sec, vect_double const & L, uint32_t const & rows, 
+                          uint32_t const & cols, string const & x_vn, string const & tmp_vn, string const & store_fmt ) {
+      assert_st( L.size() == rows*cols );
+      for( uint32_t i = 0; i != rows; ++i ) { // tmp = L * X
+        for( uint32_t j = 0; j != cols; ++j ) {
+          vect_double coeffs; vect_string terms;
+          for( uint32_t k = 0; k != cols; ++k ) { 
+            coeffs.push_back( L[i*cols+k] ); terms.push_back( strprintf( "%s[%s]", x_vn.c_str(), str(k*cols+j).c_str() ) ); 
+          }
+          rcg->line( sec, strprintf( "float const %s_%s = %s;", tmp_vn.c_str(), str(i*cols+j).c_str(),
+                                     wconv_lin_comb( coeffs, terms ).c_str() ) );
+        }
+      }
+      for( uint32_t i = 0; i != rows; ++i ) { // res = tmp * L^T
+        for( uint32_t j = 0; j != rows; ++j ) {
+          vect_double coeffs; vect_string terms;
+          for( uint32_t k = 0; k != cols; ++k ) { 
+            coeffs.push_back( L[j*cols+k] ); terms.push_back( tmp_vn + "_" + str(i*cols+k) ); 
+          }
+          rcg->line( sec, strprintf( store_fmt.c_str(), str(i*rows+j).c_str(), wconv_lin_comb( coeffs, terms ).c_str() ) );
+        }
+      }
+    }
+
+    // same blocking and smem/register tiling as conv, but with int8 filts and in, and int32 accumulators. the epilogue
+    // scales the accumulators back to float using the per-out-chan filts_scale (see conv_pipe_fwd_t::set_i8conv_params()),
+    // and, if out is int8 (see conv_pipe_fwd_t::gen_i8conv_i8_out()), re-quantizes the results.
+    void gen_op_i8conv( rtc_call_gen_t * rcg ) {
+      dims_t const & work = rcg->get_arg_dims_by_name( "work" );
+      dims_t const & filts = rcg->get_arg_dims_by_name( "filts" );
+      uint32_t const filts_smem_sz = filts.dstride("x");
+      rcg->set( "filts_smem_sz", str(filts_smem_sz) );
+      uint32_t const out_chan_smem_load_iter = u32_ceil_div( filts_smem_sz, rcg->rtc_call_geom.tpb );    
+      for( uint32_t i = 0; i != out_chan_smem_load_iter; ++i ) {
+	string const ixe = "(LOC_ID_1D + %(tpb) * "+str(i)+")";
+	string eif;
+	if( (i+1)*rcg->rtc_call_geom.tpb > filts_smem_sz ) { 
+	  rcg->line( "filts_smem_loads", "if( "+ixe+" < %(filts_smem_sz) ) {" );eif = "}";}
+	rcg->line( "filts_smem_loads", strprintf("filts_smem[%s] = filts[filts_off+(%%(tpb)*%s)];%s",
+                                                 ixe.c_str(),str(i).c_str(),eif.c_str()) );
+      }
+      gen_out_chan_smem_loads( rcg, "epi_smem_loads", vect_pair_str_str{{"biases_smem","biases"},{"scale_smem","filts_scale"}} );
+      bool const out_i8 = (rcg->get_arg_dims_by_name( "out" ).tn == "int8_t");
+
+      rcg->set( "pel_smem_load_iter", str( u32_ceil_div( (work.dsz( "pels" ) * work.dsz( "pels_tile" )), rcg->rtc_call_geom.tpb ) ) );
+      rcg->set( "out_chan_tile", "(%(LOC_ID_1D_out_chan_tile)+%(GRP_ID_1D_out_chan_blk)*%(work_out_chan_tile_dim))");
+      rcg->set( "pel_tile", "(%(LOC_ID_1D_pels_tile)+%(GRP_ID_1D_pels_blk)*%(work_pels_tile_dim))");
+      rcg->set( "out_chan_ix","(%(out_chan_tile)*%(work_out_chan_dim))" );
+      for( uint32_t i = 0; i != work.dsz( "pels" ); ++i ) {
+	insert_nda_ix_exprs( rcg->tsvs, "pel_ix_" + str(i), must_find(rcg->all_ix_dims,"out_pel_ix"),
+			     strprintf( "(%%(pel_tile)*%%(work_pels_dim)+%s)", str(i).c_str() ) );
+      }
+      for( uint32_t tx = 0; tx != work.dsz( "out_chan" ); ++tx ) {
+        string const smix = strprintf( "%%(LOC_ID_1D_out_chan_tile)+%s*%%(work_out_chan_tile_dim)", str(tx).c_str() );
+	rcg->line( "loads", strprintf( "filts_strip[%s] = filts_smem[%s];", str(tx).c_str(), smix.c_str() ) );
+	rcg->line( "epi_loads", strprintf( "biases_strip[%s] = biases_smem[%s];", str(tx).c_str(), smix.c_str() ) );
+	rcg->line( "epi_loads", strprintf( "scale_strip[%s] = scale_smem[%s];", str(tx).c_str(), smix.c_str() ) );
+      }
+      for( uint32_t ty = 0; ty != work.dsz( "pels" ); ++ty ) {
+	rcg->line( "loads", strprintf( "in_strip[%s] = in_smem[%%(LOC_ID_1D_pels_tile)*%%(work_pels_dim)+%s];",
+					 str(ty).c_str(), str(ty).c_str() ) );
+      }
+      rcg->line( "stores", "int32_t tpix[%(work_pels_dim)];");
+      rcg->line( "stores", "int32_t tcix[%(work_out_chan_dim)];");
+      for( uint32_t ty = 0; ty != work.dsz( "pels" ); ++ty ) { 
+	rcg->line( "stores", strprintf( "tpix[%s] = %%(pel_ix_%s_img)*%%(out_img_stride) + "
+                                        "( %%(pel_ix_%s_x_nomod) %%%% (%%(out_y_dim)*%%(out_x_dim)) ); // cache out pel ixs ",
+                                        str(ty).c_str(), str(ty).c_str(), str(ty).c_str() ) );
+      }
+      for( uint32_t ty = 0; ty != work.dsz( "out_chan" ); ++ty ) { 
+	rcg->line( "stores", strprintf( "  tcix[%s] = (%%(out_chan_ix)+%s)*%%(out_chan_stride); // cache out chan ixs",
+                                        str(ty).c_str(), str(ty).c_str() ) );
+      }	
+      for( uint32_t ty = 0; ty != work.dsz( "pels" ); ++ty ) {
+	rcg->line( "stores", "if( %(pel_ix_"+str(ty)+"_x_nomod) >= %(pel_ix_0_dims_prod) ) { return; } "
+		     "// this pel and the following are off-the-end pels, so don't store them." );
+	for( uint32_t tx = 0; tx != work.dsz( "out_chan" ); ++tx ) {
+          string const otix = str(ty*work.dsz( "out_chan" )+tx);
+	  rcg->line( "fmas", strprintf( "out_tile[%s] += filts_strip[%s]*in_strip[%s];", otix.c_str(), str(tx).c_str(), str(ty).c_str() ) );
+          string const ve = strprintf( "(out_tile[%s]*scale_strip[%s] + biases_strip[%s])", otix.c_str(), str(tx).c_str(), str(tx).c_str() );
+          string oe = maybe_add_relu( rcg, ve );
+          if( out_i8 ) { oe = "(int8_t)min(127,max(-127,(int32_t)floor("+oe+"*%(out_inv_scale) + 0.5f)))"; }
+	  rcg->line( "stores", strprintf( "if( tcix[%s] < (%%(out_chan_dim)*%%(out_chan_stride)) ) { out[tpix[%s] + tcix[%s]] = %s; }",
+                                          str(tx).c_str(), str(ty).c_str(), str(tx).c_str(), oe.c_str() ) );
+	}
+      }
+    }
+
+    void gen_op_wconv( rtc_call_gen_t * rcg ) {
+      dims_t const & work = rcg->get_arg_dims_by_name( "work" );
+      uint32_t const a = rcg->op.get_u32( "wconv_m" ) + 2;
+      assert_st( work.dsz("xi") == a*a );
+      rcg->set( "wconv_bias_xi", str( 1*a + 1 ) ); // element (1,1); see get_wconv_mats()
+      uint64_t const blk_M = work.dsz("Mb")*work.dsz("Mt");
+      gen_sgemm_sm_load( rcg, "sm_loads", "filts", blk_M*work.dsz("Kb"), blk_M, rcg->get_arg_dims_by_name("filts"), 1 );
+      uint64_t const blk_N = work.dsz("Nb")*work.dsz("Nt");
+      gen_sgemm_sm_load( rcg, "sm_loads", "in", blk_N*work.dsz("Kb"), blk_N, rcg->get_arg_dims_by_name("in"), 1 );
+      gen_sgemm_sm_inner_loop( rcg, "filts_sm_off", "in_sm_off" );
+      gen_sgemm_write_out( rcg, 0, "out", "bias" );
+    }
+
+    void gen_op_wconv_xpose_filts( rtc_call_gen_t * rcg ) {
+      vect_double BT, G, AT;
+      uint32_t const m = rcg->op.get_u32( "wconv_m" );
+      get_wconv_mats( m, BT, G, AT );
+      for( uint32_t ky = 0; ky != 3; ++ky ) {
+        for( uint32_t kx = 0; kx != 3; ++kx ) {
+          rcg->line( "filts_loads", strprintf( "g[%s] = valid ? g_ref[%s*%%(filts_ref_y_stride)+%s*%%(filts_ref_x_stride)] : 0.0f;",
+                                               str(ky*3+kx).c_str(), str(ky).c_str(), str(kx).c_str() ) );
+        }
+      }
+      gen_wconv_xform( rcg, "filts_xform", G, m+2, 3, "g", "gt", "u_out[%s*%%(filts_xi_stride)] = %s;" );
+    }
+
+    void gen_op_wconv_xpose_in( rtc_call_gen_t * rcg ) {
+      vect_double BT, G, AT;
+      uint32_t const m = rcg->op.get_u32( "wconv_m" );
+      uint32_t const a = m + 2;
+      get_wconv_mats( m, BT, G, AT );
+      rcg->set( "wconv_a", str(a) );
+      for( uint32_t dy = 0; dy != a; ++dy ) {
+        rcg->line( "in_loads", strprintf( "int32_t const iy_%s = iy_base + %s;", str(dy).c_str(), str(dy).c_str() ) );
+        rcg->line( "in_loads", strprintf( "bool const iy_%s_ok = valid && (iy_%s >= 0) && (iy_%s < %%(in_ref_y_dim));", 
+                                          str(dy).c_str(), str(dy).c_str(), str(dy).c_str() ) );
+      }
+      for( uint32_t dx = 0; dx != a; ++dx ) {
+        rcg->line( "in_loads", strprintf( "int32_t const ix_%s = ix_base + %s;", str(dx).c_str(), str(dx).c_str() ) );
+        rcg->line( "in_loads", strprintf( "bool const ix_%s_ok = (ix_%s >= 0) && (ix_%s < %%(in_ref_x_dim));", 
+                                          str(dx).c_str(), str(dx).c_str(), str(dx).c_str() ) );
+      }
+      for( uint32_t dy = 0; dy != a; ++dy ) {
+        for( uint32_t dx = 0; dx != a; ++dx ) {
+          rcg->line( "in_loads", strprintf( "d[%s] = (iy_%s_ok && ix_%s_ok) ? "
+                                            "d_ref[iy_%s*%%(in_ref_y_stride)+ix_%s*%%(in_ref_x_stride)] : 0.0f;",
+                                            str(dy*a+dx).c_str(), str(dy).c_str(), str(dx).c_str(),
+                                            str(dy).c_str(), str(dx).c_str() ) );
+        }
+      }
+      gen_wconv_xform( rcg, "in_xform", BT, a, a, "d", "dt", "v_out[%s*%%(in_xi_stride)] = %s;" );
+    }
+
+    void gen_op_wconv_xpose_out( rtc_call_gen_t * rcg ) {
+      vect_double BT, G, AT;
+      uint32_t const m = rcg->op.get_u32( "wconv_m" );
+      uint32_t const a = m + 2;
+      get_wconv_mats( m, BT, G, AT );
+      rcg->set( "wconv_a", str(a) );
+      for( uint32_t xi = 0; xi != a*a; ++xi ) {
+        rcg->line( "out_loads", strprintf( "o[%s] = o_in[%s*%%(out_xi_stride)];", str(xi).c_str(), str(xi).c_str() ) );
+      }
+      gen_wconv_xform( rcg, "out_xform", AT, m, a, "o", "ot", "float const y_%s = %s;" );
+      for( uint32_t dy = 0; dy != m; ++dy ) {
+        for( uint32_t dx = 0; dx != m; ++dx ) {
+          string const oe = "y_out[(oy_base+"+str(dy)+")*%(out_ref_y_stride)+(ox_base+"+str(dx)+")*%(out_ref_x_stride)]";
+          rcg->line( "out_xform", strprintf( "if( ((oy_base+%s) < %%(out_ref_y_dim)) && ((ox_base+%s) < %%(out_ref_x_dim)) ) { "
+                                             "%s = %s; }", str(dy).c_str(), str(dx).c_str(), oe.c_str(),
+                                             maybe_add_res_then_relu( rcg, "y_"+str(dy*m+dx), oe ).c_str() ) );
         }
       }
     }
@@ -653,6 +950,19 @@ namespace boda
       uint32_t const all_smem_sz = std::max( out_smem_sz, filts_smem_sz+in.dstride("blk_iter") ); // note: %(in_blk_iter_sz) == in_smem_sz
       rcg->set( "all_smem_sz", str(all_smem_sz) );
 
+      // for grouped convs, each block iterates over only the blk_iters of in chans for its group. note: the
+      // annotations ensure that the # of in chans per group is a multiple of in_blk_iter_chan_dim.
+      string const grp = get_out_chan_blk_grp( rcg, filts.dstride("x") );
+      uint32_t grp_in_blk_iter_dim = in.dsz("blk_iter");
+      string grp_in_off;
+      if( !grp.empty() ) {
+        assert_st( !(filts.dsz("in_chan") % in.dsz("blk_iter_chan")) );
+        grp_in_blk_iter_dim = filts.dsz("in_chan") / in.dsz("blk_iter_chan");
+        grp_in_off = " + "+grp+"*"+str(grp_in_blk_iter_dim)+"*%(in_blk_iter_stride)";
+      }
+      rcg->set( "grp_in_blk_iter_dim", str(grp_in_blk_iter_dim) );
+      rcg->set( "grp_in_off", grp_in_off );
+
       // generate smem loads
       gen_filts_smem_loads( rcg, filts_smem_sz );
       uint32_t const in_smem_load_iter = u32_ceil_div( in.dstride("blk_iter"), rcg->rtc_call_geom.tpb );    
@@ -697,7 +1007,7 @@ namespace boda
 	  rcg->line( "stores", "  BARRIER_SYNC;" );
 	  for( uint32_t ty = 0; ty != work.dsz("pels"); ++ty ) { // out_tile[] (registers) -> all_smem[]
 	    rcg->line( "stores", strprintf( "out_smem_off[%%(tpb)*%s] = %s;", str(ty).c_str(), 
-					    add_bias_then_maybe_relu(rcg,work,tx,ty).c_str() ) );
+					    add_bias_then_maybe_relu(rcg,work,tx,ty,"").c_str() ) );
 	  }
 	  rcg->line( "stores", "  BARRIER_SYNC;" );
 	  for( uint32_t ty = 0; ty != work.dsz("pels"); ++ty ) { // all_smem[] -> [xpbuf[] (registers)] -> out[] (global)
@@ -738,17 +1048,16 @@ namespace boda
 	  rcg->line( "stores", "  if( %(out_pel_"+str(ty)+"_img) >= %(out_img_dim) ) { return; } "
 		       "// this pel and the following are off-the-end pels, so don't store them." );
 	  for( uint32_t tx = 0; tx != work.dsz("out_chan"); ++tx ) {
-	    rcg->line( "stores", strprintf( "if( tcix[%s] < (%%(out_chan_dim)*%%(out_chan_stride)) ) { out[ tpix[%s] + tcix[%s] ] = %s; }",
-					      str(tx).c_str(), str(ty).c_str(), str(tx).c_str(), 
-					    add_bias_then_maybe_relu(rcg,work,tx,ty).c_str() ) );
+	    string const oe = "out[ tpix["+str(ty)+"] + tcix["+str(tx)+"] ]";
+	    rcg->line( "stores", strprintf( "if( tcix[%s] < (%%(out_chan_dim)*%%(out_chan_stride)) ) { %s = %s; }",
+					      str(tx).c_str(), oe.c_str(), add_bias_then_maybe_relu(rcg,work,tx,ty,oe).c_str() ) );
 	  }
 	}
       }
       for( uint32_t ty = 0; ty != work.dsz("pels"); ++ty ) {
 	for( uint32_t tx = 0; tx != work.dsz("out_chan"); ++tx ) {
-	  rcg->line( "dummy_stores", strprintf( "out_off[%s] = %s;", 
-						  str((ty*work.dsz("out_chan")+tx)*rcg->rtc_call_geom.tpb).c_str(), 
-						add_bias_then_maybe_relu(rcg,work,tx,ty).c_str() ) );
+	  string const oe = "out_off["+str((ty*work.dsz("out_chan")+tx)*rcg->rtc_call_geom.tpb)+"]";
+	  rcg->line( "dummy_stores", strprintf( "%s = %s;", oe.c_str(), add_bias_then_maybe_relu(rcg,work,tx,ty,oe).c_str() ) );
 	}
       }
       for( uint32_t tx = 0; tx != work.dsz("out_chan"); ++tx ) {
@@ -823,15 +1132,15 @@ namespace boda
 	rcg->line( "stores", "if( (out_x + "+str(ty)+") >= %(out_x_dim) ) { return; } "
 		     "// this x value and the following are off-the-end pels, so don't store them." );
 	for( uint32_t tx = 0; tx != work.dsz("out_chan"); ++tx ) {
+	  string const oe = "out_off[ "+str(tx)+"*%(out_chan_stride) + "+str(ty)+"*%(out_x_stride) ]";
 #if 1
-	  string const ve = add_bias_then_maybe_relu(rcg,work,tx,ty);
+	  string const ve = add_bias_then_maybe_relu(rcg,work,tx,ty,oe);
 
 #else
 	  string const ve = strprintf( "(filts_strip[%s])", str(tx).c_str() );
 #endif
-	  rcg->line( "stores", strprintf( "if( (out_chan + %s) < %%(out_chan_dim) ) { "
-						   "out_off[ %s*%%(out_chan_stride) + %s*%%(out_x_stride) ] = %s; }",
-						   str(tx).c_str(), str(tx).c_str(), str(ty).c_str(), ve.c_str() ) );
+	  rcg->line( "stores", strprintf( "if( (out_chan + %s) < %%(out_chan_dim) ) { %s = %s; }",
+						   str(tx).c_str(), oe.c_str(), ve.c_str() ) );
 	}
       }
     }
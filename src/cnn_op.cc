@@ -22,6 +22,8 @@ namespace boda
     bool const enable_k1conv = op_tune->k1conv;
     bool const enable_tconv = op_tune->tconv;
     bool const force_enable_tconv = (op_tune->tconv==2);
+    bool const enable_wconv = op_tune->wconv;
+    bool const force_enable_wconv = (op_tune->wconv==2);
     dims_t ni_dims;
     dims_t no_dims = op->get_dims( op->coi->top_an(0) );
     u32_pt_t const no_sz = get_xy_dims( no_dims );
@@ -43,11 +45,28 @@ namespace boda
 	else { assert_st(0); }
 	op->set_dims("kern_sz", dims_t{ {kern_sz_.d[1],kern_sz_.d[0]}, {"y","x"}, "none" } ); // FIXME: not ideal ...
       } 
+      uint32_t const groups = is_conv ? op->groups() : 1;
       if( is_conv ) { // set func_name (aka variant) for conv case (others are set at bottom)
-        if( op_tune->use_culibs ) { 
+        if( groups > 1 ) {
+          // grouped case: we support the dwconv variant for depthwise convs (one input chan per group), and the
+          // grouped forms of k1conv and conv (where each block of output chans lies inside a single group).
+          if( op_tune->use_culibs || op_tune->i8conv ) { unsup_err( "grouped convs are not supported with use_culibs=1 or i8conv=1" ); }
+          uint32_t const in_chans_per_grp = op->get_dims("filts").dsz("in_chan");
+          if( op_tune->dwconv && (in_chans_per_grp == 1) ) { op->set_func_name( dwconv_str ); }
+          else if( enable_k1conv && (kern_sz_ == u32_pt_t{1,1}) && (op->stride() == u32_pt_t{1,1}) && op->in_pad().is_zeros()
+                   && (no_sz.d[0] >= 6) && (no_sz.d[0] <= 300 ) && (no_dims.dsz("chan") >= 64)
+                   && (op_tune->use_local_mem != 2) && ((in_chans_per_grp % op_tune->Kb) == 0) ) {
+            op->set_func_name( k1conv_str ); // note: blk_iter (Kb in chans) must not straddle groups
+          } else { op->set_func_name( conv_str ); }
+        } else if( op_tune->use_culibs ) { 
           op->set_func_name("cudnn_conv");
+        } else if( op_tune->i8conv ) {
+          op->set_func_name( i8conv_str ); // int8 case; handles all conv geometries
         } else if( enable_ipconv && op->in_pad().is_zeros() && (get_xy_dims(no_dims) == u32_pt_t{1,1}) ) {
           op->set_func_name( ipconv_str ); // single output per-chan-per-image: inner-product case
+        } else if( enable_wconv && (kern_sz_ == u32_pt_t{3,3}) && (op->stride() == u32_pt_t{1,1}) &&
+                   (force_enable_wconv || ((ni_dims.dsz("chan") >= 8) && (no_dims.dsz("chan") >= 32))) ) {
+          op->set_func_name( wconv_str ); // winograd case
         } else if( enable_k1conv && (kern_sz_ == u32_pt_t{1,1}) && (op->stride() == u32_pt_t{1,1}) 
                    && (no_sz.d[0] >= 6) && (no_sz.d[0] <= 300 ) && (no_dims.dsz("chan") >= 64) ) 
         { 
@@ -139,7 +158,14 @@ namespace boda
                                        vect_string{"img","y","x"}, "none" ));
 
       }
-      if( is_conv && (op->get_func_name() != "cudnn_conv") ) { // skip blocking setup for cudnn_conv
+      if( is_conv && (op->get_func_name() == dwconv_str) ) {
+        // dwconv: each thread computes a run of (up to) MNt.d[0] output pels along x for a single img:chan:y, with the
+        // filter (which has a single in_chan) held in registers. filts, in, and out are all in their standard formats.
+        uint32_t const x_run = std::min( t_tile_sz.d[0], no_sz.d[0] );
+        op->set_dims("work",dims_t( vect_uint32_t{ no_dims.dsz("img"), no_dims.dsz("chan"), no_sz.d[1],
+                u32_ceil_div( no_sz.d[0], x_run ), x_run }, vect_string{"img","chan","y","blk_x","x"}, "none" ));
+      }
+      if( is_conv && (op->get_func_name() != "cudnn_conv") && (op->get_func_name() != dwconv_str) ) { // skip blocking setup for cudnn_conv and dwconv
         // 'standard' and desired/xformed filter dims. we don't currently xform the biases (although maybe we should).
         op->set_dims("filts_ref",op->get_dims("filts"));
 
@@ -149,6 +175,7 @@ namespace boda
 	assert_st( pels_sz * no_dims.dsz("chan") == out_ix_sz ); // by construction
 	gbt_tile_t gbt;
 	gbt.init( t_tile_sz, max_tpb, u32_pt_t( pels_sz, no_dims.dsz("chan") ) );
+	if( groups > 1 ) { gbt.align_n_blk_to_grp( max_tpb, no_dims.dsz("chan") / groups ); } // blocks must not straddle groups
 	dims_t work;
         work.tn = "none";
 	uint32_t const lines_sz = no_dims.dsz("img") * no_sz.d[1];
@@ -289,6 +316,39 @@ namespace boda
             vect_string{"in_chan","y","x","out_chan"}, op->get_dims("filts").tn )); 
 	  op->reset_dims("out",dims_t( vect_uint32_t{ out_chan_pad, pels_sz_pad }, vect_string{"chan","pel"}, 
                                      op->get_dims("out").tn )); 
+        } else if( op->get_func_name() == wconv_str ) {
+          // winograd F(m x m,3x3): each m x m tile of output is computed from an a x a (a=m+2) tile of input. the
+          // filts, in, and out are xformed to/from the winograd domain, where the conv becomes a batch of a*a
+          // independent gemms (one per winograd-domain element xi) of (out_chan x in_chan) * (in_chan x tiles). the
+          // gemm dims are zero-padded to multiples of the usual sgemm blocking (MNt/MNb/Kb).
+          uint32_t const m = op_tune->wconv_m;
+          if( (m != 2) && (m != 4) ) { rt_err( strprintf( "unsupported wconv_m=%s; must be 2 or 4", str(m).c_str() ) ); }
+          op->set_u32( "wconv_m", m );
+          uint32_t const a = m + 2;
+          u32_pt_t const tiles_xy = ceil_div( no_sz, u32_pt_t{m,m} );
+          op->set_dims("wconv_tiles",dims_t( vect_uint32_t{ no_dims.dsz("img"), tiles_xy.d[1], tiles_xy.d[0] },
+                                             vect_string{"img","y","x"}, "none" ));
+          uint32_t const M_blk = op_tune->MNb.d[0] * op_tune->MNt.d[0];
+          uint32_t const N_blk = op_tune->MNb.d[1] * op_tune->MNt.d[1];
+          uint32_t const M_pad = u32_ceil_align( no_dims.dsz("chan"), M_blk );
+          uint32_t const N_pad = u32_ceil_align( op->get_dims("wconv_tiles").dims_prod(), N_blk );
+          uint32_t const K_pad = u32_ceil_align( ni_dims.dsz("chan"), op_tune->Kb );
+          work = dims_t( vect_uint32_t{ a*a, M_pad/M_blk, N_pad/N_blk, op_tune->MNb.d[0], op_tune->MNb.d[1], op_tune->Kb,
+                op_tune->MNt.d[0], op_tune->MNt.d[1] }, vect_string{"xi","Mg","Ng","Mb","Nb","Kb","Mt","Nt"}, "none" );
+          in_dims = dims_t( vect_uint32_t{ a*a, K_pad, N_pad }, vect_string{"xi","K","N"}, in_dims.tn ); 
+	  op->reset_dims("filts",dims_t( vect_uint32_t{ a*a, K_pad, M_pad }, vect_string{"xi","K","M"}, 
+                                         op->get_dims("filts").tn )); 
+	  op->reset_dims("out",dims_t( vect_uint32_t{ a*a, M_pad, N_pad }, vect_string{"xi","M","N"}, 
+                                       op->get_dims("out").tn )); 
+        } else if( op->get_func_name() == i8conv_str ) {
+          // same layouts and blocking as conv, but int8 filts/in. the per-out-chan filts_scale (which includes the
+          // scale of in) converts the int32 accumulators back to float.
+          in_dims.tn = "int8_t";
+          dims_t filts_i8 = op->get_dims("filts");
+          filts_i8.tn = "int8_t";
+          op->reset_dims("filts",filts_i8);
+          op->set_dims("filts_scale",dims_t( vect_uint32_t{ no_dims.dsz("chan") }, vect_string{"out_chan"}, "float" ));
+          op->set_dims("out_inv_scale",make_scalar_dims_t("float")); // used only if out is int8; see conv_pipe_fwd_t
         }
 	op->set_dims("work",work);
 	// k1conv and in_tile_xpose need the standard output dims for reference. curently this == the dims of "out",
@@ -301,8 +361,9 @@ namespace boda
 	// we do this, we may change the binding for "in" (e.g. to point to an xformed version of the original
 	// variable).
         op->reset_dims("in",in_dims); 
-        if( is_k1_or_t_or_reg_conv( op->get_func_name() ) ) {
-          op->reset_dims("filts",dims_t( vect_uint32_t{ work.dsz("out_chan_blk"),ni_dims.dsz("chan"), 
+        if( is_k1_or_t_or_reg_conv( op->get_func_name() ) || (op->get_func_name() == i8conv_str) ) {
+          // note: filts in_chan is the # of in chans per group (== ni_dims.dsz("chan") for ungrouped convs)
+          op->reset_dims("filts",dims_t( vect_uint32_t{ work.dsz("out_chan_blk"),op->get_dims("filts_ref").dsz("in_chan"), 
                   kern_sz_.d[1], kern_sz_.d[0],
                   work.dsz("out_chan"),work.dsz("out_chan_tile")}, vect_string{"out_chan_blk","in_chan","y","x",
                                                                        "out_chan_reg","out_chan_tile"}, 
@@ -316,6 +377,7 @@ namespace boda
     else if( op->is( Concat_coi ) ) { op->set_func_name( "copy" ); }
     else if( op->is( Split_coi ) ) { op->set_func_name( "split_copy" ); }
     else if( op->is( Reduce_coi ) ) { op->set_func_name( "reduce" ); }
+    else if( op->is( Eltwise_coi ) ) { if( op->get_u32( "elt_op" ) == 1 ) { op->set_func_name( "reduce" ); } } // SUM only
     else if( op->is( Pooling_coi ) ) { op->set_func_name( "pool" ); }
     // else if( op->is( Convolution_coi ) ) { } // selected above already
     else if( op->is( ReLU_coi ) ) { op->set_func_name( "relu" ); }
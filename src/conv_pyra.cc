@@ -16,6 +16,7 @@
 
 #include"asio_util.H"
 #include"anno_util.H"
+#include<mutex>
 
 namespace boda 
 {
@@ -44,24 +45,35 @@ namespace boda
     p_img_t feat_img; 
     p_asio_fd_t cap_afd;
     disp_win_t disp_win;
-
-    void on_cap_read( error_code const & ec ) { 
+    p_cap_proc_thread_t proc_thread; // if capture->cap_thread, runs proc_frame() on its own thread
+    // protects cnet_predict, which (if proc_thread) is used on both the proc and display threads. held by pointer, as
+    // std::mutex isn't copyable, but NESI structs must be.
+    shared_ptr< std::mutex > pred_mut;
+
+    // resample, pack, and run the net on a captured frame, and return a function to display the results. if
+    // proc_thread, this runs on the proc thread, and the returned function on the display thread.
+    disp_func_t proc_frame( p_img_t const & cap_img ) {
       timer_t t("conv_pyra_frame_proc");
-      if( num_frames ) { --num_frames; if( !num_frames ) { disp_win.done = 1; } }
-      assert_st( !ec );
-      capture->on_readable( 1 );
-      p_img_t ds_img = resample_to_size( capture->cap_img, ipp->in_sz );
-      in_img->share_pels_from( ds_img );
-      ipp->scale_and_pack_img_into_bins( in_img );
+      p_img_t ds_img = resample_to_size( cap_img, ipp->in_sz );
+      std::lock_guard< std::mutex > lock( *pred_mut );
+      ipp->scale_and_pack_img_into_bins( ds_img );
       for( uint32_t bix = 0; bix != ipp->bin_imgs.size(); ++bix ) {
 	subtract_mean_and_copy_img_to_batch( cnet_predict->in_batch, bix, ipp->bin_imgs[bix] );
       }
       p_nda_float_t out_batch = cnet_predict->run_one_blob_in_one_blob_out();
       p_nda_float_t out_batch_upsamp;
       if( cnet_predict->enable_upsamp_net ) { out_batch_upsamp = cnet_predict->run_one_blob_in_one_blob_out_upsamp(); }
+      p_vect_anno_t new_img_annos;
+      if( !disp_feats ) { new_img_annos = cnet_predict->do_predict( out_batch, out_batch_upsamp, 0 ); }
+      return [this,ds_img,out_batch,new_img_annos]{ disp_frame( ds_img, out_batch, new_img_annos ); };
+    }
+
+    void disp_frame( p_img_t const & ds_img, p_nda_float_t const & out_batch, p_vect_anno_t const & new_img_annos ) {
+      if( num_frames ) { --num_frames; if( !num_frames ) { disp_win.done = 1; } }
+      in_img->share_pels_from( ds_img );
       if( !disp_feats ) {
 	feat_annos->clear();
-	img_annos = cnet_predict->do_predict( out_batch, out_batch_upsamp, 0 );
+	img_annos = new_img_annos;
 	setup_annos();
       }
       if( disp_feats ) {
@@ -75,6 +87,11 @@ namespace boda
 	else { copy_batch_to_img( out_batch, 0, feat_img, u32_box_t{} ); }
       }
       disp_win.update_disp_imgs();
+    }
+
+    void on_cap_read( error_code const & ec ) { 
+      assert_st( !ec );
+      if( capture->on_readable( 1 ) ) { proc_frame( capture->cap_img )(); }
       setup_capture_on_read( *cap_afd, &conv_pyra_t::on_cap_read, this );
     }
 
@@ -95,6 +112,7 @@ namespace boda
     } 
     
     void feat_pyra_anno_for_xy( uint32_t const bix, u32_pt_t const & pyra_img_xy ) {
+      std::lock_guard< std::mutex > lock( *pred_mut );
       feat_annos->clear();
       img_annos->clear();
       u32_pt_t const pyra_xy = floor_div_u32( pyra_img_xy, cnet_predict->get_ceil_sqrt_out_chans(0) );
@@ -116,6 +134,7 @@ namespace boda
 
     virtual void main( nesi_init_arg_t * nia ) { 
       timer_t t("conv_prya_top");
+      pred_mut = make_shared< std::mutex >();
       // create temp net just to get output support size info, for use in determining padding and such for the image pyramid plane packing
       // minimal code using default/current in_dims to create a temporary conv_pipe_t and get the input size and output conv support info. this
       // replaces the need to be able to adjust in_dims_img after setup in the conv_prya use-case. note: add_bck_ops is asserted and hard-coded to
@@ -156,9 +175,16 @@ namespace boda
 
       io_service_t & io = get_io( &disp_win );
       capture->cap_start();
-      cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
-      setup_capture_on_read( *cap_afd, &conv_pyra_t::on_cap_read, this );
+      if( capture->cap_thread ) {
+	proc_thread.reset( new cap_proc_thread_t( capture.get(), [&io]( disp_func_t const & f ) { io.post( f ); },
+						  [this]( p_cap_frame_t const & f ) { return proc_frame( capture->frame_img( f ) ); } ) );
+      } else {
+	cap_afd.reset( new asio_fd_t( io, ::dup(capture->get_fd() ) ) );
+	setup_capture_on_read( *cap_afd, &conv_pyra_t::on_cap_read, this );
+      }
       io.run();
+      capture->cap_stop(); // note: must precede proc_thread.reset(), as it stops the proc thread's frame source.
+      proc_thread.reset();
     }
 
     p_vect_anno_t feat_annos;
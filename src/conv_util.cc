@@ -34,8 +34,8 @@ namespace boda
   conv_op_info_t const Convolution_coi{ "Convolution", { "in", "filts", "biases" }, { "out" }, DefaultConvolutionVals };
   conv_op_info_t const Deconvolution_coi{ "Deconvolution", { "in", "filts", "biases" },{ "out" }, DefaultConvolutionVals };
   conv_op_info_t const ReLU_coi{ "ReLU", {"in"}, {"out"} };
-  conv_op_info_t const Scale_coi{ "Scale", {"in"}, {"out"} };
-  conv_op_info_t const BatchNorm_coi{ "BatchNorm", {"in"}, {"out"} };
+  conv_op_info_t const Scale_coi{ "Scale", {"in"}, {"out"}, {{"bias_term",make_scalar_nda<uint32_t>(0)}} };
+  conv_op_info_t const BatchNorm_coi{ "BatchNorm", {"in"}, {"out"}, {{"eps",make_scalar_nda(1e-5f)}} };
   conv_op_info_t const Dropout_coi{ "Dropout", {"in"}, {"out"}, {{"dropout_ratio",make_scalar_nda(0.5f)}} };
   conv_op_info_t const BckDropout_coi{ "BckDropout", {"in"}, {"out"}, {{"dropout_ratio",make_scalar_nda(0.5f)}} };
 
@@ -53,7 +53,7 @@ namespace boda
   conv_op_info_t const SoftmaxWithLoss_coi{ "SoftmaxWithLoss", { "in", "label" },{ "in_grad_loss", "loss" } };
   conv_op_info_t const Data_coi{ "Data", {}, {"out"} }; // note: no inputs / source
   conv_op_info_t const Concat_coi{ "Concat", {"ins"}, {"out"}, {}, zi_bool(1) };
-  conv_op_info_t const Eltwise_coi{ "Eltwise", {"ins"}, {"out"}, {}, zi_bool(1) };
+  conv_op_info_t const Eltwise_coi{ "Eltwise", {"ins"}, {"out"}, {{"elt_op",make_scalar_nda<uint32_t>(1)}}, zi_bool(1) }; // elt_op: 0=PROD,1=SUM,2=MAX
   conv_op_info_t const Reduce_coi{ "Reduce", {"ins"}, {"out"}, {}, zi_bool(1) };
   conv_op_info_t const Split_coi{ "Split", {"in"}, {"outs"}, {}, zi_bool(0), zi_bool(1) };
   conv_op_info_t const InnerProduct_coi{ "InnerProduct", {"in"}, {"out"}, {{"out_chans",make_scalar_nda<uint32_t>(0)}} };
@@ -156,6 +156,9 @@ namespace boda
 	if( is( Convolution_coi ) || is( Pooling_coi ) ) { continue; } // okay to be present for these types
 	if( is( BckConv_coi ) || is( Spreading_coi ) ) { continue; } // okay to be present for these types
       }
+      // groups (as per caffe's group param) is optional for Convolution, and is only set when != 1. similarly to
+      // kern_sz, there's no default, so we manually check here.
+      if( (i->first == "groups") && is( Convolution_coi ) ) { continue; }
       if( !boda::has( coi->nda_vals, i->first ) ) { 
 	rt_err( strprintf( "Unknown/invalid/extra nda/dims parameter '%s' for operation of type '%s'.",
 			   i->first.c_str(), str(coi->type).c_str() ) );
@@ -355,6 +358,28 @@ namespace boda
 	}
 	csi_out.eff_tot_pad.max_eq( csi_in.eff_tot_pad );
       }
+    } else if( cop->is( Eltwise_coi ) ) {
+      // the support of each output is the union of the supports of the inputs, which must all have the same stride. as
+      // each input's support starts at -eff_tot_pad, the union starts at -(max eff_tot_pad), and ends at the max
+      // (support_sz - eff_tot_pad).
+      assert_st( cop->has_one_top() );
+      i32_pt_t support_end;
+      bool all_input = 0; // if any input uses all of the input (i.e. global pooling), so does the output
+      for( vect_string::const_iterator j = cop->bots.begin(); j != cop->bots.end(); ++j ) {
+	conv_support_info_t const & csi_in = must_get_node(*j)->csi;
+	if( !csi_in.valid() ) {  rt_err( "calc_support_info(): needed input support info for node not set. node name: " + str(*j) ); }
+	if( j == cop->bots.begin() ) {
+	  csi_out.support_stride = csi_in.support_stride;
+	  support_end = u32_to_i32( csi_in.support_sz ) - u32_to_i32( csi_in.eff_tot_pad );
+	} else {
+	  if( csi_in.support_stride != csi_out.support_stride ) {
+	    rt_err( "calc_support_info(): unhandled Eltwise layer '"+cop->tag+"' with different strided inputs" ); }
+	  support_end.max_eq( u32_to_i32( csi_in.support_sz ) - u32_to_i32( csi_in.eff_tot_pad ) );
+	}
+	if( csi_in.support_sz.is_zeros() ) { all_input = 1; }
+	csi_out.eff_tot_pad.max_eq( csi_in.eff_tot_pad );
+      }
+      csi_out.support_sz = all_input ? u32_pt_t{} : i32_to_u32( support_end + u32_to_i32( csi_out.eff_tot_pad ) );
     } else {    
       assert_st( cop->has_one_top() );
       if( !cop->is( Convolution_coi ) ) { 
@@ -479,7 +504,14 @@ namespace boda
 	u32_pt_t kern_sz = cop->kern_sz();
 	if( kern_sz.is_zeros() ) { kern_sz = get_xy_dims( j_node->dims ); } // 'global' input special case
         string const & filts_bias_tn = j_node->dims.tn; // assume same type as input for filts/bias
-	dims_t filts_dims( vect_uint32_t{ cop->get_u32("out_chans"), j_node->dims.dsz("chan"), kern_sz.d[1], kern_sz.d[0] },
+	// for grouped convs, each group of out_chans/groups output chans sees only in_chans/groups input chans
+	uint32_t const groups = cop->groups();
+	if( !groups || (j_node->dims.dsz("chan") % groups) || (cop->get_u32("out_chans") % groups) ) {
+	  rt_err( strprintf( "conv layer %s: groups=%s must divide both the # of input chans (%s) and output chans (%s)",
+			     cop->tag.c_str(), str(groups).c_str(), str(j_node->dims.dsz("chan")).c_str(),
+			     str(cop->get_u32("out_chans")).c_str() ) );
+	}
+	dims_t filts_dims( vect_uint32_t{ cop->get_u32("out_chans"), j_node->dims.dsz("chan")/groups, kern_sz.d[1], kern_sz.d[0] },
 			   vect_string{ "out_chan", "in_chan", "y", "x" }, filts_bias_tn );
 	must_get_node( cop->bots[1] )->dims = filts_dims;
 	out_chans = cop->get_u32("out_chans");
@@ -786,6 +818,7 @@ namespace boda
       bcop->bots[0] += "_grad_loss";
       bcop->tops[0] = get_grad_loss_onn( cop, bcop->tops[0] ); 
     } else if( cop->is( Convolution_coi ) ) {
+      if( cop->groups() != 1 ) { unsup_err( "bck (gradient) ops for grouped convs are not supported; layer: " + cop->tag ); }
       bcop.reset( new conv_op_t );
       *bcop = *cop;
       bcop->coi = 0;
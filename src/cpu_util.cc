@@ -0,0 +1,599 @@
+// Copyright (c) 2015, Matthew W. Moskewicz <moskewcz@alumni.princeton.edu>; part of Boda framework; see LICENSE
+// note: the work-item fibers below switch stacks with _setjmp()/_longjmp(). the fortified longjmp() refuses to jump
+// 'down' onto a different stack, so we must disable fortification for this file (before any system header is included).
+#undef _FORTIFY_SOURCE
+#include"boda_tu_base.H"
+#include"str_util.H"
+#include"rtc_compute.H"
+#include"timers.H"
+#include<boost/filesystem.hpp>
+#include<dlfcn.h>
+#include<atomic>
+#include<setjmp.h>
+#include<ucontext.h>
+#include<unistd.h>
+
+namespace boda
+{
+  // per-work-item state passed into generated kernels. note: layout must match the copy of this struct in
+  // cpu_base_decls below.
+  struct cucl_wi_t {
+    uint32_t loc_id;
+    uint32_t grp_id;
+    uint32_t loc_sz;
+    void (*barrier)( void );
+  };
+  // signature of the per-kernel wrappers we emit: args[i] points to the value of the i'th kernel argument.
+  typedef void (*cpu_kern_t)( void * const * const args, cucl_wi_t const * const wi );
+
+  string cpu_base_decls = R"rstr(
+#define CUCL_BACKEND_IX 3
+#include<stdint.h>
+#include<math.h>
+#include<float.h>
+#include<string.h>
+uint32_t const U32_MAX = 0xffffffffU;
+struct cucl_wi_t { uint32_t loc_id; uint32_t grp_id; uint32_t loc_sz; void (*barrier)( void ); };
+static thread_local cucl_wi_t const * cucl_wi;
+#define CUCL_GLOBAL_KERNEL static
+#define CUCL_DEVICE static inline
+#define GASQ
+#define GLOB_ID_1D (cucl_wi->grp_id * cucl_wi->loc_sz + cucl_wi->loc_id)
+#define LOC_ID_1D (cucl_wi->loc_id)
+#define GRP_ID_1D (cucl_wi->grp_id)
+#define LOC_SZ_1D (cucl_wi->loc_sz)
+// all work-items of a group run on one OS thread (one group at a time per thread), so per-thread statics act as
+// group-shared memory.
+#define LOCSHAR_MEM static thread_local
+#define LSMASQ
+// the barrier callback yields to the next work-item of the group; on return, we're back on this work-item's stack.
+#define BARRIER_SYNC do { cucl_wi_t const * const cucl_wi_save = cucl_wi; cucl_wi->barrier(); cucl_wi = cucl_wi_save; } while( 0 )
+
+// the device languages provide overloaded min()/max() that accept mixed int/float args; emulate that here.
+template< typename A, typename B > static inline auto max( A const a, B const b ) -> decltype(a+b) { return (a > b) ? a : b; }
+template< typename A, typename B > static inline auto min( A const a, B const b ) -> decltype(a+b) { return (a < b) ? a : b; }
+template< typename A, typename B, typename C > static inline auto mad( A const a, B const b, C const c ) -> decltype(a*b+c) { return a*b+c; }
+
+#define store_float_to_rp_float( val, ix, p ) p[ix] = val
+#define load_float_from_rp_float( ix, p ) (p)[ix]
+
+// half is stored as raw IEEE binary16 bits; conversions are done in software (with round-to-nearest-even).
+typedef uint16_t half;
+static inline float cucl_half_to_float( uint16_t const h ) {
+  uint32_t const s = uint32_t(h & 0x8000) << 16;
+  uint32_t const e = (h >> 10) & 0x1f;
+  uint32_t m = h & 0x3ff;
+  uint32_t bits;
+  if( e == 0x1f ) { bits = s | 0x7f800000 | (m << 13); } // inf/nan
+  else if( e ) { bits = s | ((e + 112) << 23) | (m << 13); } // normal
+  else if( !m ) { bits = s; } // zero
+  else { // denormal: normalize
+    uint32_t fe = 113;
+    while( !(m & 0x400) ) { m <<= 1; --fe; }
+    bits = s | (fe << 23) | ((m & 0x3ff) << 13);
+  }
+  float f; memcpy( &f, &bits, 4 ); return f;
+}
+static inline uint16_t cucl_float_to_half( float const f ) {
+  uint32_t x; memcpy( &x, &f, 4 );
+  uint32_t const s = (x >> 16) & 0x8000;
+  uint32_t const fe = (x >> 23) & 0xff;
+  uint32_t m = x & 0x7fffff;
+  if( fe == 0xff ) { return s | 0x7c00 | (m ? 0x200 : 0); } // inf/nan
+  int32_t const e = int32_t(fe) - 127 + 15;
+  if( e >= 0x1f ) { return s | 0x7c00; } // overflow to inf
+  if( e <= 0 ) { // denormal (or zero)
+    if( e < -10 ) { return s; }
+    m |= 0x800000;
+    uint32_t const shift = 14 - e;
+    uint32_t hm = m >> shift;
+    uint32_t const rem = m & ((1U << shift) - 1);
+    uint32_t const halfway = 1U << (shift - 1);
+    if( (rem > halfway) || ((rem == halfway) && (hm & 1)) ) { ++hm; }
+    return s | hm;
+  }
+  uint32_t h = s | (uint32_t(e) << 10) | (m >> 13);
+  uint32_t const rem = m & 0x1fff;
+  if( (rem > 0x1000) || ((rem == 0x1000) && (h & 1)) ) { ++h; } // note: a carry into the exponent is correct
+  return h;
+}
+#define store_float_to_rp_half( val, ix, p ) (p)[ix] = cucl_float_to_half( val )
+#define load_float_from_rp_half( ix, p ) cucl_half_to_float( (p)[ix] )
+
+)rstr";
+
+  // a cooperative thread (fiber) used to run one work-item of a group that uses BARRIER_SYNC. fibers are created
+  // lazily and reused across groups and calls; after finishing a work-item, a fiber parks itself at the top of its
+  // loop in cpu_fiber_entry().
+  struct cpu_fiber_t {
+    ucontext_t uc; // only used for the first switch onto the fiber's stack
+    jmp_buf jb; // where to resume this fiber
+    p_uint8_t stack;
+    cucl_wi_t wi;
+    bool started;
+    bool done;
+    cpu_fiber_t( uint32_t const stack_sz ) : stack( ma_p_uint8_t( stack_sz, 64 ) ), started(0), done(0) { }
+  };
+  typedef shared_ptr< cpu_fiber_t > p_cpu_fiber_t;
+  typedef vector< p_cpu_fiber_t > vect_p_cpu_fiber_t;
+
+  void cpu_fiber_entry( void );
+  void cpu_fiber_barrier( void );
+
+  // runs all the work-items of a group, round-robin, switching at each barrier. there is one runner per OS thread.
+  struct cpu_grp_runner_t {
+    vect_p_cpu_fiber_t fibers;
+    jmp_buf sched_jb;
+    uint32_t cur;
+    cpu_kern_t kern;
+    void * const * args;
+
+    void run_grp( cpu_kern_t const kern_, void * const * const args_, uint32_t const grp_id, uint32_t const loc_sz,
+                  uint32_t const stack_sz ) {
+      kern = kern_; args = args_;
+      while( fibers.size() < loc_sz ) { fibers.push_back( make_shared<cpu_fiber_t>( stack_sz ) ); }
+      for( uint32_t i = 0; i != loc_sz; ++i ) {
+        cpu_fiber_t & f = *fibers[i];
+        f.wi = cucl_wi_t{i,grp_id,loc_sz,&cpu_fiber_barrier};
+        f.done = 0;
+      }
+      uint32_t live = loc_sz;
+      while( live ) {
+        for( cur = 0; cur != loc_sz; ++cur ) {
+          cpu_fiber_t & f = *fibers[cur];
+          if( f.done ) { continue; }
+          if( !_setjmp( sched_jb ) ) {
+            if( f.started ) { _longjmp( f.jb, 1 ); }
+            f.started = 1;
+            if( getcontext( &f.uc ) ) { rt_err( "getcontext() failed" ); }
+            f.uc.uc_stack.ss_sp = f.stack.get();
+            f.uc.uc_stack.ss_size = stack_sz;
+            f.uc.uc_link = 0;
+            makecontext( &f.uc, &cpu_fiber_entry, 0 );
+            setcontext( &f.uc );
+            rt_err( "setcontext() failed" );
+          }
+          // back from the fiber; it either hit a barrier or finished its work-item
+          if( f.done ) { --live; }
+        }
+      }
+    }
+  };
+  // note: fibers never migrate between OS threads, so each thread's runner owns its fibers (and their stacks).
+  thread_local cpu_grp_runner_t * cur_runner = 0;
+
+  void cpu_fiber_entry( void ) {
+    while( 1 ) {
+      cpu_grp_runner_t * const r = cur_runner;
+      cpu_fiber_t & f = *r->fibers[r->cur];
+      r->kern( r->args, &f.wi );
+      f.done = 1;
+      if( !_setjmp( f.jb ) ) { _longjmp( r->sched_jb, 1 ); } // park; we'll resume here to run our next work-item
+    }
+  }
+  void cpu_fiber_barrier( void ) {
+    cpu_grp_runner_t * const r = cur_runner;
+    if( !_setjmp( r->fibers[r->cur]->jb ) ) { _longjmp( r->sched_jb, 1 ); }
+  }
+
+  // strip // and /* */ comments from s
+  string strip_c_comments( string const & s ) {
+    string ret;
+    for( uint32_t i = 0; i < s.size(); ++i ) {
+      if( (s[i] == '/') && ((i+1) < s.size()) && (s[i+1] == '/') ) {
+        while( (i < s.size()) && (s[i] != '\n') ) { ++i; }
+        ret.push_back( '\n' );
+      } else if( (s[i] == '/') && ((i+1) < s.size()) && (s[i+1] == '*') ) {
+        i += 2;
+        while( ((i+1) < s.size()) && !((s[i] == '*') && (s[i+1] == '/')) ) { ++i; }
+        ++i; ret.push_back( ' ' );
+      } else { ret.push_back( s[i] ); }
+    }
+    return ret;
+  }
+
+  // strip '#if 0' ... '#endif' blocks (which templates use to hold CUCL decls for multi args) from s
+  string strip_if0_blocks( string const & s ) {
+    string ret;
+    uint32_t depth = 0; // nesting depth of #if's inside the current #if 0 block, if any, plus 1
+    for( size_t p = 0; p < s.size(); ) {
+      size_t e = s.find( '\n', p );
+      e = (e == string::npos) ? s.size() : (e + 1);
+      string const line = strip_ws( s.substr( p, e - p ) );
+      if( depth ) {
+	if( startswith( line, "#if" ) ) { ++depth; }
+	else if( startswith( line, "#endif" ) ) { --depth; }
+      } else if( line == "#if 0" ) { depth = 1; }
+      else { ret.append( s, p, e - p ); }
+      p = e;
+    }
+    return ret;
+  }
+
+  bool is_c_ident_char( char const c ) { return isalnum(c) || (c == '_'); }
+
+  // find the definition of the kernel func_name in src, and return the types of its parameters (i.e. each parameter
+  // decl with the trailing parameter name removed).
+  vect_string get_kernel_param_types( string const & src_with_comments, string const & func_name ) {
+    string const src = strip_if0_blocks( strip_c_comments( src_with_comments ) );
+    string const kern_tag = "CUCL_GLOBAL_KERNEL";
+    for( size_t p = src.find( kern_tag ); p != string::npos; p = src.find( kern_tag, p + 1 ) ) {
+      size_t np = src.find_first_not_of( " \t\n", p + kern_tag.size() );
+      if( (np == string::npos) || (src.compare( np, 4, "void" ) != 0) ) { continue; }
+      np = src.find_first_not_of( " \t\n", np + 4 );
+      if( (np == string::npos) || (src.compare( np, func_name.size(), func_name ) != 0) ) { continue; }
+      np = src.find_first_not_of( " \t\n", np + func_name.size() );
+      if( (np == string::npos) || (src[np] != '(') ) { continue; }
+      // found it; split the parameter list at top-level commas
+      vect_string params;
+      string cur;
+      uint32_t depth = 1;
+      for( ++np; np < src.size(); ++np ) {
+        char const c = src[np];
+        if( (c == '(') || (c == '[') ) { ++depth; }
+        if( (c == ')') || (c == ']') ) { --depth; if( !depth ) { break; } }
+        if( (depth == 1) && (c == ',') ) { params.push_back( cur ); cur.clear(); }
+        else { cur.push_back( (c == '\n' || c == '\t') ? ' ' : c ); }
+      }
+      if( np == src.size() ) { rt_err( "cpu_compute_t: unterminated parameter list for kernel " + func_name ); }
+      if( !strip_ws( cur ).empty() ) { params.push_back( cur ); }
+      vect_string ret;
+      for( vect_string::const_iterator i = params.begin(); i != params.end(); ++i ) {
+        string const param = strip_ws( *i );
+        size_t ne = param.size();
+        while( ne && is_c_ident_char( param[ne-1] ) ) { --ne; }
+        if( (ne == param.size()) || strip_ws( param.substr( 0, ne ) ).empty() ) {
+          rt_err( strprintf( "cpu_compute_t: can't parse parameter '%s' of kernel %s", param.c_str(), func_name.c_str() ) );
+        }
+        ret.push_back( strip_ws( param.substr( 0, ne ) ) );
+      }
+      return ret;
+    }
+    rt_err( "cpu_compute_t: couldn't find definition of kernel " + func_name + " in its source" );
+  }
+
+  string get_cpu_model_name( void ) {
+    p_string cpuinfo;
+    try { cpuinfo = read_whole_fn( string("/proc/cpuinfo") ); } catch( rt_exception const & rte ) { return "unknown"; }
+    vect_string const lines = split( *cpuinfo, '\n' );
+    for( vect_string::const_iterator i = lines.begin(); i != lines.end(); ++i ) {
+      if( !startswith( *i, "model name" ) ) { continue; }
+      size_t const cp = i->find( ':' );
+      if( cp != string::npos ) { return strip_ws( i->substr( cp + 1 ) ); }
+    }
+    return "unknown";
+  }
+
+  struct cpu_lib_t {
+    void * h;
+    cpu_lib_t( void * const h_ ) : h(h_) { }
+    ~cpu_lib_t( void ) { dlclose( h ); }
+  };
+  typedef shared_ptr< cpu_lib_t > p_cpu_lib_t;
+  // process-wide count of loaded libraries; used to generate unique library filenames. atomic since several backend
+  // instances may compile concurrently (i.e. ops-autotune workers).
+  std::atomic< uint32_t > cpu_lib_ix( 0 );
+
+  struct cpu_func_info_t {
+    rtc_func_info_t info;
+    cpu_kern_t kern;
+    bool uses_barriers;
+    p_cpu_lib_t lib;
+  };
+  typedef map< string, cpu_func_info_t > map_str_cpu_func_info_t;
+  typedef shared_ptr< map_str_cpu_func_info_t > p_map_str_cpu_func_info_t;
+
+  struct cpu_var_info_t {
+    p_nda_t buf;
+    dims_t dims;
+    p_nda_t base; // for sub-views, the (owning) buf of the viewed var; buf itself doesn't own its data
+    cpu_var_info_t( dims_t const & dims_ ) : buf( make_shared<nda_t>( dims_ ) ), dims(dims_) { }
+    cpu_var_info_t( cpu_var_info_t const & src_vi, dims_t const & dims_ ) : buf(src_vi.buf), dims(dims_), base(src_vi.base) {
+      assert_st( dims.bytes_sz() == src_vi.dims.bytes_sz() );
+    }
+    cpu_var_info_t( cpu_var_info_t const & src_vi, dims_t const & dims_, uint64_t const & byte_off ) : 
+      buf( make_shared<nda_t>( dims_, (uint8_t *)src_vi.buf->rp_elems() + byte_off ) ), dims(dims_), 
+      base( src_vi.base ? src_vi.base : src_vi.buf ) { }
+  };
+  typedef map< string, cpu_var_info_t > map_str_cpu_var_info_t;
+  typedef shared_ptr< map_str_cpu_var_info_t > p_map_str_cpu_var_info_t;
+
+  struct cpu_call_ev_t { uint64_t bt; uint64_t et; };
+  typedef vector< cpu_call_ev_t > vect_cpu_call_ev_t;
+
+  struct cpu_compute_t : virtual public nesi, public rtc_compute_t // NESI(help="host CPU rtc support; generated kernels are compiled to native code with the system C++ compiler",
+			   // bases=["rtc_compute_t"], type_id="cpu" )
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    string cxx; //NESI(default="g++",help="C++ compiler used to build generated kernels")
+    string cxx_flags; //NESI(default="-O3 -march=native -ffast-math",help="optimization flags passed to the C++ compiler")
+    filename_t build_dir; //NESI(default="%(boda_output_dir)/rtc-cpu-build",help="directory for generated kernel sources and shared objects")
+    uint32_t fiber_stack_sz; //NESI(default=262144,help="stack size in bytes for each work-item of kernels that use BARRIER_SYNC")
+
+    zi_bool init_done;
+    string plat_tag;
+    void init( void ) {
+      assert_st( !init_done.v );
+      plat_tag = "cpu:" + get_cpu_model_name();
+      ensure_is_dir( build_dir.exp, 1 );
+      init_done.v = 1;
+    }
+    // note: all our files in build_dir are removed after loading (unless gen_src is set), so remove build_dir too if
+    // it is now empty. if it isn't (i.e. it is shared with another process), this fails silently.
+    ~cpu_compute_t( void ) {
+      if( init_done.v ) { boost::system::error_code ec; boost::filesystem::remove( build_dir.exp, ec ); }
+    }
+
+    virtual string get_plat_tag( void ) { assert_st( init_done.v ); return plat_tag; }
+
+    // emit an extern "C" wrapper for the kernel that unpacks its args and sets the current work-item
+    string gen_kern_wrapper( rtc_func_info_t const & info ) {
+      vect_string const param_types = get_kernel_param_types( info.func_src, info.func_name );
+      if( param_types.size() != info.arg_names.size() ) {
+        rt_err( strprintf( "cpu_compute_t: kernel %s has %s parameters, but %s arg names were given", info.func_name.c_str(),
+                           str(param_types.size()).c_str(), str(info.arg_names.size()).c_str() ) );
+      }
+      string ret = strprintf( "extern \"C\" void %s__cpu_wi( void * const * const args, cucl_wi_t const * const wi ) {\n"
+                              "  cucl_wi = wi;\n  %s(", info.func_name.c_str(), info.func_name.c_str() );
+      for( uint32_t i = 0; i != param_types.size(); ++i ) {
+        ret += strprintf( "%s *(%s *)args[%s]", i ? "," : "", param_types[i].c_str(), str(i).c_str() );
+      }
+      ret += " );\n}\n";
+      return ret;
+    }
+
+    zi_uint32_t compile_call_ix;
+    void compile( vect_rtc_func_info_t const & func_infos, rtc_compile_opts_t const & opts ) {
+      compile_modules( vector< vect_rtc_func_info_t >{func_infos}, opts );
+    }
+
+    // each module becomes its own lib. the sources are generated and the libs loaded serially, but the (slow) external
+    // compiler runs are done in parallel.
+    void compile_modules( vector< vect_rtc_func_info_t > const & mods, rtc_compile_opts_t const & opts ) {
+      timer_t t("cpu_compile");
+      assert( init_done.v );
+      vect_string srcs( mods.size() );
+      vect_string base_fns( mods.size() ); // empty for empty modules
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        vect_rtc_func_info_t const & func_infos = mods[mix];
+        if( func_infos.empty() ) { continue; } // no work to do? don't compile just the base decls to no effect (slow).
+        string & src = srcs[mix];
+        src = cpu_base_decls + get_rtc_base_decls();
+        for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
+          string const & fn = i->op.get_func_name();
+          if( startswith( fn, "cublas_" ) || startswith( fn, "cudnn_" ) ) {
+            unsup_err( "cpu_compute_t: can't compile external-library function " + fn );
+          }
+          src += i->func_src;
+        }
+        for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
+          src += gen_kern_wrapper( *i );
+        }
+        if( gen_src ) {
+          ensure_is_dir( gen_src_output_dir.exp, 1 );
+          write_whole_fn( strprintf( "%s/out_%s.cc", gen_src_output_dir.exp.c_str(), str(compile_call_ix.v).c_str() ), src );
+        }
+        ++compile_call_ix.v;
+        // note: include pid in names so that concurrent processes can share a build_dir. also, dlopen() returns the
+        // existing handle for an already-loaded name, so names must be unique across all instances in this process.
+        base_fns[mix] = strprintf( "%s/out_%s_%s", build_dir.exp.c_str(), str(getpid()).c_str(), str(cpu_lib_ix++).c_str() );
+      }
+      // note: build_dir may have been removed since init() by another (now destroyed) instance sharing it
+      ensure_is_dir( build_dir.exp, 1 );
+      if( enable_prog_cache ) { ensure_is_dir( prog_cache_dir.exp, 1 ); } // note: not thread safe, so do it up front
+      rtc_par_for( opts.compile_threads, mods.size(), [&]( uint32_t const & mix ) {
+          if( !base_fns[mix].empty() ) { build_lib( srcs[mix], base_fns[mix], opts ); }
+        } );
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        string const & base_fn = base_fns[mix];
+        if( base_fn.empty() ) { continue; }
+        void * const h = dlopen( (base_fn + ".so").c_str(), RTLD_NOW | RTLD_LOCAL );
+        if( !h ) { rt_err( strprintf( "cpu_compute_t: dlopen() failed: %s", dlerror() ) ); }
+        p_cpu_lib_t lib = make_shared<cpu_lib_t>( h );
+        if( !gen_src ) { // the library stays loaded after its files are removed
+          boost::filesystem::remove( base_fn + ".cc" );
+          boost::filesystem::remove( base_fn + ".so" );
+          boost::filesystem::remove( base_fn + ".log" );
+        }
+        for( vect_rtc_func_info_t::const_iterator i = mods[mix].begin(); i != mods[mix].end(); ++i ) {
+          check_runnable( lib, *i );
+        }
+      }
+    }
+
+    // build src into base_fn.so (or get it from the program cache). note: called concurrently for different modules.
+    void build_lib( string const & src, string const & base_fn, rtc_compile_opts_t const & opts ) {
+      timer_t t("cpu_compile_mod");
+      string const prog_cache_key = get_prog_cache_key( src, opts, cxx + " " + cxx_flags );
+      p_string so = prog_cache_load( prog_cache_key );
+      if( so ) { write_whole_fn( base_fn + ".so", *so ); return; }
+      write_whole_fn( base_fn + ".cc", src );
+      string const cmd = strprintf( "%s -std=c++11 -shared -fPIC -w %s%s -o %s.so %s.cc > %s.log 2>&1", cxx.c_str(),
+                                    cxx_flags.c_str(), opts.enable_lineinfo ? " -g" : "", base_fn.c_str(),
+                                    base_fn.c_str(), base_fn.c_str() );
+      int const sys_ret = system( cmd.c_str() );
+      // note: read_whole_fn() can't handle empty files, and a successful compile usually produces an empty log
+      string const log = boost::filesystem::file_size( base_fn + ".log" ) ? *read_whole_fn( base_fn + ".log" ) : string();
+      if( opts.show_compile_log ) { printf( "cpu compile log:\n%s\n", log.c_str() ); }
+      if( sys_ret != 0 ) {
+        rt_err( strprintf( "cpu_compute_t: compile failed: cmd=%s log:\n%s", cmd.c_str(), log.c_str() ) );
+      }
+      prog_cache_store( prog_cache_key, *read_whole_fn( base_fn + ".so" ) );
+    }
+
+    // note: post-compilation, MUST be called exactly once on all functions that will later be run()
+    void check_runnable( p_cpu_lib_t const & lib, rtc_func_info_t const & info ) {
+      string const sym = info.func_name + "__cpu_wi";
+      void * const kern = dlsym( lib->h, sym.c_str() );
+      if( !kern ) { rt_err( strprintf( "cpu_compute_t: dlsym(%s) failed: %s", sym.c_str(), dlerror() ) ); }
+      // kernels without barriers can run their work-items as a simple loop, without fibers
+      bool const uses_barriers = strip_c_comments( info.func_src ).find( "BARRIER_SYNC" ) != string::npos;
+      must_insert( *kerns, info.func_name, cpu_func_info_t{info,(cpu_kern_t)kern,uses_barriers,lib} );
+    }
+
+    void * null_buf; // used to pass null pointers to kernels
+    p_map_str_cpu_var_info_t vis;
+    p_map_str_cpu_func_info_t kerns;
+    virtual void release_all_funcs( void ) { kerns->clear(); }
+
+    void copy_nda_to_var( string const & vn, p_nda_t const & nda ) {
+      cpu_var_info_t const & vi = must_find( *vis, vn );
+      assert_st( nda->dims == vi.dims );
+      memcpy( vi.buf->rp_elems(), nda->rp_elems(), vi.dims.bytes_sz() );
+    }
+    void copy_var_to_nda( p_nda_t const & nda, string const & vn ) {
+      cpu_var_info_t const & vi = must_find( *vis, vn );
+      assert_st( nda->dims == vi.dims );
+      memcpy( nda->rp_elems(), vi.buf->rp_elems(), vi.dims.bytes_sz() );
+    }
+    // note: since run() is synchronous, we use the default (blocking) versions of the async copies
+    void copy_var_to_var( string const & dst_vn, string const & src_vn ) {
+      cpu_var_info_t const & dst_vi = must_find( *vis, dst_vn );
+      cpu_var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_reshape_check( dst_vi.dims, src_vi.dims );
+      memcpy( dst_vi.buf->rp_elems(), src_vi.buf->rp_elems(), dst_vi.dims.bytes_sz() );
+    }
+    p_nda_t get_var_raw_native_pointer( string const & vn ) {
+      cpu_var_info_t const & vi = must_find( *vis, vn );
+      return make_shared<nda_t>( vi.dims, vi.buf->rp_elems() );
+    }
+
+    void create_var_with_dims( string const & vn, dims_t const & dims ) {
+      must_insert( *vis, vn, cpu_var_info_t( dims ) );
+      set_var_to_zero( vn );
+    }
+    void create_var_with_dims_as_reshaped_view_of_var( string const & vn, dims_t const & dims, string const & src_vn ) {
+      cpu_var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_reshape_check( dims, src_vi.dims );
+      must_insert( *vis, vn, cpu_var_info_t( src_vi, dims ) );
+    }
+    void create_var_with_dims_as_sub_view_of_var( string const & vn, dims_t const & dims, string const & src_vn, uint64_t const & byte_off ) {
+      cpu_var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_sub_view_check( dims, src_vi.dims, byte_off );
+      must_insert( *vis, vn, cpu_var_info_t( src_vi, dims, byte_off ) );
+    }
+
+    void release_var( string const & vn ) { must_erase( *vis, vn ); }
+    dims_t get_var_dims( string const & vn ) { return must_find( *vis, vn ).dims; }
+    void set_var_to_zero( string const & vn ) {
+      cpu_var_info_t const & vi = must_find( *vis, vn );
+      memset( vi.buf->rp_elems(), 0, vi.dims.bytes_sz() );
+    }
+
+    cpu_compute_t( void ) : null_buf(0), vis( new map_str_cpu_var_info_t ), kerns( new map_str_cpu_func_info_t ) { }
+
+    vect_cpu_call_ev_t call_evs;
+    cpu_call_ev_t & get_call_ev( uint32_t const & call_id ) { assert_st( call_id < call_evs.size() ); return call_evs[call_id]; }
+    uint32_t alloc_call_id( void ) { call_evs.push_back( cpu_call_ev_t{0,0} ); return call_evs.size() - 1; }
+    virtual void release_per_call_id_data( void ) { call_evs.clear(); } // invalidates all call_ids inside rtc_func_call_t's
+
+    virtual float get_dur( uint32_t const & b, uint32_t const & e ) {
+      return float( get_call_ev(e).et - get_call_ev(b).bt ) / 1e6;
+    }
+
+    // FIXME: semi-dupe'd with nvrtc/ocl versions, factor out somehow?
+    // note: var_ptrs must be pre-sized so that pointers into it stay valid
+    void add_arg( rtc_arg_t const & arg, vect_rp_void & args, vect_rp_void & var_ptrs ) {
+      assert_st( arg.is_valid() );
+      if( arg.is_var() ) { // pass-by-reference case
+        var_ptrs[args.size()] = must_find( *vis, arg.n ).buf->rp_elems();
+        args.push_back( &var_ptrs[args.size()] );
+      } else if( arg.is_nda() ) { // pass-by-value and null-reference cases (yes, an odd pairing ...)
+        assert_st( arg.v );
+        if( !arg.v->rp_elems() ) { args.push_back( &null_buf ); } // null case (REFs, optional vars)
+        else { args.push_back( arg.v->rp_elems() ); } // pass-by-value case
+      } else { assert_st(0); }
+    }
+
+    void release_func( string const & func_name ) { must_erase( *kerns, func_name ); }
+
+    // note: var_ptrs must be pre-sized to the number of args of the func
+    void add_args( cpu_func_info_t const & cfi, rtc_func_call_t const & rfc, vect_rp_void & args, vect_rp_void & var_ptrs ) {
+      for( vect_string::const_iterator i = cfi.info.arg_names.begin(); i != cfi.info.arg_names.end(); ++i ) {
+        map_str_rtc_arg_t::const_iterator ai = rfc.arg_map.find( *i );
+        // this error is almost an internal error, since the rtc_codegen_t level should ensure it doesn't happen:
+        if( ai == rfc.arg_map.end() ) { rt_err( strprintf( "cpu_compute_t: arg '%s' not found in arg_map for call.\n",
+                                                           str((*i)).c_str() ) ); }
+        add_arg( ai->second, args, var_ptrs );
+      }
+    }
+
+    uint32_t run( rtc_func_call_t const & rfc ) {
+      timer_t t("cpu_launch");
+      cpu_func_info_t const & cfi = must_find( *kerns, rfc.rtc_func_name.c_str() );
+      vect_rp_void args;
+      vect_rp_void var_ptrs( cfi.info.arg_names.size(), 0 );
+      add_args( cfi, rfc, args, var_ptrs );
+      rtc_launch_check_blks_and_tpb( rfc.rtc_func_name, rfc.blks.v, rfc.tpb.v );
+      return launch( cfi.kern, cfi.uses_barriers, &args[0], rfc.blks.v, rfc.tpb.v );
+    }
+
+    // bound calls: the kern and the packed args (including pointers to the var bufs, which the bound call keeps alive)
+    // are resolved once at bind time. by-value args point into the (base-owned, patchable in place) bound rfc.
+    struct cpu_bound_call_t {
+      cpu_kern_t kern;
+      bool uses_barriers;
+      vect_rp_void args;
+      vect_rp_void var_ptrs;
+      vect_p_nda_t bufs;
+      uint32_t blks;
+      uint32_t tpb;
+    };
+    vector< shared_ptr< cpu_bound_call_t > > cpu_bound_calls; // indexed by bcix
+
+    virtual uint32_t bind_call( rtc_func_call_t const & rfc ) {
+      uint32_t const bcix = rtc_compute_t::bind_call( rfc );
+      rtc_func_call_t const & brfc = get_bound_call( bcix );
+      cpu_func_info_t const & cfi = must_find( *kerns, brfc.rtc_func_name.c_str() );
+      rtc_launch_check_blks_and_tpb( brfc.rtc_func_name, brfc.blks.v, brfc.tpb.v );
+      shared_ptr< cpu_bound_call_t > bc = make_shared< cpu_bound_call_t >();
+      bc->kern = cfi.kern;
+      bc->uses_barriers = cfi.uses_barriers;
+      bc->var_ptrs.resize( cfi.info.arg_names.size(), 0 );
+      add_args( cfi, brfc, bc->args, bc->var_ptrs );
+      for( map_str_rtc_arg_t::const_iterator i = brfc.arg_map.begin(); i != brfc.arg_map.end(); ++i ) {
+        if( i->second.is_var() ) { cpu_var_info_t const & vi = must_find( *vis, i->second.n ); bc->bufs.push_back( vi.base ? vi.base : vi.buf ); }
+      }
+      bc->blks = brfc.blks.v;
+      bc->tpb = brfc.tpb.v;
+      assert_st( cpu_bound_calls.size() == bcix );
+      cpu_bound_calls.push_back( bc );
+      return bcix;
+    }
+    virtual uint32_t run_bound_call( uint32_t const & bcix ) {
+      assert_st( bcix < cpu_bound_calls.size() );
+      cpu_bound_call_t const & bc = *cpu_bound_calls[bcix];
+      return launch( bc.kern, bc.uses_barriers, &bc.args[0], bc.blks, bc.tpb );
+    }
+    virtual void release_bound_calls( void ) { cpu_bound_calls.clear(); rtc_compute_t::release_bound_calls(); }
+
+    uint32_t launch( cpu_kern_t const kern, bool const uses_barriers, void * const * const rp_args, 
+                     int32_t const blks, uint32_t const tpb ) {
+      uint32_t const call_id = alloc_call_id();
+      get_call_ev(call_id).bt = get_cur_time();
+      if( !uses_barriers ) {
+#pragma omp parallel for schedule(dynamic)
+        for( int32_t grp = 0; grp < blks; ++grp ) {
+          cucl_wi_t wi{0,uint32_t(grp),tpb,0};
+          for( wi.loc_id = 0; wi.loc_id != tpb; ++wi.loc_id ) { kern( rp_args, &wi ); }
+        }
+      } else {
+        uint32_t const stack_sz = fiber_stack_sz;
+#pragma omp parallel for schedule(dynamic)
+        for( int32_t grp = 0; grp < blks; ++grp ) {
+          if( !cur_runner ) { cur_runner = new cpu_grp_runner_t; } // note: per-thread; lives as long as the thread
+          cur_runner->run_grp( kern, rp_args, grp, tpb, stack_sz );
+        }
+      }
+      get_call_ev(call_id).et = get_cur_time();
+      return call_id;
+    }
+
+    void finish_and_sync( void ) { } // note: run() is synchronous
+
+    void profile_start( void ) { }
+    void profile_stop( void ) { }
+  };
+
+#include"gen/cpu_util.cc.nesi_gen.cc"
+}
@@ -3,10 +3,132 @@
 #include"lmdb_caffe_io.H"
 
 #include"caffeif.H" // only test_lmdb_t
+#include"conv_util.H" // only test_lmdb_t
+#include"timers.H"
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<exception>
 
 namespace boda 
 {
 
+  // a batch of decoded datums
+  struct datum_batch_t {
+    p_nda_float_t in_batch;
+    vect_uint32_t labels;
+  };
+  typedef shared_ptr< datum_batch_t > p_datum_batch_t; 
+  typedef std::deque< p_datum_batch_t > deque_p_datum_batch_t; 
+  typedef vector< MDB_val > vect_MDB_val;
+  typedef vector< std::exception_ptr > vect_exception_ptr;
+
+  // reads raw datums for each batch from src's lmdb cursor on a background thread, decodes them in parallel (using
+  // src->decode_threads threads), and queues up to src->prefetch_batches decoded batches for get_batch().
+  struct datum_prefetcher_t {
+    lmdb_parse_datums_t * const src;
+    dims_t const batch_dims;
+
+    std::mutex mut; // protects the below (and, after construction, nothing else)
+    std::condition_variable cv; // signaled on any change to the below
+    deque_p_datum_batch_t ready_batches;
+    bool done; // no more batches will be added to ready_batches
+    bool stop; // request for the thread to exit
+    std::exception_ptr err; // if set, the thread failed; rethrown by get_batch() after any ready batches
+
+    std::thread thread;
+
+    datum_prefetcher_t( lmdb_parse_datums_t * const src_, dims_t const & batch_dims_ ) : 
+      src(src_), batch_dims(batch_dims_), done(0), stop(0) {
+      assert_st( batch_dims.sz() == 4 );
+      if( !src->decode_threads ) { rt_err( "decode_threads must be non-zero" ); }
+      thread = std::thread( &datum_prefetcher_t::run, this );
+    }
+    ~datum_prefetcher_t( void ) {
+      { std::lock_guard< std::mutex > lock( mut ); stop = 1; }
+      cv.notify_all();
+      thread.join();
+    }
+
+    // note: the data pointed to by the MDB_val's is valid until the read txn ends, so we can decode it after
+    // releasing the cursor. returns a batch with empty labels at end of data.
+    p_datum_batch_t read_and_decode_batch( void ) {
+      p_datum_batch_t ret = make_shared< datum_batch_t >();
+      ret->in_batch = make_shared< nda_float_t >( batch_dims );
+      vect_MDB_val raw;
+      MDB_val key, data;
+      while( raw.size() != batch_dims.dims(0) ) {
+	if( src->tot_num_read == src->num_to_read ) { break; }
+	if( !src->lmdb.cursor_next( &key, &data ) ) { break; }
+	raw.push_back( data );
+	++src->tot_num_read;
+      }
+      ret->labels.resize( raw.size() );
+      vect_exception_ptr errs( raw.size() ); // exceptions can't leave an omp region, so pass them out here
+#pragma omp parallel for num_threads(src->decode_threads)
+      for( int32_t i = 0; i < int32_t(raw.size()); ++i ) {
+	try { ret->labels[i] = parse_datum_into( ret->in_batch, i, raw[i].mv_data, raw[i].mv_size ); }
+	catch( ... ) { errs[i] = std::current_exception(); }
+      }
+      for( vect_exception_ptr::const_iterator i = errs.begin(); i != errs.end(); ++i ) { 
+	if( *i ) { std::rethrow_exception( *i ); } 
+      }
+      return ret;
+    }
+
+    void run( void ) {
+      try {
+	while( 1 ) {
+	  {
+	    std::unique_lock< std::mutex > lock( mut ); // wait for space in the queue
+	    cv.wait( lock, [this]{ return stop || (ready_batches.size() < src->prefetch_batches); } );
+	    if( stop ) { return; }
+	  }
+	  p_datum_batch_t const batch = read_and_decode_batch();
+	  std::lock_guard< std::mutex > lock( mut );
+	  if( batch->labels.empty() ) { done = 1; }
+	  else { ready_batches.push_back( batch ); }
+	  cv.notify_all();
+	  if( done ) { return; }
+	}
+      } catch( ... ) {
+	std::lock_guard< std::mutex > lock( mut );
+	err = std::current_exception();
+	done = 1;
+	cv.notify_all();
+      }
+    }
+
+    // blocks until a batch is ready; returns null at end of data
+    p_datum_batch_t get_batch( void ) {
+      std::unique_lock< std::mutex > lock( mut );
+      cv.wait( lock, [this]{ return done || !ready_batches.empty(); } );
+      if( !ready_batches.empty() ) {
+	p_datum_batch_t const ret = ready_batches.front();
+	ready_batches.pop_front();
+	cv.notify_all();
+	return ret;
+      }
+      if( err ) { std::rethrow_exception( err ); }
+      return p_datum_batch_t();
+    }
+  };
+
+  void lmdb_parse_datums_t::read_prefetched_batch_of_datums( p_nda_float_t & in_batch, vect_uint32_t & labels ) {
+    assert_st( labels.empty() );
+    if( !prefetcher ) { prefetcher = make_shared< datum_prefetcher_t >( this, in_batch->dims ); }
+    else if( in_batch->dims != prefetcher->batch_dims ) { 
+      rt_err( "read_batch_of_datums(): batch dims changed while prefetching: in_batch->dims=" + str(in_batch->dims) + 
+	      " prefetch batch_dims=" + str(prefetcher->batch_dims) ); 
+    }
+    timer_t t("lmdb_wait_for_prefetched_batch");
+    p_datum_batch_t const batch = prefetcher->get_batch();
+    if( !batch ) { return; }
+    in_batch->copy_elems_with_reshape( *batch->in_batch ); // note: fill (don't replace) in_batch, since it may be aliased
+    labels = batch->labels;
+  }
+
   uint64_t score_batch( p_nda_float_t const & out_batch, vect_uint32_t const & batch_labels_gt ) {
     uint64_t num_pos = 0;
     assert( out_batch->dims.sz() == 4 );
@@ -38,10 +160,48 @@ namespace boda
   {
     virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
     p_run_cnet_t run_cnet; //NESI(default="()",help="cnet running options")
+    uint32_t pipeline_fwd; //NESI(default=0,help="if non-zero, overlap reading/uploading the next batch with running the current one (using run_fwd_begin()/run_fwd_end())")
+
+    // a batch whose run has been begun (but not yet ended)
+    struct pend_batch_t {
+      p_nda_float_t in_batch;
+      p_map_str_p_nda_float_t fwd;
+      vect_uint32_t labels;
+    };
+
+    void main_pipelined( void ) {
+      string const out_vn = run_cnet->conv_pipe->get_single_top_node()->name;
+      std::deque< pend_batch_t > pend;
+      uint64_t num_test = 0;
+      uint64_t num_pos = 0;
+      while( 1 ) {
+	if( pend.size() == 2 ) { // two batches in flight; finish and score the oldest before reading another
+	  run_cnet->conv_fwd->run_fwd_end();
+	  num_test += pend.front().labels.size();
+	  num_pos += score_batch( must_find( *pend.front().fwd, out_vn ), pend.front().labels );
+	  pend.pop_front();
+	}
+	pend_batch_t pb{ make_shared< nda_float_t >( run_cnet->in_batch->dims ), make_shared< map_str_p_nda_float_t >() };
+	read_batch_of_datums( pb.in_batch, pb.labels );
+	if( pb.labels.empty() ) { break; } // quit if we run out of data early
+	vect_string to_set_vns;
+	run_cnet->conv_pipe->run_setup_input( pb.in_batch, pb.fwd, to_set_vns );
+	run_cnet->conv_fwd->run_fwd_begin( to_set_vns, pb.fwd, {out_vn} );
+	pend.push_back( pb );
+      }
+      for( ; !pend.empty(); pend.pop_front() ) {
+	run_cnet->conv_fwd->run_fwd_end();
+	num_test += pend.front().labels.size();
+	num_pos += score_batch( must_find( *pend.front().fwd, out_vn ), pend.front().labels );
+      }
+      double const top_1_acc = double(num_pos) / num_test;
+      printf( "top_1_acc=%s num_pos=%s num_test=%s\n", str(top_1_acc).c_str(), str(num_pos).c_str(), str(num_test).c_str() );
+    }
 
     void main( nesi_init_arg_t * nia ) { 
       run_cnet->setup_cnet( nia ); 
       lmdb_open_and_start_read_pass();
+      if( pipeline_fwd ) { main_pipelined(); return; }
       vect_uint32_t batch_labels_gt;
       uint64_t num_test = 0;
       uint64_t num_pos = 0;
@@ -58,6 +218,57 @@ namespace boda
     }
   };
 
+  struct test_lmdb_prefetch_t : virtual public nesi, public lmdb_parse_datums_t // NESI(
+			 // help="check that reading an lmdb with prefetching (see prefetch_batches) gives the same batches as reading it without",
+			 // bases=["lmdb_parse_datums_t"], type_id="test_lmdb_prefetch")
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    filename_t out_fn; //NESI(default="%(boda_output_dir)/out.txt",help="output: comparison summary")
+    uint32_t test_prefetch_batches; //NESI(default=2,help="value of prefetch_batches to use for the prefetching pass")
+    uint32_t batch_sz; //NESI(default=4,help="number of datums per batch")
+    u32_pt_t in_sz; //NESI(default="227 227",help="x,y size of (center-cropped) batch images")
+
+    typedef vector< datum_batch_t > vect_datum_batch_t;
+    void read_pass( vect_datum_batch_t & batches ) {
+      prefetcher.reset(); // note: must stop any prefetch thread before closing the lmdb it reads
+      lmdb.clear();
+      lmdb_open_and_start_read_pass();
+      while( 1 ) {
+	datum_batch_t b{ make_shared< nda_float_t >( dims_t( vect_uint32_t{ batch_sz, 3, in_sz.d[1], in_sz.d[0] }, 
+							     vect_string{ "img", "chan", "y", "x" }, "float" ) ) };
+	read_batch_of_datums( b.in_batch, b.labels );
+	if( b.labels.empty() ) { break; }
+	batches.push_back( b );
+      }
+    }
+
+    void main( nesi_init_arg_t * nia ) { 
+      if( !test_prefetch_batches ) { rt_err( "test_prefetch_batches must be non-zero" ); }
+      vect_datum_batch_t plain, pf;
+      prefetch_batches = 0;
+      read_pass( plain );
+      prefetch_batches = test_prefetch_batches;
+      read_pass( pf );
+      p_ostream out = ofs_open( out_fn.exp );
+      uint32_t num_fail = 0;
+      if( plain.size() != pf.size() ) { 
+	++num_fail; 
+	(*out) << strprintf( "batch count mismatch: plain.size()=%s pf.size()=%s\n", str(plain.size()).c_str(), str(pf.size()).c_str() );
+      }
+      for( uint32_t i = 0; i != std::min( plain.size(), pf.size() ); ++i ) {
+	if( plain[i].labels != pf[i].labels ) { ++num_fail; (*out) << strprintf( "batch %s: labels differ\n", str(i).c_str() ); continue; }
+	// note: only the first labels.size() images of each batch were filled
+	uint64_t const img_bytes = plain[i].in_batch->dims.bytes_sz() / batch_sz;
+	if( memcmp( plain[i].in_batch->rp_elems(), pf[i].in_batch->rp_elems(), img_bytes * plain[i].labels.size() ) ) {
+	  ++num_fail; (*out) << strprintf( "batch %s: images differ\n", str(i).c_str() ); 
+	}
+      }
+      (*out) << strprintf( "num_batches=%s\n", str(plain.size()).c_str() );
+      if( !num_fail ) { (*out) << "***ALL IS WELL***\n"; }
+      else { (*out) << strprintf( "***PREFETCH FAILS*** num_fail=%s\n", str(num_fail).c_str() ); }
+    }
+  };
+
 #include"gen/lmdb_caffe_io.H.nesi_gen.cc"
 #include"gen/lmdb_caffe_io.cc.nesi_gen.cc"
 
@@ -0,0 +1,159 @@
+// Copyright (c) 2016, Matthew W. Moskewicz <moskewcz@alumni.princeton.edu>; part of Boda framework; see LICENSE
+#include"boda_tu_base.H"
+#include"str_util.H"
+#include"has_conv_fwd.H"
+#include"timers.H"
+#include"conv_util.H"
+#include"caffepb.H"
+#include<thread>
+#include<atomic>
+#include<exception>
+
+namespace boda
+{
+  // per-backend stats for load balancing / reporting
+  struct multi_fwd_be_stats_t {
+    uint64_t num_shards;
+    uint64_t num_imgs;
+    uint64_t dur; // in nsecs
+    multi_fwd_be_stats_t( void ) : num_shards(0), num_imgs(0), dur(0) { }
+  };
+  typedef vector< multi_fwd_be_stats_t > vect_multi_fwd_be_stats_t;
+
+  struct multi_fwd_t : virtual public nesi, public has_conv_fwd_t // NESI(help="compute conv pipe forward data-parallel over several backends. the input batch is split along the img dim into shards, each of which is run by some backend; the outputs are gathered back into a full batch.",
+			   // bases=["has_conv_fwd_t"], type_id="multi" )
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    vect_p_has_conv_fwd_t bes; //NESI(help="backends to shard over (i.e. (_=(mode=rtc,rtc=(be=ocl)),_=(mode=rtc,rtc=(be=ipc,remote_rtc=(be=ocl)))) ). each is initialized with a copy of the net whose batch size is shard_imgs.")
+    uint32_t shard_imgs; //NESI(default=0,help="images per shard. if 0, use the batch size divided by (4 * the number of backends), rounded up. smaller shards give finer-grained load balancing, but run less efficiently on each backend.")
+    uint32_t enable_stats; //NESI(default=0,help="if 1, include per-backend shard counts and timings in the info log")
+
+    p_conv_pipe_t cp;
+    uint32_t num_imgs;
+    vect_p_conv_pipe_t shard_cps;
+    vect_multi_fwd_be_stats_t be_stats;
+
+    virtual void init( p_conv_pipe_t const & cp_, nesi_init_arg_t * const nia );
+    virtual void run_fwd( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns );
+    virtual void set_det_drop_seed( uint32_t const & det_drop_seed_ ) {
+      for( vect_p_has_conv_fwd_t::const_iterator i = bes.begin(); i != bes.end(); ++i ) { (*i)->set_det_drop_seed( det_drop_seed_ ); }
+    }
+    virtual string get_info_log( void );
+
+    void run_be( uint32_t const & bix, std::atomic< uint32_t > * const next_shard,
+                 vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns );
+  };
+
+  void multi_fwd_t::init( p_conv_pipe_t const & cp_, nesi_init_arg_t * const nia ) {
+    cp = cp_;
+    assert_st( cp );
+    if( bes.empty() ) { rt_err( "multi-fwd: no backends specified (see bes)" ); }
+    if( !cp->orig_net_param ) { rt_err( "multi-fwd: unhandled: pipe not created from a net param, can't make per-shard copies" ); }
+    dims_t const in_dims = cp->get_data_img_dims();
+    num_imgs = in_dims.dsz("img");
+    if( !shard_imgs ) { shard_imgs = u32_ceil_div( num_imgs, 4 * bes.size() ); }
+    min_eq( shard_imgs, num_imgs );
+    // each backend gets its own copy of the pipe (since its init may annotate it), but the (read-only) params are shared
+    map_str_uint32_t shard_in_dims;
+    for( uint32_t i = 0; i != in_dims.size(); ++i ) { shard_in_dims[in_dims.names(i)] = in_dims.dims(i); }
+    shard_in_dims["img"] = shard_imgs;
+    for( uint32_t bix = 0; bix != bes.size(); ++bix ) {
+      p_conv_pipe_t shard_cp = create_pipe_from_param( cp->orig_net_param, shard_in_dims, cp->out_node_name, cp->has_bck_ops.v );
+      shard_cp->op_params = cp->op_params;
+      shard_cp->layer_blobs = cp->layer_blobs;
+      bes[bix]->init( shard_cp, nia );
+      shard_cps.push_back( shard_cp );
+    }
+    be_stats.resize( bes.size() );
+  }
+
+  // returns the number of bytes per img of dims, or 0 if dims isn't a batch of num_imgs (with img as the outermost dim)
+  uint64_t get_bytes_per_img( dims_t const & dims, uint32_t const & num_imgs ) {
+    if( dims.empty() || (dims.names(0) != "img") || (dims.dims(0) != num_imgs) ) { return 0; }
+    return dims.bytes_sz() / num_imgs;
+  }
+
+  // run shards on backend bix until there are none left. note that shards are handed out on demand, so each backend
+  // processes a number of shards proportional to its (measured, current) speed.
+  void multi_fwd_t::run_be( uint32_t const & bix, std::atomic< uint32_t > * const next_shard,
+                            vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns ) {
+    p_has_conv_fwd_t const & be = bes[bix];
+    be->bind_to_thread(); // note: we're on a new thread; run_fwd() spawns one per backend per call
+    multi_fwd_be_stats_t & stats = be_stats[bix];
+    p_map_str_p_nda_float_t shard_fwd = make_shared< map_str_p_nda_float_t >();
+    while( 1 ) {
+      uint32_t const shard_ix = (*next_shard)++;
+      if( shard_ix >= u32_ceil_div( num_imgs, shard_imgs ) ) { break; }
+      uint32_t const img_b = shard_ix * shard_imgs;
+      uint32_t const shard_num_imgs = std::min( shard_imgs, num_imgs - img_b ); // last shard may be partial (zero padded)
+      uint64_t const start = get_cur_time();
+      for( vect_string::const_iterator i = to_set_vns.begin(); i != to_set_vns.end(); ++i ) {
+        p_nda_float_t const & in = must_find( *fwd, *i );
+        uint64_t const bpi = get_bytes_per_img( in->dims, num_imgs );
+        if( !bpi ) { (*shard_fwd)[*i] = in; continue; } // not batched; all shards use all of it
+        p_nda_float_t & shard_in = (*shard_fwd)[*i];
+        if( !shard_in ) {
+          dims_t shard_dims = in->dims; shard_dims.dims(0) = shard_imgs; shard_dims.calc_strides();
+          shard_in = make_shared< nda_float_t >( shard_dims );
+        }
+        if( shard_num_imgs != shard_imgs ) { memset( shard_in->rp_elems(), 0, shard_in->dims.bytes_sz() ); }
+        memcpy( shard_in->rp_elems(), (uint8_t const *)in->rp_elems() + img_b*bpi, shard_num_imgs*bpi );
+      }
+      be->run_fwd( to_set_vns, shard_fwd, to_get_vns );
+      for( vect_string::const_iterator i = to_get_vns.begin(); i != to_get_vns.end(); ++i ) {
+        p_nda_float_t const & shard_out = must_find( *shard_fwd, *i );
+        uint64_t const bpi = get_bytes_per_img( shard_out->dims, shard_imgs );
+        if( !bpi ) { rt_err( "multi-fwd: unhandled: output var '"+*i+"' is not batched along an outermost img dim: " +
+                             str(shard_out->dims) ); }
+        p_nda_float_t const & out = must_find( *fwd, *i ); // note: allocated by run_fwd()
+        memcpy( (uint8_t *)out->rp_elems() + img_b*bpi, shard_out->rp_elems(), shard_num_imgs*bpi );
+      }
+      stats.dur += get_cur_time() - start;
+      ++stats.num_shards;
+      stats.num_imgs += shard_num_imgs;
+    }
+  }
+
+  void multi_fwd_t::run_fwd( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns ) {
+    timer_t t("multi_fwd_t::run_fwd");
+    // allocate outputs with full-batch dims (as determined from the first backend's pipe)
+    for( vect_string::const_iterator i = to_get_vns.begin(); i != to_get_vns.end(); ++i ) {
+      dims_t out_dims = shard_cps.front()->must_get_node( *i )->dims;
+      if( out_dims.empty() || (out_dims.names(0) != "img") ) { rt_err( "multi-fwd: unhandled: output var '"+*i+"' is not batched along an outermost img dim" ); }
+      out_dims.dims(0) = num_imgs; out_dims.calc_strides();
+      p_nda_float_t & out = (*fwd)[*i];
+      if( !out || (out->dims != out_dims) ) { out = make_shared< nda_float_t >( out_dims ); }
+    }
+    std::atomic< uint32_t > next_shard( 0 );
+    uint32_t const num_shards = u32_ceil_div( num_imgs, shard_imgs );
+    vector< std::exception_ptr > errs( bes.size() );
+    vector< std::thread > threads;
+    for( uint32_t bix = 0; bix != bes.size(); ++bix ) {
+      threads.emplace_back( [&,bix]() {
+          try { run_be( bix, &next_shard, to_set_vns, fwd, to_get_vns ); }
+          catch( ... ) { errs[bix] = std::current_exception(); next_shard = num_shards; } // stop others early
+        } );
+    }
+    for( vector< std::thread >::iterator i = threads.begin(); i != threads.end(); ++i ) { i->join(); }
+    for( vector< std::exception_ptr >::const_iterator i = errs.begin(); i != errs.end(); ++i ) {
+      if( *i ) { std::rethrow_exception( *i ); }
+    }
+  }
+
+  string multi_fwd_t::get_info_log( void ) {
+    string ret;
+    for( uint32_t bix = 0; bix != bes.size(); ++bix ) {
+      if( !enable_stats ) { ret += bes[bix]->get_info_log(); continue; }
+      multi_fwd_be_stats_t const & s = be_stats[bix];
+      double const secs = double(s.dur) / 1e9;
+      ret += strprintf( "multi-fwd be %s: shards=%s imgs=%s secs=%s imgs_per_sec=%s\n", str(bix).c_str(),
+                        str(s.num_shards).c_str(), str(s.num_imgs).c_str(), str(secs).c_str(),
+                        str( secs ? (s.num_imgs/secs) : 0.0 ).c_str() );
+      ret += bes[bix]->get_info_log();
+    }
+    return ret;
+  }
+
+#include"gen/multi_fwd.cc.nesi_gen.cc"
+
+}
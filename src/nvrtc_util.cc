@@ -52,12 +52,13 @@ namespace boda
   // FIXME: add function to get SASS? can use this command sequence:
   // ptxas out.ptx -arch sm_52 -o out.cubin ; nvdisasm out.cubin > out.sass
 
+  vect_string const nvrtc_cc_opts = {"--use_fast_math",
+                                     "--gpu-architecture=compute_52",
+                                     "--restrict"};
   string nvrtc_compile( string const & cuda_prog_str, bool const & print_log, bool const & enable_lineinfo ) {
     timer_t t("nvrtc_compile");
     p_nvrtcProgram cuda_prog = make_p_nvrtcProgram( cuda_prog_str );
-    vect_string cc_opts = {"--use_fast_math",
-			   "--gpu-architecture=compute_52",
-			   "--restrict"};
+    vect_string cc_opts = nvrtc_cc_opts;
     if( enable_lineinfo ) { cc_opts.push_back("-lineinfo"); }
     auto const comp_ret = nvrtcCompileProgram( cuda_prog.get(), cc_opts.size(), &get_vect_rp_const_char( cc_opts )[0] );
     string const log = nvrtc_get_compile_log( cuda_prog );
@@ -90,23 +91,26 @@ namespace boda
 #undef CU_GET_FUNC_ATTR_HELPER_MACRO
 
   
+  struct cup_t; typedef shared_ptr< cup_t > p_cup_t; 
   struct cup_t {
     CUdeviceptr p;
     uint64_t sz;
+    p_cup_t parent; // if non-null, this is a (non-owning) view of part of parent
     void set_to_zero( void ) { cu_err_chk( cuMemsetD8(  p, 0, sz ), "cuMemsetD8" ); }
     cup_t( uint64_t const sz_ ) : p(0), sz(sz_) { 
       cu_err_chk( cuMemAlloc( &p, sz ), "cuMemAlloc" ); 
       set_to_zero();
     }
-    ~cup_t( void ) { cu_err_chk( cuMemFree( p ), "cuMemFree" ); }
+    cup_t( p_cup_t const & parent_, uint64_t const off, uint64_t const sz_ ) : p(parent_->p + off), sz(sz_), parent(parent_) { }
+    ~cup_t( void ) { if( !parent ) { cu_err_chk( cuMemFree( p ), "cuMemFree" ); } }
   };
-  typedef shared_ptr< cup_t > p_cup_t; 
 
   typedef map< string, p_cup_t > map_str_p_cup_t;
   typedef shared_ptr< map_str_p_cup_t > p_map_str_p_cup_t;
 
   typedef shared_ptr< CUevent > p_CUevent; 
   typedef vector< p_CUevent > vect_p_CUevent; 
+  typedef map< uint32_t, p_CUevent > map_uint32_t_p_CUevent; 
   void cuEventDestroy_wrap( CUevent const * const p ) { 
     if(!p){return;} 
     cu_err_chk( cuEventDestroy( *p ), "cuEventDestroy" ); 
@@ -152,6 +156,8 @@ namespace boda
     var_info_t( var_info_t const & src_vi, dims_t const & dims_ ) : cup( src_vi.cup ), dims(dims_) {
       assert_st( dims.bytes_sz() == src_vi.dims.bytes_sz() );
     } 
+    var_info_t( var_info_t const & src_vi, dims_t const & dims_, uint64_t const & byte_off ) : 
+      cup( make_shared<cup_t>( src_vi.cup, byte_off, dims_.bytes_sz() ) ), dims(dims_) { }
   };
 
   typedef map< string, var_info_t > map_str_var_info_t;
@@ -162,6 +168,7 @@ namespace boda
 typedef unsigned uint32_t;
 uint32_t const U32_MAX = 0xffffffffU;
 typedef int int32_t;
+typedef signed char int8_t;
 //typedef long long int64_t;
 float const FLT_MAX = /*0x1.fffffep127f*/ 340282346638528859811704183484516925440.0f;
 float const FLT_MIN = 1.175494350822287507969e-38f;
@@ -176,8 +183,12 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
 #define LSMASQ
 #define BARRIER_SYNC __syncthreads()
 
-#define store_float_to_rp_half( val, ix, p ) vstore_half( val, ix, p )
+// CUDA has no vload_half()/vstore_half(), so we store half as raw bits and use the conversion intrinsics
+typedef unsigned short half;
+#define store_float_to_rp_half( val, ix, p ) (p)[ix] = __float2half_rn( val )
 #define store_float_to_rp_float( val, ix, p ) p[ix] = val
+#define load_float_from_rp_half( ix, p ) __half2float( (p)[ix] )
+#define load_float_from_rp_float( ix, p ) (p)[ix]
 
 )rstr";
 
@@ -188,6 +199,7 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
     // FIXME: can/should we init these cu_* vars?
     CUdevice cu_dev;
     CUcontext cu_context;
+    CUstream xfer_stream;
     p_culibs_wrap_t cw; // wrapper for handle to nVidia closed libs (if availible)
     zi_bool init_done;
     void init( void ) {
@@ -201,8 +213,15 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
       cu_err_chk( cuCtxSetCurrent( cu_context ), "cuCtxSetCurrent" ); // is this always needed/okay?
       // cu_err_chk( cuCtxSetCacheConfig( CU_FUNC_CACHE_PREFER_L1 ), "cuCtxSetCacheConfig" ); // does nothing?
       cw = culibs_wrap_init( this ); // creates cublas handle, cudnn handle, etc ...
+      // separate stream for async copies, so they can overlap kernels running on the default stream. note: must be
+      // non-blocking, since otherwise it would implicitly synchronize with the (legacy) default stream.
+      cu_err_chk( cuStreamCreate( &xfer_stream, CU_STREAM_NON_BLOCKING ), "cuStreamCreate" );
       init_done.v = 1;
     }
+    virtual void bind_to_thread( void ) { 
+      assert_st( init_done.v );
+      cu_err_chk( cuCtxSetCurrent( cu_context ), "cuCtxSetCurrent" ); 
+    }
 
     virtual string get_plat_tag( void ) {
       assert_st( init_done.v );
@@ -215,27 +234,57 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
 
     zi_uint32_t compile_call_ix;
     void compile( vect_rtc_func_info_t const & func_infos, rtc_compile_opts_t const & opts ) {
-      if( func_infos.empty() ) { return; } // no work to do? don't compile just the base decls to no effect (slow).
-      string cucl_src = cu_base_decls;
-      for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
-        cucl_src += i->func_src;
-      }
+      compile_modules( vector< vect_rtc_func_info_t >{func_infos}, opts );
+    }
+
+    // each module becomes its own CUmodule. the modules are compiled to ptx in parallel, but loaded serially (in this
+    // thread, which has the context).
+    void compile_modules( vector< vect_rtc_func_info_t > const & mods, rtc_compile_opts_t const & opts ) {
       assert( init_done.v );
-      if( gen_src ) { ensure_is_dir( gen_src_output_dir.exp, 1 ); }
-      if( gen_src ) {
-	write_whole_fn( strprintf( "%s/out_%s.cu", gen_src_output_dir.exp.c_str(), str(compile_call_ix.v).c_str() ), cucl_src );
-      }
-      string const prog_ptx = nvrtc_compile( cucl_src, opts.show_compile_log, opts.enable_lineinfo );
-      if( gen_src ) {      
-	write_whole_fn( strprintf( "%s/out_%s.ptx", gen_src_output_dir.exp.c_str(), str(compile_call_ix.v).c_str() ), prog_ptx );
+      int nvrtc_major = 0, nvrtc_minor = 0;
+      nvrtc_err_chk( nvrtcVersion( &nvrtc_major, &nvrtc_minor ), "nvrtcVersion" );
+      string const be_opts = str( nvrtc_cc_opts ) + strprintf( " nvrtc=%s.%s", str(nvrtc_major).c_str(), str(nvrtc_minor).c_str() );
+      vect_string cucl_srcs( mods.size() );
+      vect_uint32_t call_ixs( mods.size() );
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        vect_rtc_func_info_t const & func_infos = mods[mix];
+        if( func_infos.empty() ) { continue; } // no work to do? don't compile just the base decls to no effect (slow).
+        string & cucl_src = cucl_srcs[mix];
+        cucl_src = cu_base_decls;
+        for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
+          cucl_src += i->func_src;
+        }
+        call_ixs[mix] = compile_call_ix.v++;
+        if( gen_src ) {
+          ensure_is_dir( gen_src_output_dir.exp, 1 );
+          write_whole_fn( strprintf( "%s/out_%s.cu", gen_src_output_dir.exp.c_str(), str(call_ixs[mix]).c_str() ), cucl_src );
+        }
       }
-      CUmodule new_cu_mod;
-      cu_err_chk( cuModuleLoadDataEx( &new_cu_mod, prog_ptx.c_str(), 0, 0, 0 ), "cuModuleLoadDataEx" );
-      p_CUmodule cu_mod = make_p_CUmodule( new_cu_mod );
-      for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
-	check_runnable( cu_mod, *i, opts.show_func_attrs );
+      if( enable_prog_cache ) { ensure_is_dir( prog_cache_dir.exp, 1 ); } // note: not thread safe, so do it up front
+      vector< p_string > prog_ptxs( mods.size() );
+      rtc_par_for( opts.compile_threads, mods.size(), [&]( uint32_t const & mix ) {
+          if( mods[mix].empty() ) { return; }
+          timer_t t("nvrtc_compile_mod");
+          string const prog_cache_key = get_prog_cache_key( cucl_srcs[mix], opts, be_opts );
+          p_string prog_ptx = prog_cache_load( prog_cache_key );
+          if( !prog_ptx ) { 
+            prog_ptx = make_shared<string>( nvrtc_compile( cucl_srcs[mix], opts.show_compile_log, opts.enable_lineinfo ) );
+            prog_cache_store( prog_cache_key, *prog_ptx );
+          }
+          prog_ptxs[mix] = prog_ptx;
+        } );
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        if( mods[mix].empty() ) { continue; }
+        if( gen_src ) {      
+          write_whole_fn( strprintf( "%s/out_%s.ptx", gen_src_output_dir.exp.c_str(), str(call_ixs[mix]).c_str() ), *prog_ptxs[mix] );
+        }
+        CUmodule new_cu_mod;
+        cu_err_chk( cuModuleLoadDataEx( &new_cu_mod, prog_ptxs[mix]->c_str(), 0, 0, 0 ), "cuModuleLoadDataEx" );
+        p_CUmodule cu_mod = make_p_CUmodule( new_cu_mod );
+        for( vect_rtc_func_info_t::const_iterator i = mods[mix].begin(); i != mods[mix].end(); ++i ) {
+          check_runnable( cu_mod, *i, opts.show_func_attrs );
+        }
       }
-      ++compile_call_ix.v;
     }
 
     // note: post-compilation, MUST be called exactly once on all functions that will later be run()
@@ -289,6 +338,44 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
       cu_err_chk( cuMemcpyDtoH( nda->rp_elems(), vi.cup->p, vi.cup->sz ), "cuMemcpyDtoH" );
     }
 
+    map_uint32_t_p_CUevent xfer_evs;
+    zi_uint32_t next_xfer_id;
+    uint32_t add_xfer_ev( p_CUevent const & ev ) { must_insert( xfer_evs, next_xfer_id.v, ev ); return next_xfer_id.v++; }
+    // note: for these copies to actually overlap kernels, host memory must be page-locked; otherwise, the driver
+    // stages through its own pinned buffers (which still gives some overlap with kernels, but not full-speed copies).
+    uint32_t copy_nda_to_var_async( string const & vn, p_nda_t const & nda ) {
+      var_info_t const & vi = must_find( *vis, vn );
+      assert_st( vi.dims == nda->dims );
+      assert_st( vi.cup->sz == nda->dims.bytes_sz() );
+      cu_err_chk( cuMemcpyHtoDAsync( vi.cup->p, nda->rp_elems(), vi.cup->sz, xfer_stream ), "cuMemcpyHtoDAsync" );
+      p_CUevent ev = make_p_CUevent();
+      record_event( ev, xfer_stream );
+      cu_err_chk( cuStreamWaitEvent( 0, *ev, 0 ), "cuStreamWaitEvent" ); // later work on the default stream waits for upload
+      return add_xfer_ev( ev );
+    }
+    uint32_t copy_var_to_nda_async( p_nda_t const & nda, string const & vn ) {
+      var_info_t const & vi = must_find( *vis, vn );
+      assert_st( vi.dims == nda->dims );
+      assert_st( vi.cup->sz == nda->dims.bytes_sz() );
+      p_CUevent compute_ev = make_p_CUevent();
+      record_event( compute_ev, 0 );
+      cu_err_chk( cuStreamWaitEvent( xfer_stream, *compute_ev, 0 ), "cuStreamWaitEvent" ); // readback waits for prior work
+      cu_err_chk( cuMemcpyDtoHAsync( nda->rp_elems(), vi.cup->p, vi.cup->sz, xfer_stream ), "cuMemcpyDtoHAsync" );
+      p_CUevent ev = make_p_CUevent();
+      record_event( ev, xfer_stream );
+      return add_xfer_ev( ev );
+    }
+    void wait_xfer( uint32_t const & xfer_id ) {
+      cu_err_chk( cuEventSynchronize( *must_find( xfer_evs, xfer_id ) ), "cuEventSynchronize" );
+      must_erase( xfer_evs, xfer_id );
+    }
+    void copy_var_to_var( string const & dst_vn, string const & src_vn ) {
+      var_info_t const & dst_vi = must_find( *vis, dst_vn );
+      var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_reshape_check( dst_vi.dims, src_vi.dims );
+      cu_err_chk( cuMemcpyDtoDAsync( dst_vi.cup->p, src_vi.cup->p, dst_vi.cup->sz, 0 ), "cuMemcpyDtoDAsync" );
+    }
+
     p_nda_t get_var_raw_native_pointer( string const & vn ) {
       var_info_t const & vi = must_find( *vis, vn );
       // note that we assume here both host and device pointers are 64 bits (or at least the same size ... or maybe
@@ -304,6 +391,11 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
       rtc_reshape_check( dims, src_vi.dims );
       must_insert( *vis, vn, var_info_t( src_vi, dims ) );
     }
+    void create_var_with_dims_as_sub_view_of_var( string const & vn, dims_t const & dims, string const & src_vn, uint64_t const & byte_off ) {
+      var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_sub_view_check( dims, src_vi.dims, byte_off );
+      must_insert( *vis, vn, var_info_t( src_vi, dims, byte_off ) );
+    }
 
     void release_var( string const & vn ) { must_erase( *vis, vn ); }
     dims_t get_var_dims( string const & vn ) { return must_find( *vis, vn ).dims; }
@@ -362,13 +454,61 @@ float const FLT_MIN = 1.175494350822287507969e-38f;
       return call_id;
     }
 
+    // bound calls: the func and the packed args (including pointers to the var cups, which the bound call keeps alive)
+    // are resolved once at bind time. by-value args point into the (base-owned, patchable in place) bound rfc. calls
+    // to library (cublas/cudnn) funcs aren't pre-resolved, and are just run() as usual.
+    struct nv_bound_call_t {
+      CUfunction func;
+      vect_rp_void args;
+      vector< p_cup_t > cups;
+      uint32_t blks;
+      uint32_t tpb;
+    };
+    vector< shared_ptr< nv_bound_call_t > > nv_bound_calls; // indexed by bcix; null for library calls
+
+    virtual uint32_t bind_call( rtc_func_call_t const & rfc ) {
+      uint32_t const bcix = rtc_compute_t::bind_call( rfc );
+      rtc_func_call_t const & brfc = get_bound_call( bcix );
+      nv_func_info_t const & nfi = must_find( *cu_funcs, brfc.rtc_func_name.c_str() );
+      shared_ptr< nv_bound_call_t > bc;
+      string const & func_name = nfi.info.op.get_func_name();
+      if( !(startswith( func_name, "cublas_" ) || startswith( func_name, "cudnn_" )) ) {
+        rtc_launch_check_blks_and_tpb( brfc.rtc_func_name, brfc.blks.v, brfc.tpb.v );
+        bc = make_shared< nv_bound_call_t >();
+        bc->func = nfi.func;
+        for( vect_string::const_iterator i = nfi.info.arg_names.begin(); i != nfi.info.arg_names.end(); ++i ) {
+          rtc_arg_t const & arg = must_find( brfc.arg_map, *i );
+          add_arg( arg, bc->args );
+          if( arg.is_var() ) { bc->cups.push_back( must_find( *vis, arg.n ).cup ); }
+        }
+        bc->blks = brfc.blks.v;
+        bc->tpb = brfc.tpb.v;
+      }
+      assert_st( nv_bound_calls.size() == bcix );
+      nv_bound_calls.push_back( bc );
+      return bcix;
+    }
+    virtual uint32_t run_bound_call( uint32_t const & bcix ) {
+      assert_st( bcix < nv_bound_calls.size() );
+      if( !nv_bound_calls[bcix] ) { return run( get_bound_call( bcix ) ); }
+      nv_bound_call_t const & bc = *nv_bound_calls[bcix];
+      uint32_t const call_id = alloc_call_id();
+      record_event( get_call_ev(call_id).b_ev );
+      cu_err_chk( cuLaunchKernel( bc.func, bc.blks, 1, 1, bc.tpb, 1, 1, 0, 0, (void **)&bc.args[0], 0 ), "cuLaunchKernel" );
+      record_event( get_call_ev(call_id).e_ev );
+      return call_id;
+    }
+    virtual void release_bound_calls( void ) { nv_bound_calls.clear(); rtc_compute_t::release_bound_calls(); }
+
     void finish_and_sync( void ) { cu_err_chk( cuCtxSynchronize(), "cuCtxSynchronize" ); }
 
     void profile_start( void ) { cuProfilerStart(); }
     void profile_stop( void ) { cuProfilerStop(); }
 
   protected:
-    void record_event( p_void const & ev ) { cu_err_chk( cuEventRecord( *(CUevent*)ev.get(), 0 ), "cuEventRecord" ); }
+    void record_event( p_void const & ev, CUstream const & stream = 0 ) { 
+      cu_err_chk( cuEventRecord( *(CUevent*)ev.get(), stream ), "cuEventRecord" ); 
+    }
 
   };
   struct nvrtc_compute_t; typedef shared_ptr< nvrtc_compute_t > p_nvrtc_compute_t; 
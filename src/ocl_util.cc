@@ -63,6 +63,8 @@ namespace boda
   typedef cl_wrap_t< cl_event, clReleaseEvent, clRetainEvent > cl_event_t;
 
   typedef vector< cl_event_t > vect_cl_event_t; 
+  typedef vector< cl_event > vect_cl_event; 
+  typedef map< uint32_t, cl_event_t > map_uint32_t_cl_event_t; 
 
   // wrappers around various clGet___Info funcitons (for use with get_info function)
   struct ProgramBuild_t {
@@ -187,6 +189,7 @@ namespace boda
 typedef unsigned uint32_t;
 typedef int int32_t;
 typedef unsigned char uint8_t;
+typedef char int8_t;
 
 #define CUCL_BACKEND_IX 2
 __constant uint32_t const U32_MAX = 0xffffffff;
@@ -209,6 +212,8 @@ __constant uint32_t const U32_MAX = 0xffffffff;
 #define powf(v,e) pow((float)v,(float)e)
 #define store_float_to_rp_half( val, ix, p ) vstore_half( val, ix, p )
 #define store_float_to_rp_float( val, ix, p ) p[ix] = val
+#define load_float_from_rp_half( ix, p ) vload_half( ix, p )
+#define load_float_from_rp_float( ix, p ) (p)[ix]
 
 )rstr";
 
@@ -221,6 +226,7 @@ __constant uint32_t const U32_MAX = 0xffffffff;
     vect_cl_device_id use_devices;
     cl_context_t context;
     cl_command_queue_t cq;
+    cl_command_queue_t xfer_cq;
     zi_bool init_done;
     void init( void ) {
       assert_st( !init_done.v );
@@ -239,6 +245,9 @@ __constant uint32_t const U32_MAX = 0xffffffff;
       // them. this is arguably not the most sensible thing to do in general.
       cq.reset( clCreateCommandQueue( context.v, use_devices[0], CL_QUEUE_PROFILING_ENABLE, &err ) ); // note: not out of order
       cl_err_chk( err, "cl::CommandQueue()" );
+      // separate queue for async copies, so they can overlap kernels running on cq
+      xfer_cq.reset( clCreateCommandQueue( context.v, use_devices[0], CL_QUEUE_PROFILING_ENABLE, &err ) );
+      cl_err_chk( err, "cl::CommandQueue() (xfer)" );
       init_done.v = 1;
     }
 
@@ -261,53 +270,99 @@ __constant uint32_t const U32_MAX = 0xffffffff;
       must_insert( *kerns, info.func_name, ocl_func_info_t{info,kern} );
     }
 
+    string get_prog_binary( cl_program_t const & prog ) {
+      cl_uint const num_devs = get_info<cl_uint>(Program_t(prog.v,CL_PROGRAM_NUM_DEVICES));
+      assert_st( num_devs == 1 ); // FIXME: should only be one device here ever, right?
+      vect_size_t pb_szs;
+      pb_szs.resize( num_devs );
+
+      cl_int const sz_err = Program_t(prog.v,CL_PROGRAM_BINARY_SIZES)( pb_szs.size()*sizeof(pb_szs[0]), &pb_szs[0], 0 );
+      cl_err_chk( sz_err, "clGetProgramInfo(prog,CL_PROGRAM_BINARY_SIZES)" );
+
+      string ocl_bin;
+      ocl_bin.resize( pb_szs[0] );
+      vect_rp_char pbs{ &ocl_bin[0] };
+      cl_int const err = Program_t(prog.v,CL_PROGRAM_BINARIES)( pbs.size()*sizeof(pbs[0]), &pbs[0], 0 );
+      cl_err_chk( err, "clGetProgramInfo(prog,CL_PROGRAM_BINARIES)" );
+      return ocl_bin;
+    }
+
     zi_uint32_t compile_call_ix;
     void compile( vect_rtc_func_info_t const & func_infos, rtc_compile_opts_t const & opts ) {
+      compile_modules( vector< vect_rtc_func_info_t >{func_infos}, opts );
+    }
+
+    // each module becomes its own program. the programs are built in parallel, but their kernels are created serially.
+    void compile_modules( vector< vect_rtc_func_info_t > const & mods, rtc_compile_opts_t const & opts ) {
       timer_t t("ocl_compile");
       assert( init_done.v );
-      if( func_infos.empty() ) { return; } // no work to do? don't compile just the base decls to no effect (slow).
-      vect_rp_const_char srcs{ ocl_base_decls.c_str(), get_rtc_base_decls().c_str() };
-      for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
-        srcs.push_back( i->func_src.c_str() );
-      }      
-      if( gen_src ) {
-	ensure_is_dir( gen_src_output_dir.exp, 1 );
-        p_ostream out = ofs_open( strprintf( "%s/out_%s.cl", gen_src_output_dir.exp.c_str(), str(compile_call_ix.v).c_str() ));
-        for( vect_rp_const_char::const_iterator i = srcs.begin(); i != srcs.end(); ++i ) { (*out) << (*i); }
+      string const build_opts = "-cl-fast-relaxed-math -cl-denorms-are-zero";
+      string const driver_ver = get_info_str(Device_t(use_devices[0],CL_DRIVER_VERSION));
+      vect_string prog_srcs( mods.size() );
+      vect_uint32_t call_ixs( mods.size() );
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        vect_rtc_func_info_t const & func_infos = mods[mix];
+        if( func_infos.empty() ) { continue; } // no work to do? don't compile just the base decls to no effect (slow).
+        string & prog_src = prog_srcs[mix];
+        prog_src = ocl_base_decls + get_rtc_base_decls();
+        for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) { prog_src += i->func_src; }
+        call_ixs[mix] = compile_call_ix.v++;
+        if( gen_src ) {
+          ensure_is_dir( gen_src_output_dir.exp, 1 );
+          write_whole_fn( strprintf( "%s/out_%s.cl", gen_src_output_dir.exp.c_str(), str(call_ixs[mix]).c_str() ), prog_src );
+        }
       }
-      cl_int err;
-      cl_program_t prog;
-      prog.reset( clCreateProgramWithSource( context.v, srcs.size(), &srcs[0], 0, &err ) );
-      cl_err_chk( err, "clCreateProgramWithSource" );
-      err = clBuildProgram( prog.v, use_devices.size(), &use_devices[0], "-cl-fast-relaxed-math -cl-denorms-are-zero", 0, 0 );
-      try {  cl_err_chk_build( err, prog.v, use_devices ); }
-      catch( rt_exception const & rte ) {
-        if( rte.what_and_stacktrace().find( "CL_OUT_OF_HOST_MEMORY" ) != string::npos ) { 
-          unsup_err( "got odd no-log CL_OUT_OF_HOST_MEMORY during compile ..." );
-        } else { throw; }
+      if( enable_prog_cache ) { ensure_is_dir( prog_cache_dir.exp, 1 ); } // note: not thread safe, so do it up front
+      vector< cl_program_t > progs( mods.size() );
+      rtc_par_for( opts.compile_threads, mods.size(), [&]( uint32_t const & mix ) {
+          if( !mods[mix].empty() ) { progs[mix] = build_prog( prog_srcs[mix], build_opts, driver_ver, opts ); }
+        } );
+      for( uint32_t mix = 0; mix != mods.size(); ++mix ) {
+        if( mods[mix].empty() ) { continue; }
+        if( gen_src ) {
+          write_whole_fn( strprintf( "%s/out_%s.clb", gen_src_output_dir.exp.c_str(), str(call_ixs[mix]).c_str() ), 
+                          get_prog_binary( progs[mix] ) );
+        }
+        for( vect_rtc_func_info_t::const_iterator i = mods[mix].begin(); i != mods[mix].end(); ++i ) {
+          check_runnable( progs[mix], *i, opts.show_func_attrs );
+        }
       }
-      if( gen_src ) {
-        // get binaries
-        cl_uint const num_devs = get_info<cl_uint>(Program_t(prog.v,CL_PROGRAM_NUM_DEVICES));
-        assert_st( num_devs == 1 ); // FIXME: should only be one device here ever, right?
-        vect_size_t pb_szs;
-        pb_szs.resize( num_devs );
-
-        cl_int const sz_err = Program_t(prog.v,CL_PROGRAM_BINARY_SIZES)( pb_szs.size()*sizeof(pb_szs[0]), &pb_szs[0], 0 );
-        cl_err_chk( sz_err, "clGetProgramInfo(prog,CL_PROGRAM_BINARY_SIZES)" );
-
-        string ocl_bin;
-        ocl_bin.resize( pb_szs[0] );
-        vect_rp_char pbs{ &ocl_bin[0] };
-        cl_int const err = Program_t(prog.v,CL_PROGRAM_BINARIES)( pbs.size()*sizeof(pbs[0]), &pbs[0], 0 );
-        cl_err_chk( err, "clGetProgramInfo(prog,CL_PROGRAM_BINARIES)" );
-        
-	write_whole_fn( strprintf( "%s/out_%s.clb", gen_src_output_dir.exp.c_str(), str(compile_call_ix.v).c_str() ), ocl_bin );
+    }
+
+    // build prog_src (or get it from the program cache). note: called concurrently for different modules.
+    cl_program_t build_prog( string const & prog_src, string const & build_opts, string const & driver_ver, 
+                             rtc_compile_opts_t const & opts ) {
+      timer_t t("ocl_compile_mod");
+      string const prog_cache_key = get_prog_cache_key( prog_src, opts, build_opts + " driver=" + driver_ver );
+      cl_program_t prog;
+      p_string const cached_bin = prog_cache_load( prog_cache_key );
+      if( cached_bin ) {
+        // note: if the cached binary is rejected (i.e. is stale or corrupt), we silently fall back to compiling
+        size_t const bin_sz = cached_bin->size();
+        unsigned char const * bin = (unsigned char const *)&(*cached_bin)[0];
+        cl_int bin_status = CL_SUCCESS;
+        cl_int err = CL_SUCCESS;
+        prog.reset( clCreateProgramWithBinary( context.v, 1, &use_devices[0], &bin_sz, &bin, &bin_status, &err ) );
+        if( (err != CL_SUCCESS) || (bin_status != CL_SUCCESS) || 
+            (clBuildProgram( prog.v, use_devices.size(), &use_devices[0], build_opts.c_str(), 0, 0 ) != CL_SUCCESS) ) { 
+          prog.reset();
+        }
       }
-      for( vect_rtc_func_info_t::const_iterator i = func_infos.begin(); i != func_infos.end(); ++i ) {
-	check_runnable( prog, *i, opts.show_func_attrs );
+      if( !prog.valid() ) {
+        cl_int err;
+        char const * const src = prog_src.c_str();
+        prog.reset( clCreateProgramWithSource( context.v, 1, &src, 0, &err ) );
+        cl_err_chk( err, "clCreateProgramWithSource" );
+        err = clBuildProgram( prog.v, use_devices.size(), &use_devices[0], build_opts.c_str(), 0, 0 );
+        try {  cl_err_chk_build( err, prog.v, use_devices ); }
+        catch( rt_exception const & rte ) {
+          if( rte.what_and_stacktrace().find( "CL_OUT_OF_HOST_MEMORY" ) != string::npos ) { 
+            unsup_err( "got odd no-log CL_OUT_OF_HOST_MEMORY during compile ..." );
+          } else { throw; }
+        }
+        prog_cache_store( prog_cache_key, get_prog_binary( prog ) );
       }
-      ++compile_call_ix.v;
+      return prog;
     }
 
     cl_mem_t null_buf; // inited to 0; used to pass null device pointers to kernels. note, however, that the value is
@@ -321,21 +376,83 @@ __constant uint32_t const U32_MAX = 0xffffffff;
       assert_st( nda->dims == vi.dims );
       size_t const buf_sz = get_info<size_t>(MemObject_t(vi.buf.v,CL_MEM_SIZE));
       assert_st( buf_sz == nda->dims.bytes_sz() );
-      cl_int const err = clEnqueueWriteBuffer( cq.v, vi.buf.v, 1, 0, buf_sz, nda->rp_elems(), 0, 0, 0);  // note: blocking write
+      vect_cl_event const wait_evs = get_cq_wait_list();
+      cl_event ev = 0;
+      cl_int const err = clEnqueueWriteBuffer( cq.v, vi.buf.v, 1, 0, buf_sz, nda->rp_elems(),  // note: blocking write
+                                               wait_evs.size(), wait_evs.empty() ? 0 : &wait_evs[0], &ev );
       cl_err_chk( err, "clEnqueueWriteBuffer()" );
+      set_last_cq_ev( ev );
     }
     void copy_var_to_nda( p_nda_t const & nda, string const & vn ) {
       cl_var_info_t const & vi = must_find( *vis, vn );
       assert_st( nda->dims == vi.dims );
       size_t const buf_sz = get_info<size_t>(MemObject_t(vi.buf.v,CL_MEM_SIZE));
       assert_st( buf_sz == nda->dims.bytes_sz() );
-      cl_int const err = clEnqueueReadBuffer( cq.v, vi.buf.v, 1, 0, buf_sz, nda->rp_elems(), 0, 0, 0 ); // note: blocking_read=1
+      vect_cl_event const wait_evs = get_cq_wait_list();
+      cl_event ev = 0;
+      cl_int const err = clEnqueueReadBuffer( cq.v, vi.buf.v, 1, 0, buf_sz, nda->rp_elems(), // note: blocking_read=1
+                                              wait_evs.size(), wait_evs.empty() ? 0 : &wait_evs[0], &ev );
       cl_err_chk( err, "clEnqueueReadBuffer()" );
+      set_last_cq_ev( ev );
     }
     p_nda_t get_var_raw_native_pointer( string const & vn ) {
       rt_err( "ocl_compute_t: get_var_raw_native_pointer(): not implemented");
     }
 
+    vect_cl_event_t pend_upload_evs; // async uploads that the next op on cq must wait for
+    cl_event_t last_cq_ev; // last op enqueued on cq, set by every op on cq (async readbacks must wait for it)
+    map_uint32_t_cl_event_t xfer_evs;
+    zi_uint32_t next_xfer_id;
+    vect_cl_event get_cq_wait_list( void ) {
+      vect_cl_event ret;
+      for( vect_cl_event_t::const_iterator i = pend_upload_evs.begin(); i != pend_upload_evs.end(); ++i ) { ret.push_back( i->v ); }
+      return ret;
+    }
+    void set_last_cq_ev( cl_event const & ev ) { last_cq_ev.reset( ev ); pend_upload_evs.clear(); }
+    uint32_t add_xfer_ev( cl_event_t const & ev ) { must_insert( xfer_evs, next_xfer_id.v, ev ); return next_xfer_id.v++; }
+
+    uint32_t copy_nda_to_var_async( string const & vn, p_nda_t const & nda ) {
+      cl_var_info_t const & vi = must_find( *vis, vn );
+      assert_st( nda->dims == vi.dims );
+      cl_event ev = 0;
+      cl_int const err = clEnqueueWriteBuffer( xfer_cq.v, vi.buf.v, 0, 0, vi.dims.bytes_sz(), nda->rp_elems(), 0, 0, &ev ); // note: non-blocking write
+      cl_err_chk( err, "clEnqueueWriteBuffer() [async]" );
+      cl_err_chk( clFlush( xfer_cq.v ), "clFlush()" );
+      cl_event_t up_ev;
+      up_ev.reset( ev );
+      pend_upload_evs.push_back( up_ev );
+      return add_xfer_ev( up_ev );
+    }
+    uint32_t copy_var_to_nda_async( p_nda_t const & nda, string const & vn ) {
+      cl_var_info_t const & vi = must_find( *vis, vn );
+      assert_st( nda->dims == vi.dims );
+      cl_err_chk( clFlush( cq.v ), "clFlush()" ); // so that last_cq_ev can complete
+      cl_event ev = 0;
+      cl_int const err = clEnqueueReadBuffer( xfer_cq.v, vi.buf.v, 0, 0, vi.dims.bytes_sz(), nda->rp_elems(), // note: non-blocking read
+                                              last_cq_ev.valid(), last_cq_ev.valid() ? &last_cq_ev.v : 0, &ev );
+      cl_err_chk( err, "clEnqueueReadBuffer() [async]" );
+      cl_err_chk( clFlush( xfer_cq.v ), "clFlush()" );
+      cl_event_t rb_ev;
+      rb_ev.reset( ev );
+      return add_xfer_ev( rb_ev );
+    }
+    void wait_xfer( uint32_t const & xfer_id ) {
+      cl_event_t const & ev = must_find( xfer_evs, xfer_id );
+      cl_err_chk( clWaitForEvents( 1, &ev.v ), "clWaitForEvents()" );
+      must_erase( xfer_evs, xfer_id );
+    }
+    void copy_var_to_var( string const & dst_vn, string const & src_vn ) {
+      cl_var_info_t const & dst_vi = must_find( *vis, dst_vn );
+      cl_var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_reshape_check( dst_vi.dims, src_vi.dims );
+      vect_cl_event const wait_evs = get_cq_wait_list();
+      cl_event ev = 0;
+      cl_int const err = clEnqueueCopyBuffer( cq.v, src_vi.buf.v, dst_vi.buf.v, 0, 0, dst_vi.dims.bytes_sz(), 
+                                              wait_evs.size(), wait_evs.empty() ? 0 : &wait_evs[0], &ev );
+      cl_err_chk( err, "clEnqueueCopyBuffer()" );
+      set_last_cq_ev( ev );
+    }
+
     void create_var_with_dims( string const & vn, dims_t const & dims ) { 
       cl_int err;
       cl_mem_t buf;
@@ -349,6 +466,16 @@ __constant uint32_t const U32_MAX = 0xffffffff;
       rtc_reshape_check( dims, src_vi.dims );
       must_insert( *vis, vn, cl_var_info_t( src_vi, dims ) );
     }
+    void create_var_with_dims_as_sub_view_of_var( string const & vn, dims_t const & dims, string const & src_vn, uint64_t const & byte_off ) {
+      cl_var_info_t const & src_vi = must_find( *vis, src_vn );
+      rtc_sub_view_check( dims, src_vi.dims, byte_off );
+      cl_buffer_region const region = { byte_off, dims.bytes_sz() };
+      cl_int err;
+      cl_mem_t buf;
+      buf.reset( clCreateSubBuffer( src_vi.buf.v, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err ) );
+      cl_err_chk( err, "clCreateSubBuffer()" );
+      must_insert( *vis, vn, cl_var_info_t{buf,dims} ); 
+    }
 
     void release_var( string const & vn ) { must_erase( *vis, vn ); }
     dims_t get_var_dims( string const & vn ) { return must_find( *vis, vn ).dims; }
@@ -360,10 +487,13 @@ __constant uint32_t const U32_MAX = 0xffffffff;
 #else
       uint32_t const bytes_sz = get_info<size_t>(MemObject_t(buf.v,CL_MEM_SIZE));
       vect_uint8_t zeros( bytes_sz, 0 );
+      vect_cl_event const wait_evs = get_cq_wait_list();
+      cl_event ev = 0;
       cl_int const err = clEnqueueWriteBuffer( cq.v, buf.v, 1, 
 					       0, bytes_sz, &zeros[0],
-					       0, 0, 0);  // note: blocking write
+					       wait_evs.size(), wait_evs.empty() ? 0 : &wait_evs[0], &ev );  // note: blocking write
       cl_err_chk( err, "clEnqueueWriteBuffer()" );
+      set_last_cq_ev( ev );
 #endif
     }
     
@@ -403,34 +533,103 @@ __constant uint32_t const U32_MAX = 0xffffffff;
 
     void release_func( string const & func_name ) { must_erase( *kerns, func_name ); }
 
+    rtc_arg_t const & get_call_arg( rtc_func_call_t const & rfc, string const & an ) {
+      map_str_rtc_arg_t::const_iterator ai = rfc.arg_map.find( an );
+      // this error is almost an internal error, since the rtc_codegen_t level should ensure it doesn't happen:
+      if( ai == rfc.arg_map.end() ) { rt_err( strprintf( "ocl_compute_t: arg '%s' not found in arg_map for call.\n",
+                                                         str(an).c_str() ) ); }
+      return ai->second;
+    }
+
+    void check_loc_work_sz( cl_kernel_t const & kern, size_t const & loc_work_sz ) {
+      size_t const kwgs = get_info<size_t>(KernelWorkGroup_t(kern.v,use_devices[0],CL_KERNEL_WORK_GROUP_SIZE));
+      // printf( "kwgs=%s\n", str(kwgs).c_str() ); // might be handy to see; might indicate occupancy limits for kernel
+      if( loc_work_sz > kwgs ) {
+        unsup_err( strprintf( "Can't run kernel: loc_work_sz is %s but OpenCL says max is %s for this kernel+device.", 
+                              str(loc_work_sz).c_str(), str(kwgs).c_str() ) );
+      }
+    }
+
     uint32_t run( rtc_func_call_t const & rfc ) {
       ocl_func_info_t const & ofi = must_find( *kerns, rfc.rtc_func_name.c_str() );
       uint32_t cur_arg_ix = 0;
       for( vect_string::const_iterator i = ofi.info.arg_names.begin(); i != ofi.info.arg_names.end(); ++i ) {
-        map_str_rtc_arg_t::const_iterator ai = rfc.arg_map.find( *i );
-        // this error is almost an internal error, since the rtc_codegen_t level should ensure it doesn't happen:
-        if( ai == rfc.arg_map.end() ) { rt_err( strprintf( "ocl_compute_t: arg '%s' not found in arg_map for call.\n",
-                                                           str((*i)).c_str() ) ); }
-        add_arg( ai->second, ofi.kern, cur_arg_ix );
+        add_arg( get_call_arg( rfc, *i ), ofi.kern, cur_arg_ix );
       }
       rtc_launch_check_blks_and_tpb( rfc.rtc_func_name, rfc.blks.v, rfc.tpb.v );
-      uint32_t const call_id = alloc_call_id();
-      size_t const glob_work_sz = rfc.tpb.v*rfc.blks.v;
-      size_t const loc_work_sz = rfc.tpb.v;
-      size_t const kwgs = get_info<size_t>(KernelWorkGroup_t(ofi.kern.v,use_devices[0],CL_KERNEL_WORK_GROUP_SIZE));
-      // printf( "kwgs=%s\n", str(kwgs).c_str() ); // might be handy to see; might indicate occupancy limits for kernel
-      if( loc_work_sz > kwgs ) {
-        unsup_err( strprintf( "Can't run kernel: loc_work_sz is %s but OpenCL says max is %s for this kernel+device.", 
-                              str(loc_work_sz).c_str(), str(kwgs).c_str() ) );
+      check_loc_work_sz( ofi.kern, rfc.tpb.v );
+      return launch( ofi.kern, rfc.tpb.v*rfc.blks.v, rfc.tpb.v );
+    }
+
+    // bound calls: the kern, the (retained) var bufs, and the sizes/pointers of the by-value args are resolved (and the
+    // work group size checked) once at bind time. since kernels are shared between calls, the args still need to be
+    // set on each run, but that's just a loop of clSetKernelArg()s. by-value args point into the (base-owned,
+    // patchable in place) bound rfc.
+    struct ocl_bound_arg_t {
+      cl_mem_t buf; // for by-reference (and null) args
+      size_t sz; // for by-value args (otherwise 0)
+      void const * v;
+    };
+    struct ocl_bound_call_t {
+      cl_kernel_t kern;
+      vector< ocl_bound_arg_t > args;
+      size_t glob_work_sz;
+      size_t loc_work_sz;
+    };
+    vector< shared_ptr< ocl_bound_call_t > > ocl_bound_calls; // indexed by bcix
+
+    virtual uint32_t bind_call( rtc_func_call_t const & rfc ) {
+      uint32_t const bcix = rtc_compute_t::bind_call( rfc );
+      rtc_func_call_t const & brfc = get_bound_call( bcix );
+      ocl_func_info_t const & ofi = must_find( *kerns, brfc.rtc_func_name.c_str() );
+      rtc_launch_check_blks_and_tpb( brfc.rtc_func_name, brfc.blks.v, brfc.tpb.v );
+      check_loc_work_sz( ofi.kern, brfc.tpb.v );
+      shared_ptr< ocl_bound_call_t > bc = make_shared< ocl_bound_call_t >();
+      bc->kern = ofi.kern;
+      for( vect_string::const_iterator i = ofi.info.arg_names.begin(); i != ofi.info.arg_names.end(); ++i ) {
+        rtc_arg_t const & arg = get_call_arg( brfc, *i );
+        assert_st( arg.is_valid() );
+        ocl_bound_arg_t ba{null_buf,0,0};
+        if( arg.is_var() ) { ba.buf = must_find( *vis, arg.n ).buf; } // pass-by-reference case
+        else if( arg.v->rp_elems() ) { ba.sz = arg.v->dims.bytes_sz(); ba.v = arg.v->rp_elems(); } // pass-by-value case
+        bc->args.push_back( ba );
+      }
+      bc->glob_work_sz = brfc.tpb.v*brfc.blks.v;
+      bc->loc_work_sz = brfc.tpb.v;
+      assert_st( ocl_bound_calls.size() == bcix );
+      ocl_bound_calls.push_back( bc );
+      return bcix;
+    }
+    virtual uint32_t run_bound_call( uint32_t const & bcix ) {
+      assert_st( bcix < ocl_bound_calls.size() );
+      ocl_bound_call_t const & bc = *ocl_bound_calls[bcix];
+      for( uint32_t i = 0; i != bc.args.size(); ++i ) {
+        ocl_bound_arg_t const & ba = bc.args[i];
+        if( ba.sz ) { cl_err_chk( clSetKernelArg( bc.kern.v, i, ba.sz, ba.v ), "clSetKernelArg() [by-value]" ); }
+        else { set_kernel_arg( bc.kern, i, ba.buf.v ); }
       }
+      return launch( bc.kern, bc.glob_work_sz, bc.loc_work_sz );
+    }
+    virtual void release_bound_calls( void ) { ocl_bound_calls.clear(); rtc_compute_t::release_bound_calls(); }
+
+    // note: kern's args must already be set
+    uint32_t launch( cl_kernel_t const & kern, size_t const glob_work_sz, size_t const loc_work_sz ) {
+      uint32_t const call_id = alloc_call_id();
+      vect_cl_event const wait_evs = get_cq_wait_list();
       cl_event ev = 0;
-      cl_int const err = clEnqueueNDRangeKernel( cq.v, ofi.kern.v, 1, 0, &glob_work_sz, &loc_work_sz, 0, 0, &ev);
+      cl_int const err = clEnqueueNDRangeKernel( cq.v, kern.v, 1, 0, &glob_work_sz, &loc_work_sz, 
+                                                 wait_evs.size(), wait_evs.empty() ? 0 : &wait_evs[0], &ev);
       cl_err_chk( err, "clEnqueueNDRangeKernel()" );
       get_call_ev(call_id).reset(ev);
+      last_cq_ev = get_call_ev(call_id);
+      pend_upload_evs.clear();
       return call_id;
     }
 
-    void finish_and_sync( void ) { cl_err_chk( clFinish( cq.v ), "clFinish()" ); }
+    void finish_and_sync( void ) { 
+      cl_err_chk( clFinish( cq.v ), "clFinish()" ); 
+      cl_err_chk( clFinish( xfer_cq.v ), "clFinish() (xfer)" ); 
+    }
 
     // FIXME: TODO
     void profile_start( void ) { }
@@ -125,6 +125,20 @@ namespace boda
     out << "/op_wisdom_t\n";
   }
 
+  void read_best_op_tunes( filename_t const & wisdom_fn, string const & plat_tag, per_op_tune_map_t & best_op_tunes ) {
+    p_istream win = ifs_open( wisdom_fn );
+    for( p_op_wisdom_t owi; owi = read_next_wisdom( win ); ) { 
+      op_run_t const * min_r = 0;
+      p_op_tune_t min_tune;
+      for( vect_p_op_tune_wisdom_t::const_iterator i = owi->wisdoms.begin(); i != owi->wisdoms.end(); ++i ) {
+        map_str_op_run_t::const_iterator ri = (*i)->runs.find( plat_tag );
+        if( (ri == (*i)->runs.end()) || (!ri->second.err.empty()) ) { continue; }
+        if( (!min_r) || (ri->second.rt_secs < min_r->rt_secs) ) { min_r = &ri->second; min_tune = (*i)->op_tune; }
+      }
+      if( min_tune ) { best_op_tunes[*owi->op] = *min_tune; }
+    }
+  }
+
   void op_tune_wisdom_t::merge_runs_from( op_tune_wisdom_t const & o ) {
     // for now, don't allow overwrite ...
     for( map_str_op_run_t::const_iterator i = o.runs.begin(); i != o.runs.end(); ++i ) {
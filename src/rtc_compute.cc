@@ -2,6 +2,13 @@
 #include"boda_tu_base.H"
 #include"rtc_compute.H"
 #include"str_util.H"
+#include"timers.H"
+#include"ext/half.hpp"
+#include<boost/filesystem.hpp>
+#include<unistd.h>
+#include<thread>
+#include<atomic>
+#include<exception>
 
 namespace boda 
 {
@@ -40,6 +47,15 @@ namespace boda
     }
   }
 
+  void rtc_sub_view_check( dims_t const & dims, dims_t const & src_dims, uint64_t const & byte_off ) {
+    // unlike a reshape, a sub-view may have any type; we only check that it lies within the source var.
+    if( !dims.bytes_sz() ) { rt_err( "invalid sub-view: empty views are not supported" ); }
+    if( (byte_off + dims.bytes_sz()) > src_dims.bytes_sz() ) {
+      rt_err( strprintf( "invalid sub-view; extends past end of source var: byte_off=%s dims.bytes_sz()=%s src_dims.bytes_sz()=%s\n",
+                         str(byte_off).c_str(), str(dims.bytes_sz()).c_str(), str(src_dims.bytes_sz()).c_str() ) );
+    }
+  }
+
   void rtc_compute_t::init_var_from_vect_float( string const & vn, vect_float const & v ) { 
     p_nda_t nda = make_shared<nda_t>( dims_t{ vect_uint32_t{uint32_t(v.size())}, "float" }, (void*)&v[0] );
     create_var_with_dims( vn, nda->dims ); 
@@ -61,6 +77,69 @@ namespace boda
     copy_var_to_nda( ret, vn );
     return ret;
   }
+  void rtc_compute_t::copy_var_to_var( string const & dst_vn, string const & src_vn ) {
+    p_nda_t const nda = create_nda_from_var( src_vn );
+    rtc_reshape_check( get_var_dims( dst_vn ), nda->dims );
+    nda->dims = get_var_dims( dst_vn );
+    copy_nda_to_var( dst_vn, nda );
+  }
+  uint32_t rtc_get_num_threads( uint32_t const & num_threads ) {
+    return num_threads ? num_threads : std::max( 1U, std::thread::hardware_concurrency() );
+  }
+
+  void rtc_par_for( uint32_t const & num_threads, uint32_t const & n, std::function< void( uint32_t const & ) > const & f ) {
+    uint32_t const nt = std::min( rtc_get_num_threads( num_threads ), n );
+    if( nt <= 1 ) { for( uint32_t i = 0; i != n; ++i ) { f( i ); } return; } // note: no threads for the serial case
+    std::atomic< uint32_t > next_ix( 0 );
+    vector< std::exception_ptr > errs( nt );
+    vector< std::thread > threads;
+    for( uint32_t tix = 0; tix != nt; ++tix ) {
+      threads.emplace_back( [&,tix]() {
+          try { for( uint32_t i; (i = next_ix++) < n; ) { f( i ); } }
+          catch( ... ) { errs[tix] = std::current_exception(); next_ix = n; } // stop others early
+        } );
+    }
+    for( vector< std::thread >::iterator i = threads.begin(); i != threads.end(); ++i ) { i->join(); }
+    for( vector< std::exception_ptr >::const_iterator i = errs.begin(); i != errs.end(); ++i ) {
+      if( *i ) { std::rethrow_exception( *i ); }
+    }
+  }
+
+  void rtc_compute_t::compile_modules( vector< vect_rtc_func_info_t > const & mods, rtc_compile_opts_t const & opts ) {
+    for( vector< vect_rtc_func_info_t >::const_iterator i = mods.begin(); i != mods.end(); ++i ) { compile( *i, opts ); }
+  }
+
+  // default bound calls: just store the call (with its own copies of its by-value args) and run() it on demand
+  uint32_t rtc_compute_t::bind_call( rtc_func_call_t const & rfc ) {
+    shared_ptr< rtc_func_call_t > bc = make_shared< rtc_func_call_t >( rfc );
+    for( map_str_rtc_arg_t::iterator i = bc->arg_map.begin(); i != bc->arg_map.end(); ++i ) {
+      if( !i->second.is_nda() || !i->second.v->rp_elems() ) { continue; } // vars and nulls are passed by handle
+      p_nda_t const v = make_shared<nda_t>( i->second.v->dims );
+      memcpy( v->rp_elems(), i->second.v->rp_elems(), v->dims.bytes_sz() );
+      i->second.v = v;
+    }
+    bound_calls.push_back( bc );
+    return bound_calls.size() - 1;
+  }
+  uint32_t rtc_compute_t::run_bound_call( uint32_t const & bcix ) { return run( get_bound_call( bcix ) ); }
+  void rtc_compute_t::release_bound_calls( void ) { bound_calls.clear(); }
+  rtc_func_call_t const & rtc_compute_t::get_bound_call( uint32_t const & bcix ) const {
+    assert_st( bcix < bound_calls.size() );
+    return *bound_calls[bcix];
+  }
+  // note: v is copied into the bound call's existing by-value arg, so that any pointers to it stay valid
+  void rtc_compute_t::set_bound_call_arg( uint32_t const & bcix, string const & an, p_nda_t const & v ) {
+    rtc_func_call_t const & bc = get_bound_call( bcix );
+    rtc_arg_t const & arg = must_find( bc.arg_map, an );
+    if( !arg.is_nda() || !arg.v->rp_elems() ) { rt_err( "set_bound_call_arg(): arg '"+an+"' of bound call to '"+
+                                                        bc.rtc_func_name+"' is not a by-value arg" ); }
+    if( !v->rp_elems() || (v->dims.bytes_sz() != arg.v->dims.bytes_sz()) ) {
+      rt_err( strprintf( "set_bound_call_arg(): size mismatch for arg '%s' of bound call to '%s': bound=%s new=%s",
+                         an.c_str(), bc.rtc_func_name.c_str(), str(arg.v->dims).c_str(), str(v->dims).c_str() ) );
+    }
+    memcpy( arg.v->rp_elems(), v->rp_elems(), v->dims.bytes_sz() );
+  }
+
   // create new flat nda from var
   p_nda_t rtc_compute_t::copy_var_as_flat_nda( string const & vn ) {
     p_nda_t ret = create_nda_from_var( vn );
@@ -81,17 +160,46 @@ namespace boda
     } 
   }
 
+  // returns a copy of in (which must be float or half) converted to out_tn (which must be the other one)
+  p_nda_t convert_float_half_nda( p_nda_t const & in, string const & out_tn ) {
+    dims_t out_dims = in->dims;
+    out_dims.tn = out_tn;
+    p_nda_t ret = make_shared<nda_t>( out_dims );
+    uint64_t const sz = in->dims.strides_sz;
+    if( (in->dims.tn == "float") && (out_tn == "half") ) {
+      float const * const src = (float const *)in->rp_elems();
+      half * const dst = (half *)ret->rp_elems();
+      for( uint64_t i = 0; i != sz; ++i ) { dst[i] = half_float::half_cast<half,std::round_to_nearest>( src[i] ); }
+    } else if( (in->dims.tn == "half") && (out_tn == "float") ) {
+      half const * const src = (half const *)in->rp_elems();
+      float * const dst = (float *)ret->rp_elems();
+      for( uint64_t i = 0; i != sz; ++i ) { dst[i] = float( src[i] ); }
+    } else { rt_err( "convert_float_half_nda: unhandled conversion from "+in->dims.tn+" to "+out_tn ); }
+    return ret;
+  }
+
   // FIXME_TNDA: dup'd for now, see FIXME_TNDA in header
-  // batch nda<->var copies
+  // batch nda<->var copies. since these take float ndas, they also allow half vars (i.e. as used by rtc fwd with
+  // storage_tn=half), converting on the host.
   void rtc_compute_t::copy_ndas_to_vars( vect_string const & names, map_str_p_nda_float_t const & ndas ) {
     for( vect_string::const_iterator i = names.begin(); i != names.end(); ++i ) {
-      copy_nda_to_var( *i, must_find( ndas, *i ) );
+      p_nda_t const nda = must_find( ndas, *i );
+      if( get_var_dims( *i ).tn == "half" ) { copy_nda_to_var( *i, convert_float_half_nda( nda, "half" ) ); }
+      else { copy_nda_to_var( *i, nda ); }
     }
   }
   // assumes that names do not exist in ndas, or alreay exist with proper dims
   void rtc_compute_t::copy_vars_to_ndas( vect_string const & names, map_str_p_nda_float_t & ndas ) {
     for( vect_string::const_iterator i = names.begin(); i != names.end(); ++i ) { 
-      if( has( ndas, *i ) ) { copy_var_to_nda( ndas[*i], *i ); }
+      if( get_var_dims( *i ).tn == "half" ) {
+        p_nda_t const nda = convert_float_half_nda( create_nda_from_var( *i ), "float" );
+        if( has( ndas, *i ) ) { 
+          p_nda_float_t const & out = ndas[*i];
+          assert_st( out->dims == nda->dims );
+          memcpy( out->rp_elems(), nda->rp_elems(), nda->dims.bytes_sz() );
+        } else { must_insert( ndas, *i, make_shared< nda_float_t >( nda ) ); }
+      }
+      else if( has( ndas, *i ) ) { copy_var_to_nda( ndas[*i], *i ); }
       else { must_insert( ndas, *i, make_shared< nda_float_t >( create_nda_from_var( *i ) ) ); }
     } 
   }
@@ -124,6 +232,37 @@ namespace boda
     }
     return rtc_base_decls;
   }
+
+  string rtc_compute_t::get_prog_cache_key( string const & src, rtc_compile_opts_t const & opts, string const & be_opts ) {
+    string const key_src = strprintf( "be=%s plat_tag=%s enable_lineinfo=%s be_opts=%s\n", be.c_str(), get_plat_tag().c_str(),
+                                      str(opts.enable_lineinfo).c_str(), be_opts.c_str() ) + src;
+    // note: we use two 64-bit FNV-1a hashes (with different offset bases, one over the reversed key) to make
+    // collisions a non-issue in practice. unlike std::hash, these are fixed, so keys are stable across builds.
+    uint64_t fnv = 14695981039346656037ULL;
+    for( string::const_iterator i = key_src.begin(); i != key_src.end(); ++i ) { fnv ^= uint8_t(*i); fnv *= 1099511628211ULL; }
+    uint64_t fnv_rev = 0x6c62272e07bb0142ULL;
+    for( string::const_reverse_iterator i = key_src.rbegin(); i != key_src.rend(); ++i ) { fnv_rev ^= uint8_t(*i); fnv_rev *= 1099511628211ULL; }
+    return strprintf( "%s-%016llx%016llx", be.c_str(), (unsigned long long)fnv, (unsigned long long)fnv_rev );
+  }
+  p_string rtc_compute_t::prog_cache_load( string const & key ) {
+    if( !enable_prog_cache ) { return p_string(); }
+    string const fn = prog_cache_dir.exp + "/" + key;
+    if( !boost::filesystem::is_regular_file( fn ) || !boost::filesystem::file_size( fn ) ) { 
+      timer_t t("rtc_prog_cache_miss");
+      return p_string(); 
+    }
+    timer_t t("rtc_prog_cache_hit");
+    return read_whole_fn( fn );
+  }
+  void rtc_compute_t::prog_cache_store( string const & key, string const & prog ) {
+    if( !enable_prog_cache ) { return; }
+    ensure_is_dir( prog_cache_dir.exp, 1 );
+    // write-then-rename, so that concurrent processes (or threads) sharing the cache never see partial entries
+    string const fn = prog_cache_dir.exp + "/" + key;
+    string const tmp_fn = fn + ".tmp-" + str(getpid()) + "-" + str(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    write_whole_fn( tmp_fn, prog );
+    boost::filesystem::rename( tmp_fn, fn );
+  }
 }
 
 // extra includes only for test mode
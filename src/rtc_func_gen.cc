@@ -1,6 +1,7 @@
 // Copyright (c) 2015, Matthew W. Moskewicz <moskewcz@alumni.princeton.edu>; part of Boda framework; see LICENSE
 #include"boda_tu_base.H"
 #include"rtc_func_gen.H"
+#include"timers.H"
 
 namespace boda 
 {
@@ -73,9 +74,11 @@ namespace boda
       if( mmc_parts.size() < 2 ) { rt_err( "invalid CUCL magic comment. missing directive after CUCL." ); }
       string cd = mmc_parts[1];
       bool const dyn = maybe_strip_suffix( cd, "_DYN" );
+      bool const strided = maybe_strip_suffix( cd, "_STRIDED" );
       if( (cd == "IN") || (cd == "INOUT") || (cd == "OUT") || (cd == "REF") || (cd == "IX") ) { 
         if( cd == "IX" ) {
           if( dyn ) { rt_err( "invalid use of _DYN suffix on CUCL IX decl" ); }
+          if( strided ) { rt_err( "invalid use of _STRIDED suffix on CUCL IX decl" ); }
           if( mmc_parts.size() < 4 ) { rt_err( "invalid CUCL IX decl; missing ix_name and/or arg_name." ); }
           string const ix_name = mmc_parts[2];
           string const arg_name = mmc_parts[3];
@@ -91,6 +94,7 @@ namespace boda
           arg_decl_t cad;
           cad.io_type = cd;
           cad.dyn.v = dyn;
+          cad.strided.v = strided;
           cad.arg_parse( line );
           if( cad.tn.empty() ) { rt_err( "invalid CUCL io var decl; no var type found." ); }
           if( !(cad.loi.v <= 1) ) { rt_err( "invalid CUCL io var decl; should be exactly zero or one level-of-indirection/*.");}
@@ -133,7 +137,7 @@ namespace boda
     // should be an error if they're *not* used. so we don't want to be listing them in every variant, or if we do, it
     // should only be to check all the proper per-operation-per-varient ones are used. maybe, everything must be used by
     // default? with some way to explicitly ignore some vals that are somehow optional for a given variant?
-    vect_string const always_keep_vals{"conv_has_relu"};
+    vect_string const always_keep_vals{"conv_has_relu","conv_has_res","groups"};
     for( vect_string::const_iterator i = always_keep_vals.begin(); i != always_keep_vals.end(); ++i ) {
       if( rfs_in.has( (*i) ) ) { ret.reduced->set( (*i), rfs_in.get( (*i) ) ); }
     }
@@ -160,8 +164,8 @@ namespace boda
       dims_t const & arg_dims = arg_nda->dims;
       if( !arg_dims.has_name() ) { arg_check_error += "call arg '"+i.vn()+"' must have names for all dims; "; }
       bool const dims_only = !arg_dims.has_sz_and_stride_and_name();
-      if( !dims_only && arg_dims.has_padding() ) { 
-        arg_check_error += "call arg '"+i.vn()+"' must not have padding; "; } // FIXME: maybe too strong
+      if( !dims_only && arg_dims.has_padding() && !i.ad().strided.v ) { // FIXME: maybe too strong for non-_STRIDED args
+        arg_check_error += "call arg '"+i.vn()+"' must not have padding (unless declared _STRIDED); "; }
       bool matches_decl = 0;
       for( uint32_t j = 0; j != i.ad().ok_dims.size(); ++j ) {
         if( arg_dims.matches_template( i.ad().ok_dims[j] ) ) { matches_decl = 1; break; }
@@ -343,7 +347,7 @@ namespace boda
     return ix_dims;
   }
 
-  void rtc_call_gen_t::init( op_base_t const & op_, p_rtc_template_t const & rtc_func_template_, custom_codegen_t * const cc, string const & gen_fn_ ) {
+  void rtc_call_gen_t::init( op_base_t const & op_, p_rtc_template_t const & rtc_func_template_, string const & gen_fn_ ) {
     op = op_;
     assert_st( gen_fn.empty() ); // double init guard
     gen_fn = gen_fn_;
@@ -354,6 +358,13 @@ namespace boda
     //printf( "op.func_name=%s gen_fn=%s op.str_vals=%s\n", str(op.get_func_name()).c_str(), gen_fn.c_str(), str(op.str_vals).c_str() );
     // if we have a str_val with the magic name 'tpb', use it to set the call geom:
     if( op.has( "tpb" ) ) { rtc_call_geom.tpb = op.get_u32( "tpb" ); } // note: the tpb scalar must have a value for now
+  }
+
+  // note: must not touch any shared state (other than reading the template), since rtc_codegen_t::compile() may run
+  // gen() for different functions concurrently.
+  void rtc_call_gen_t::gen( custom_codegen_t * const cc ) {
+    assert_st( !gen_fn.empty() && !is_gen.v );
+    is_gen.v = 1;
     vect_string dyn_arg_names; // to be added to end of arg_names, after all 'regular' args
     for( vect_ix_decl_t::const_iterator i = rtc_func_template->ix_decls.begin(); i != rtc_func_template->ix_decls.end(); ++i ) {
       dims_t ix_dims = apply_use_dims( get_arg_dims_by_name( i->arg_vn, "IX" ), i->use_dims );
@@ -388,9 +399,15 @@ namespace boda
     for( vect_arg_decl_t::multi_iter i = rtc_func_template->arg_decls.multi_begin( &op ); !i.at_end(); ++i ) {
       arg_names.push_back( i.vn() ); // in-order-list of function arg names for rtc level
       //if( i.vn() == "cucl_arg_info" ) { assert_st( rtc_func_template->has_cucl_arg_info.v ); continue; } // FIXME: yeah, not great.
-      if( i.ad().multi.v ) { line( i.ad().vn + "_decl", "GASQ "+i.ad().tn+" const * const "+i.vn()+"," ); }
       p_nda_t const & arg_nda = op.get(i.vn()); // can this fail? if so, need get_arg_dims_by_name()-like error reporting?
       dims_t const & arg_dims = arg_nda->dims;
+      if( i.ad().multi.v ) { 
+        // note: wild-type (i.e. %(ins_tn)_multi) multi args use the type of each call arg. the template var for the
+        // type of the multi arg as a whole (i.e. %(ins_tn)) is that of the first call arg.
+        string const & tn = i.ad().tn.empty() ? arg_dims.tn : i.ad().tn;
+        if( !has( tsvs, i.ad().vn + "_tn" ) ) { set( i.ad().vn + "_tn", tn ); }
+        line( i.ad().vn + "_decl", "GASQ "+tn+" const * const "+i.vn()+"," ); 
+      }
       if( i.ad().dyn.v ) {
         assert_st( i.ad().loi.v == 1 );
         dyn_vars.push_back( dyn_dim_info_t{ i.vn(), i.vn(), vect_string{} } ); 
@@ -493,7 +510,20 @@ namespace boda
     rtc_prog_str += rtc_func_str;      
   }
   
+  void show_rtc_call( rtc_func_call_t const & rfc ) {
+    printf( "%s( %s ) tpb=%s call_blks=%s\n", str(rfc.rtc_func_name).c_str(), str(rfc.arg_map).c_str(),
+            str(rfc.tpb.v).c_str(), str(rfc.blks.v).c_str() );
+  }
+
   uint32_t rcg_func_call_t::run( p_rtc_compute_t const & rtc, bool const & show_rtc_calls ) const {
+    rtc_func_call_t const rfc = get_rtc_func_call( rtc );
+    if( show_rtc_calls ) { show_rtc_call( rfc ); }
+    uint32_t const call_id = rtc->run( rfc );
+    return call_id;
+    // note: temporary rfc is gone after this
+  }
+
+  rtc_func_call_t rcg_func_call_t::get_rtc_func_call( p_rtc_compute_t const & rtc ) const {
     rtc_func_call_t rfc;
     rfc.rtc_func_name = rcg->gen_fn;
     rtc_call_geom_t dyn_rtc_call_geom = rcg->rtc_call_geom;
@@ -570,17 +600,9 @@ namespace boda
       }
     }
 
-    if( show_rtc_calls ) { 
-      printf( "%s( %s ) tpb=%s call_blks=%s\n", str(rfc.rtc_func_name).c_str(), 
-	      str(rfc.arg_map).c_str(),
-	      str(dyn_rtc_call_geom.tpb).c_str(), str(dyn_rtc_call_geom.blks).c_str() );
-      //if( !rfc.cucl_arg_info.empty() ) { printf( "  rfc.cucl_arg_info=%s\n", str(rfc.cucl_arg_info).c_str() ); }
-    } 
     rfc.tpb.v = dyn_rtc_call_geom.tpb;
     rfc.blks.v = dyn_rtc_call_geom.blks;
-    uint32_t const call_id = rtc->run( rfc );
-    return call_id;
-    // note: temporary rfc is gone after this
+    return rfc;
   }
 
   // ****** rtc_codegen_t ******
@@ -604,7 +626,8 @@ namespace boda
     if( !rcg ) { // need to instatiate function and pick unused name
       rcg.reset( new rtc_call_gen_t );
       string gen_fn = gen_unused_fn( *ca_ret.reduced, used_names );
-      rcg->init( *ca_ret.reduced, rtc_template, cc.get(), gen_fn );
+      rcg->init( *ca_ret.reduced, rtc_template, gen_fn );
+      if( rtc_compile_opts.compile_threads == 1 ) { rcg->gen( cc.get() ); } // otherwise, done (in parallel) at compile()
       used_names.insert( gen_fn );
       compile_pend.push_back( rcg );
     } 
@@ -637,13 +660,25 @@ namespace boda
     // nothing pending? do nothing. note that running code below is correct, but calls down to rtc->compile() with no
     // functions, which is probably not the best idea.
     if( compile_pend.empty() ) { return; } 
-    vect_rtc_func_info_t rtc_prog_infos;
-    for( vect_p_rtc_call_gen_t::const_iterator i = compile_pend.begin(); i != compile_pend.end(); ++i ) {
-      rtc_prog_infos.push_back( {(*i)->gen_fn,(*i)->rtc_prog_str,(*i)->arg_names,(*i)->op} );
-      (*i)->is_compiled.v = 1; // well, or at least we're going to *try* to compile this func anyway ...
+    uint32_t const num_threads = rtc_get_num_threads( rtc_compile_opts.compile_threads );
+    {
+      timer_t t("rtc_codegen_gen");
+      rtc_par_for( num_threads, compile_pend.size(), [&]( uint32_t const & pix ) {
+          if( !compile_pend[pix]->is_gen.v ) { compile_pend[pix]->gen( cc.get() ); }
+        } );
+    }
+    // split into (contiguous, so that module contents, and thus program cache keys, are stable) modules
+    uint32_t const num_mods = std::max( 1U, std::min( num_threads, uint32_t( compile_pend.size() / 
+                                                                             std::max( 1U, rtc_compile_opts.min_funcs_per_mod ) ) ) );
+    vector< vect_rtc_func_info_t > mods( num_mods );
+    for( uint32_t pix = 0; pix != compile_pend.size(); ++pix ) {
+      p_rtc_call_gen_t const & rcg = compile_pend[pix];
+      mods[ uint64_t(pix) * num_mods / compile_pend.size() ].push_back( {rcg->gen_fn,rcg->rtc_prog_str,rcg->arg_names,rcg->op} );
+      rcg->is_compiled.v = 1; // well, or at least we're going to *try* to compile this func anyway ...
     }
-    //printf( "rtc_prog_infos=%s\n", str(rtc_prog_infos).c_str() );
-    rtc->compile( rtc_prog_infos, rtc_compile_opts );
+    //printf( "mods=%s\n", str(mods).c_str() );
+    if( num_mods == 1 ) { rtc->compile( mods[0], rtc_compile_opts ); }
+    else { rtc->compile_modules( mods, rtc_compile_opts ); }
     compile_pend.clear();
   }
 
@@ -652,6 +687,16 @@ namespace boda
     return call.run( rtc, rtc_compile_opts.show_rtc_calls );
   }
 
+  uint32_t rtc_codegen_t::bind_func( rcg_func_call_t const & call ) {
+    compile(); // compile any pending funcs
+    return rtc->bind_call( call.get_rtc_func_call( rtc ) );
+  }
+
+  uint32_t rtc_codegen_t::run_bound_func( uint32_t const & bcix ) {
+    if( rtc_compile_opts.show_rtc_calls ) { show_rtc_call( rtc->get_bound_call( bcix ) ); }
+    return rtc->run_bound_call( bcix );
+  }
+
   // clear functions that aren't externally referenced
   void rtc_codegen_t::clear( bool const & dump_only ) {
     if( dump_only ) { printf( "clear(): rtc_func_sigs_map.size()=%s\n", str(rtc_func_sigs_map.size()).c_str() ); }
@@ -7,12 +7,14 @@
 #include"timers.H"
 #include<boost/filesystem.hpp>
 #include<boost/lexical_cast.hpp>
+#include<deque>
 #include"lexp.H"
 #include"conv_util.H"
 
 #include"rtc_func_gen.H"
 #include"rtc_compute.H"
 #include"cnn_op.H"
+#include"op-tuner.H"
 
 namespace boda 
 {
@@ -20,11 +22,38 @@ namespace boda
     p_rcg_func_call_t rfc;
     string call_tag;
     uint32_t call_id;
+    uint32_t bcix; // handle of the pre-bound version of rfc (see rtc_compute_t::bind_call()), if use_launch_plan
     rtc_fwd_func_call_t( p_rcg_func_call_t const &rfc_, string const & call_tag_ ) : 
-      rfc(rfc_), call_tag(call_tag_), call_id( uint32_t_const_max ) {}
+      rfc(rfc_), call_tag(call_tag_), call_id( uint32_t_const_max ), bcix( uint32_t_const_max ) {}
   };
   typedef vector< rtc_fwd_func_call_t > vect_rtc_fwd_func_call_t; 
 
+  // state of a run started with run_fwd_begin()
+  struct rtc_fwd_pass_t {
+    p_map_str_p_nda_float_t fwd;
+    vect_uint32_t xfer_ids;
+  };
+  typedef std::deque< rtc_fwd_pass_t > deque_rtc_fwd_pass_t; 
+
+  // a var being placed by conv_pipe_fwd_t::plan_mem()
+  struct mem_plan_var_t {
+    string vn;
+    uint64_t sz; // in bytes, rounded up to mem_plan_align
+    uint32_t first_use; // live range, as [first_use,last_use] indexes into fwd_calls
+    uint32_t last_use;
+    uint64_t off;
+    bool overlaps( mem_plan_var_t const & o ) const { return (first_use <= o.last_use) && (o.first_use <= last_use); }
+    bool operator < ( mem_plan_var_t const & o ) const { // placement order: largest first, then by first use
+      if( sz != o.sz ) { return sz > o.sz; }
+      if( first_use != o.first_use ) { return first_use < o.first_use; }
+      return vn < o.vn;
+    }
+  };
+  typedef vector< mem_plan_var_t > vect_mem_plan_var_t; 
+  typedef std::pair< uint64_t, uint64_t > pair_uint64_t; 
+  typedef vector< pair_uint64_t > vect_pair_uint64_t; 
+  typedef map< string, uint64_t > map_str_uint64_t; 
+
   struct quantize_ops_t : virtual public nesi // NESI(help="per-layer quantization options") 
   {
     virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
@@ -48,19 +77,31 @@ namespace boda
     rtc_compile_opts_t compile_opts; // NESI(default="()",help="runtime compilation options")
     uint32_t enable_stats; //NESI(default=0,help="if 1, dump stats")
     uint32_t enable_prof; //NESI(default=1,help="if 1, enable profiling")
+    uint32_t use_launch_plan; //NESI(default=1,help="if 1, at init time, pre-bind all fwd calls (resolving their funcs, vars, args, and launch geometry), so that runs just replay them without per-call lookups. if 0, resolve each call as it is run.")
     uint32_t enable_double_run; //NESI(default=0,help="if 1, run ops an extra time before the timed run (doubles run time, might improve timing quality/repeatability).")
     string per_call_fn; //NESI(default="",help="if non-empty, write per-call profiling (timing via events) to given file.")
     vect_p_quantize_ops_t quantize; //NESI(help="per-layer quantize options")
 
     op_tune_t op_tune; //NESI(default="()",help="tuning parameters / options")
+    vect_string i8conv_layers; //NESI(help="if non-empty, use the i8conv variant (see op_tune.i8conv) for exactly the convolutions with these tags, instead of as per op_tune.")
+    p_filename_t i8_calib_fn; //NESI(help="per-var activation ranges (lines of 'var absmax') used to pick the int8 scale of i8conv inputs. see i8_calib_out_fn.")
+    p_filename_t i8_calib_out_fn; //NESI(help="if specified (with enable_stats=1), after each run, write the activation ranges seen so far to this file (as read by i8_calib_fn). run over some sample inputs to calibrate.")
+    p_filename_t op_tune_wisdom_fn; //NESI(help="if specified, read per-op tuning wisdom (i.e. as written by ops-autotune) from this file. ops found there use the op_tune of their fastest error-free run on the current backend's platform instead of op_tune.")
 
     uint32_t enable_bconv; //NESI(default=0,help="if 1, enable bconv")
-    uint32_t enable_write_xpose; //NESI(default=0,help="if 1, enable experimental k1conv write xposing")
+    uint32_t enable_write_xpose; //NESI(default=0,help="if 1, for each conv output var whose readers are all k1convs wanting the same input layout, have the producer write that layout directly, removing the xpose (see select_layouts() for the exact greedy rule). currently, only k1conv can write a non-reference layout (that of the input of other k1convs).")
     uint32_t force_zero_bias; //NESI(default=0,help="if 1, force biases to zero")
     uint32_t flags; //NESI(default=0,help="dynamic flags to pass to kernels that request them (often to trick compiler)")
 
     vect_string dump_vars; // NESI(help="dump out values of these vars after forward")
 
+    uint32_t enable_mem_plan; //NESI(default=0,help="if 1, place internal vars with disjoint live ranges at overlapping offsets of a single arena var. net outputs, dump_vars, and mem_plan_pin_vars are not aliased; other internal vars may not be read (or set) by run_fwd().")
+    vect_string mem_plan_pin_vars; //NESI(help="when enable_mem_plan=1, additional vars to not alias (so that they are valid after run_fwd())")
+    uint32_t mem_plan_align; //NESI(default=4096,help="byte alignment of var offsets in the memory plan arena; must be a multiple of the backend's sub-buffer offset alignment")
+    string storage_tn; //NESI(default="float",help="type in which to store node vars and op params: float or half. with half, ops load half, compute in float, and store half, and run_fwd() converts inputs/outputs to/from float. only supported for forward-only pipes using the conv (with xpose_filts), dwconv, pool, relu, reduce (Eltwise), copy (Concat) and split_copy (Split) ops; other ops will fail to generate.")
+    uint32_t enable_fuse_ops; //NESI(default=0,help="if 1, fuse a residual Eltwise sum (and a following ReLU) into the store of the conv that produces one of its inputs. the conv then adds its output into the other (residual) input's var in place, so the conv output var is not created and the residual var may not be read by run_fwd(). net outputs, dump_vars, and mem_plan_pin_vars are never overwritten this way.")
+    uint32_t enable_chan_views; //NESI(default=0,help="if 1, convs whose output is read only by a Concat write it directly into its chans of the Concat's output var, instead of the Concat copying it there. the conv output var is then a strided view of the Concat output var, and may not be read by run_fwd(). net outputs, dump_vars, and mem_plan_pin_vars are never viewed this way.")
+
     filename_t rtc_func_sigs_fn; //NESI(default="rtc_func_sigs.txt",help="file to hold all generated func signatures")
     uint32_t write_op_sigs; //NESI(default=0,help="if 1, write op sigs to op_sigs_fn")
     filename_t op_sigs_fn; //NESI(default="op_sigs_full.txt",help="file to hold unique op signatures")
@@ -71,9 +112,13 @@ namespace boda
     p_map_str_p_conv_op_t op_infos;
 
     vect_string op_param_names;
+    map_str_vect_string conv_folded_ops; // conv tag -> in-place BatchNorm/Scale ops folded into its filts/biases
     set_string filts_names;
     set_string inxp_names;
     set_string force_zero_names;
+    map_str_float_t i8_calib; // see i8_calib_fn
+    vect_string i8conv_tags; // convs using i8conv, whose int8 filts/scales are set by set_i8conv_params()
+    set_string i8_in_names; // int8-quantized copies of i8conv inputs
 
     vect_string stats_names;
     map_str_float_t stats_map;
@@ -86,7 +131,15 @@ namespace boda
     }
 
     virtual void init( p_conv_pipe_t const & cp_, nesi_init_arg_t * const nia );
+    virtual void rebind( p_conv_pipe_t const & cp_ );
     virtual void run_fwd( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns );
+    virtual void run_fwd_begin( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns );
+    virtual void run_fwd_end( void );
+    virtual void bind_to_thread( void ) { rtc->bind_to_thread(); }
+    deque_rtc_fwd_pass_t in_flight;
+    set_string staging_vns; // double-buffered (by run parity) on-device copies of inputs/outputs for pipelined runs
+    zi_bool stage_parity;
+    string get_staging_var( string const & vn, bool const & parity );
     vect_uint32_t dropout_cixs;
     virtual void set_det_drop_seed( uint32_t const & det_drop_seed_ ) { 
       // sigh.
@@ -95,10 +148,16 @@ namespace boda
 	rcg_func_call_t & rfc = *(fwd_calls[*i].rfc);
 	assert_st( has( rfc.arg_map, "det_drop_seed" ) );
 	rfc.arg_map["det_drop_seed"] = make_scalar_nda(det_drop_seed_);
+	if( use_launch_plan ) { rtc->set_bound_call_arg( fwd_calls[*i].bcix, "det_drop_seed", make_scalar_nda(det_drop_seed_) ); }
       }
     }
+    void bind_fwd_calls( void );
+    uint32_t run_fwd_call( rtc_fwd_func_call_t const & fc ) { 
+      return use_launch_plan ? codegen.run_bound_func( fc.bcix ) : codegen.run_func( *fc.rfc ); 
+    }
 
     void update_stats( void );
+    void write_i8_calib( void );
     string dump_var( string const & n );
     virtual string get_info_log( void );
   protected:
@@ -112,6 +171,60 @@ namespace boda
                                   string const & ret_an, dims_t const & ret_dims, 
                                   string const & func_name, p_conv_op_t const & oi );
     void gen_node_var( string const & name, string const & node_name );
+    void set_rtc_arg( p_conv_op_t const & oi, string const & an, string const & vn );
+
+    // operation fusion. see fuse_ops() and maybe_fuse_eltwise().
+    void fuse_ops( void );
+    void select_layouts( void );
+    bool maybe_fuse_eltwise( p_conv_op_t const & oi );
+    void fuse_concat_ins( p_conv_op_t const & oi );
+    bool is_pinned( string const & vn ) const;
+    p_map_str_p_nda_float_t get_folded_op_params( void );
+    float get_i8_absmax( string const & vn );
+    void gen_i8conv_args( p_conv_op_t const & oi );
+    bool gen_i8conv_i8_out( p_conv_op_t const & oi );
+    void set_i8conv_params( map_str_p_nda_float_t const & op_params );
+    void bind_pipe( p_conv_pipe_t const & cp_ );
+    per_op_tune_map_t per_op_tunes; // see op_tune_wisdom_fn
+
+    // vars created by the current bind_pipe(). all vars are created via the below, so that rebind() can release them.
+    set_string bound_vns;
+    set_string resident_vns; // op param vars kept (with their values) from the previous bind_pipe(); see rebind()
+    void create_bound_var( string const & vn, dims_t const & dims ) { rtc->create_var_with_dims( vn, dims ); bound_vns.insert( vn ); }
+    void create_bound_sub_view_var( string const & vn, dims_t const & dims, string const & src_vn, uint64_t const & byte_off ) {
+      rtc->create_var_with_dims_as_sub_view_of_var( vn, dims, src_vn, byte_off ); bound_vns.insert( vn );
+    }
+
+    set_string gen_done_nodes; // nodes whose final value has been generated (by gen_ops_rec())
+    set_string gen_done_ops; // ops seen by gen_op()
+    set_string fuse_clobbered; // vars overwritten by fused Eltwise sums
+    map_str_str chan_view_base; // Concat input vars that are views of (some chans of) the Concat output var ...
+    map_str_uint32_t chan_view_off; // ... starting at this chan
+    set_string chan_view_bases_done; // Concat output vars already created (by the first of their views to be generated)
+    dims_t get_chan_view_dims( string const & vn ) const;
+    void gen_chan_view_var( string const & vn );
+
+    // memory planning. see plan_mem().
+    map_str_dims_t plan_var_dims; // vars whose allocation is deferred until plan_mem()
+    map_str_dims_t plan_alias_dims; // vars that are deferred views of a planned var ...
+    map_str_str plan_alias_base; // ... namely this one ...
+    map_str_uint64_t plan_alias_off; // ... at this byte offset
+    set_string mem_plan_aliased; // vars placed in the arena (which may not be valid after a run)
+    // with storage_tn=half, all float node vars, op params, and op args are stored as half instead
+    void set_storage_tn( dims_t & dims ) const { if( dims.tn == "float" ) { dims.tn = storage_tn; } }
+    dims_t get_node_dims( string const & nn ) const { dims_t ret = cp->must_get_node( nn )->dims; set_storage_tn( ret ); return ret; }
+    void set_op_storage_tn( p_conv_op_t const & oi );
+    dims_t get_var_dims( string const & vn ) { 
+      map_str_dims_t::const_iterator i = plan_var_dims.find( vn );
+      if( i != plan_var_dims.end() ) { return i->second; }
+      i = plan_alias_dims.find( vn );
+      return ( i == plan_alias_dims.end() ) ? rtc->get_var_dims( vn ) : i->second;
+    }
+    void create_planned_var( string const & vn, dims_t const & dims );
+    void create_planned_alias_var( string const & vn, dims_t const & dims, string const & base_vn, uint64_t const & byte_off );
+    void alloc_planned_var( string const & vn );
+    void plan_mem( void );
+    void check_not_aliased( vect_string const & vns );
     void gen_op( p_conv_op_t const & cop );
     void gen_ops_rec( string const & node_name );
   };
@@ -137,9 +250,34 @@ namespace boda
     }
   }
 
+  // write the abs-max of each var's range (as seen by the stats so far), one 'var absmax' line per var
+  void conv_pipe_fwd_t::write_i8_calib( void ) {
+    if( !enable_stats ) { rt_err( "i8_calib_out_fn requires enable_stats=1" ); }
+    string const max_sfx = "_max_out_sz_1";
+    p_ostream out = ofs_open( *i8_calib_out_fn );
+    for( map_str_float_t::const_iterator i = stats_map.begin(); i != stats_map.end(); ++i ) {
+      if( !endswith( i->first, max_sfx ) ) { continue; }
+      string const vn = string( i->first, 0, i->first.size() - max_sfx.size() );
+      float const min_v = must_find( stats_map, vn + "_min_out_sz_1" );
+      (*out) << strprintf( "%s %s\n", vn.c_str(), str( std::max( fabs(min_v), fabs(i->second) ) ).c_str() );
+    }
+  }
+
+  void read_i8_calib( filename_t const & calib_fn, map_str_float_t & i8_calib ) {
+    p_vect_string lines = readlines_fn( calib_fn );
+    for( vect_string::const_iterator i = lines->begin(); i != lines->end(); ++i ) {
+      vect_string const parts = split( *i, ' ' );
+      if( parts.size() != 2 ) { rt_err( strprintf( "i8 calib file '%s': expected 'var absmax' line, got '%s'",
+                                                   calib_fn.exp.c_str(), i->c_str() ) ); }
+      i8_calib[parts[0]] = lc_str_d( parts[1] );
+    }
+  }
+
   string conv_pipe_fwd_t::dump_var( string const & n ) {
     string ret;
-    p_nda_float_t nda = make_shared< nda_float_t >( rtc->create_nda_from_var( n ) );
+    p_nda_t raw_nda = rtc->create_nda_from_var( n );
+    if( raw_nda->dims.tn == "half" ) { raw_nda = convert_float_half_nda( raw_nda, "float" ); } // see storage_tn
+    p_nda_float_t nda = make_shared< nda_float_t >( raw_nda );
     // dump nda
     ret += strprintf( "dumping var '%s'\n", str(n).c_str() );
     for( dims_iter_t di( nda->dims ) ; ; )  {
@@ -162,11 +300,13 @@ namespace boda
 
   vect_string conv_pipe_fwd_t::gen_op_stats( string const & top_in ) {
     vect_string const reds{ "min","max","sum","hist","cnt" }; // FIXME: dup'd with kernel code
-    uint32_t in_sz = rtc->get_var_dims( top_in ).dims_prod(); // treat input as flat
+    uint32_t in_sz = get_var_dims( top_in ).dims_prod(); // treat input as flat
     uint32_t primary_in = 1;
     assert_st( in_sz );
     string const top_in_reshape = top_in + "_flat_reshape";
+    alloc_planned_var( top_in ); // the view below needs the var to exist now, so don't plan it
     rtc->create_var_with_dims_as_reshaped_view_of_var( top_in_reshape, dims_t{ {in_sz}, {"v"}, "float" }, top_in );
+    bound_vns.insert( top_in_reshape );
     // the var_stats template doesn't specify tpb, so we assume this will be used. we should check this for any gen'd func.
     dims_t arg_dims( {0}, {"v"}, "float" ); // all vars are single-dim with wild/any size
     vect_string cur_ins;
@@ -186,7 +326,7 @@ namespace boda
       vect_string out_args;
       for( uint32_t i = 0; i != reds.size(); ++i ) { 
 	string cur_out = top_in + "_" + reds[i] + "_out_sz_" + str(out_sz);
-	rtc->create_var_with_dims( cur_out, dims_t{ {out_sz}, {"v"}, "float" } );
+	create_bound_var( cur_out, dims_t{ {out_sz}, {"v"}, "float" } );
 	cur_outs.push_back( cur_out );
 	//args.push_back( cur_out );
       }
@@ -215,7 +355,7 @@ namespace boda
     uint32_t drop_mask = ((1<<drop_bits)-1);
     op_base_t quantize_op;
     quantize_op.set_func_name("quantize");
-    quantize_op.set_dims("out",rtc->get_var_dims(top_in));
+    quantize_op.set_dims("out",get_var_dims(top_in));
     quantize_op.set_dims("max_val",make_scalar_dims_t("uint32_t"));
     quantize_op.set_dims("drop_mask",make_scalar_dims_t("uint32_t"));
     p_rcg_func_call_t rtc = codegen.gen_func( quantize_op, map_str_rtc_arg_t{{"out",top_in}, 
@@ -237,11 +377,114 @@ namespace boda
       must_insert( rfc->arg_map, in_an,  in_var  );
       must_insert( rfc->arg_map, ret_an, ret_var );
       add_fwd_call( rfc, in_var + "__inxp" );
-      rtc->create_var_with_dims( ret_var, ret_dims );
+      create_planned_var( ret_var, ret_dims );
     }
     return ret_var;
   }
 
+  float conv_pipe_fwd_t::get_i8_absmax( string const & vn ) {
+    map_str_float_t::const_iterator i = i8_calib.find( vn );
+    if( i == i8_calib.end() ) { rt_err( "i8conv: no calibrated range for var '"+vn+"' in i8_calib_fn. "
+                                        "(re-)calibrate by running with enable_stats=1 and i8_calib_out_fn set." ); }
+    return i->second ? i->second : 1.0f; // an all-zero var can use any scale
+  }
+
+  // i8conv reads int8 versions of its filts (quantized on the host in set_i8conv_params()) and of its input. the input
+  // is quantized on the fly, once per var, using the calibrated range of that var (unless its producer is an i8conv that
+  // already wrote it as int8).
+  void conv_pipe_fwd_t::gen_i8conv_args( p_conv_op_t const & oi ) {
+    string const i8_filts_id = oi->get_arg("filts") + "__i8";
+    create_bound_var( i8_filts_id, oi->get_dims("filts") );
+    create_bound_var( i8_filts_id + "_scale", oi->get_dims("filts_scale") );
+    oi->reset_arg( "filts", i8_filts_id );
+    must_insert( oi->arg_map, "filts_scale", rtc_arg_t( i8_filts_id + "_scale" ) ); // note: dims already set by annotation
+    i8conv_tags.push_back( oi->tag );
+
+    string const in_id = oi->get_arg("in");
+    string const i8_in_id = in_id + "__i8";
+    if( i8_in_names.insert( i8_in_id ).second ) {
+      op_base_t quantize_op;
+      quantize_op.set_func_name("quantize_i8");
+      quantize_op.set_dims("in",get_var_dims(in_id));
+      quantize_op.set_dims("out",oi->get_dims("in"));
+      quantize_op.set_dims("inv_scale",make_scalar_dims_t("float"));
+      create_planned_var( i8_in_id, oi->get_dims("in") );
+      p_rcg_func_call_t rfc = codegen.gen_func( quantize_op, map_str_rtc_arg_t{{"in",in_id},{"out",i8_in_id},
+            {"inv_scale",make_scalar_nda(127.0f/get_i8_absmax(in_id))}} );
+      add_fwd_call( rfc, "quantize_i8__"+in_id );
+    }
+    oi->reset_arg( "in", i8_in_id );
+    must_insert( oi->arg_map, "out_inv_scale", rtc_arg_t( make_scalar_nda(0.0f) ) ); // float output; see gen_i8conv_i8_out()
+  }
+
+  // an i8conv whose output is read only by other i8convs writes it directly as int8 (quantized using the calibrated
+  // range of the output var), so that the int8 data stays int8 between them, with no separate quantize_i8 pass.
+  bool conv_pipe_fwd_t::gen_i8conv_i8_out( p_conv_op_t const & oi ) {
+    if( enable_stats ) { return 0; } // stats are gathered from the float vars
+    string const out_id = oi->get_arg("out");
+    if( is_pinned( out_id ) || (oi->get_dims("out") != get_node_dims( out_id )) ) { return 0; }
+    p_conv_node_t const & no = cp->must_get_node( out_id );
+    for( vect_p_conv_op_t::const_iterator i = no->in_place_ops.begin(); i != no->in_place_ops.end(); ++i ) {
+      if( !must_find( *op_infos, (*i)->tag )->has( "fused" ) ) { return 0; }
+    }
+    if( no->bot_for.empty() ) { return 0; }
+    for( vect_string::const_iterator i = no->bot_for.begin(); i != no->bot_for.end(); ++i ) {
+      p_conv_op_t const & coi = must_find( *op_infos, *i );
+      if( (!coi->has_func_name()) || (coi->get_func_name() != i8conv_str) ) { return 0; }
+    }
+    string const i8_out_id = out_id + "__i8";
+    bool const did_ins = i8_in_names.insert( i8_out_id ).second;
+    assert_st( did_ins ); // the readers of out_id can't have been generated yet
+    dims_t out_dims = oi->get_dims("out");
+    out_dims.tn = "int8_t";
+    create_planned_var( i8_out_id, out_dims );
+    oi->reset_arg( "out", i8_out_id );
+    oi->reset_arg_dims( "out", out_dims );
+    must_replace( oi->arg_map, "out_inv_scale", rtc_arg_t( make_scalar_nda(127.0f/get_i8_absmax(out_id)) ) );
+    return 1;
+  }
+
+  // symmetric per-out-chan quantization of the (folded) float filts of each i8conv. the per-out-chan scale var holds
+  // filts_scale*in_scale, so that i8conv need only multiply its int32 accumulators by it. the int8 filts are written
+  // directly in the blocked layout of i8conv (as per xpose_filts), with zeros for the padding out chans.
+  void conv_pipe_fwd_t::set_i8conv_params( map_str_p_nda_float_t const & op_params ) {
+    for( vect_string::const_iterator i = i8conv_tags.begin(); i != i8conv_tags.end(); ++i ) {
+      p_conv_op_t const & oi = must_find( *op_infos, *i );
+      p_conv_op_t const & cop = cp->get_op( *i ); // note: has the original (float) filts and in var names
+      nda_float_t const & filts = *must_find( op_params, cop->get_arg("filts") );
+      float const in_scale = get_i8_absmax( cop->get_arg("in") ) / 127.0f;
+      uint32_t const num_oc = filts.dims.dsz("out_chan");
+      uint32_t const oc_sz = filts.dims.dstride("out_chan");
+      assert_st( filts.dims.names(0) == "out_chan" );
+      vector< int8_t > q( filts.dims.dims_prod() );
+      p_nda_float_t filts_scale = make_shared<nda_float_t>( oi->get_dims("filts_scale") );
+      for( uint32_t oc = 0; oc != num_oc; ++oc ) {
+        float const * const f = filts.elems_ptr() + oc*oc_sz;
+        float absmax = 0.0f;
+        for( uint32_t j = 0; j != oc_sz; ++j ) { max_eq( absmax, fabs(f[j]) ); }
+        float const scale = absmax ? (absmax / 127.0f) : 1.0f;
+        for( uint32_t j = 0; j != oc_sz; ++j ) {
+          q[oc*oc_sz+j] = int8_t( std::max( -127.0f, std::min( 127.0f, nearbyintf( f[j] / scale ) ) ) );
+        }
+        filts_scale->elems_ptr()[oc] = scale * in_scale;
+      }
+      dims_t const & fd = oi->get_dims("filts"); // out_chan_blk:in_chan:y:x:out_chan_reg:out_chan_tile
+      assert_st( fd.dstride("out_chan_blk") == oc_sz * fd.dsz("out_chan_reg") * fd.dsz("out_chan_tile") );
+      p_nda_t filts_i8 = make_shared<nda_t>( fd );
+      int8_t * const fq = (int8_t *)filts_i8->rp_elems();
+      for( uint32_t ix = 0; ix != fd.dims_prod(); ++ix ) {
+        uint32_t const ocb = ix / fd.dstride("out_chan_blk");
+        uint32_t const ocr = (ix / fd.dstride("out_chan_reg")) % fd.dsz("out_chan_reg");
+        uint32_t const oct = ix % fd.dsz("out_chan_tile");
+        uint32_t const oc = (ocb*fd.dsz("out_chan_tile") + oct)*fd.dsz("out_chan_reg") + ocr;
+        uint32_t const j = (ix % fd.dstride("out_chan_blk")) / fd.dstride("x"); // in_chan:y:x ix within out chan
+        fq[ix] = (oc < num_oc) ? q[oc*oc_sz+j] : 0;
+      }
+      rtc->copy_nda_to_var( oi->get_arg("filts"), filts_i8 );
+      rtc->copy_nda_to_var( oi->get_arg("filts_scale"), filts_scale );
+    }
+  }
+
   // FIXME: mostly dup'd with similar code in rtc_func_gen.cc for generated function signatures
   void write_sigs( set_op_base_t & all_op_sigs, filename_t const & op_sigs_fn ) {
     if( boost::filesystem::is_regular_file( op_sigs_fn.exp ) ) {  // read in existing contents of file if it exists
@@ -256,13 +499,14 @@ namespace boda
     for( set_op_base_t::const_iterator i = all_op_sigs.begin(); i != all_op_sigs.end(); ++i ) { (*out) << str( *i ) << "\n"; }
   }
 
-  void set_rtc_arg( p_conv_op_t const & oi, p_rtc_compute_t const & rtc, string const & an, string const & vn ) {
-    oi->set_arg( rtc->get_var_dims(vn), an, vn );
+  void conv_pipe_fwd_t::set_rtc_arg( p_conv_op_t const & oi, string const & an, string const & vn ) {
+    oi->set_arg( get_var_dims(vn), an, vn );
   }
   
   void conv_pipe_fwd_t::gen_op( p_conv_op_t const & cop ) {
     if( write_op_sigs ) { all_op_sigs.insert( *cop ); } // unique ops if requested
     p_conv_op_t const & oi = must_find( *op_infos, cop->tag );
+    gen_done_ops.insert( oi->tag );
     if( oi->has( "fused" ) ) { return; } // operation was fused into another, so do nothing here for it
     if( oi->is( Concat_coi ) ) {      
       uint32_t chans_out_done = 0;
@@ -270,8 +514,12 @@ namespace boda
 	dims_t const & dims_in = oi->get_dims( oi->coi->bot_an(bi) );
 	assert_st( get_xy_dims( dims_in ) == get_xy_dims( oi->get_dims("out") ) );
 	assert_st( chans_out_done+dims_in.dsz("chan") <= oi->get_dims("out").dsz("chan") );
+        if( has( chan_view_base, oi->get_arg( oi->coi->bot_an(bi) ) ) ) { // already written in place; see fuse_concat_ins()
+          chans_out_done += dims_in.dsz("chan");
+          continue;
+        }
         oi->set_u32( "ocix", chans_out_done );
-	set_rtc_arg( oi, rtc, "in", oi->get_arg( oi->coi->bot_an(bi) ) );
+	set_rtc_arg( oi, "in", oi->get_arg( oi->coi->bot_an(bi) ) );
 	gen_call( oi );
 	chans_out_done += dims_in.dsz("chan");
 	oi->erase_arg( "in" );
@@ -285,7 +533,7 @@ namespace boda
 	assert_st( get_xy_dims( dims_out ) == get_xy_dims( oi->get_dims("in") ) );
 	assert_st( chans_in_done+dims_out.dsz("chan") <= oi->get_dims("in").dsz("chan") );
         oi->set_u32( "icix", chans_in_done );
-	set_rtc_arg( oi, rtc, "out", oi->get_arg( oi->coi->top_an(ti) ) );
+	set_rtc_arg( oi, "out", oi->get_arg( oi->coi->top_an(ti) ) );
 	gen_call( oi );
 	chans_in_done += dims_out.dsz("chan");
 	oi->erase_arg( "out" );
@@ -295,59 +543,86 @@ namespace boda
     } else if( oi->is( Pooling_coi ) ) {
       if( oi->get_u32("emit_out_in_yx") == 1 ) {
 	string const out_in_yx = oi->get_arg("out") + "_in_yx"; 
-	rtc->create_var_with_dims( out_in_yx, oi->get_dims("out") ); // same size as out
-	set_rtc_arg( oi, rtc, "out_in_yx", out_in_yx );
+	create_planned_var( out_in_yx, oi->get_dims("out") ); // same size as out
+	set_rtc_arg( oi, "out_in_yx", out_in_yx );
       } else {
 	assert_st( oi->get_u32("emit_out_in_yx") == 0 );
 	oi->set_null_arg_dims( "out_in_yx", oi->get_dims("out") ); // proper dims, but no var will be passed at call time
       }
       gen_call( oi );
     } else if( oi->is( Convolution_coi ) ) {
-      op_param_names.push_back( oi->get_arg("filts") );
+      bool const is_i8conv = (oi->get_func_name() == i8conv_str);
+      if( !is_i8conv ) { op_param_names.push_back( oi->get_arg("filts") ); } // i8conv filts are set by set_i8conv_params()
       op_param_names.push_back( oi->get_arg("biases") );
       if( force_zero_bias ) { force_zero_names.insert( oi->get_arg("biases") ); }
       string const filts_id = oi->get_arg("filts");
-      if( oi->get_dims("filts") != rtc->get_var_dims( filts_id ) ) { // ipconv uses untransformed filts, otherwise:
+      if( is_i8conv ) { gen_i8conv_args( oi ); }
+      else if( oi->get_dims("filts") != get_var_dims( filts_id ) ) { // ipconv uses untransformed filts, otherwise:
+	string const xpose_filts_fn = (oi->get_func_name() == wconv_str) ? "wconv_xpose_filts" : "xpose_filts";
 	oi->reset_arg( "filts", gen_apply_func_to_var( "filts_ref", oi->get_arg("filts"), "filts", oi->get_dims("filts"), 
-						       "xpose_filts", oi ) );
+						       xpose_filts_fn, oi ) );
       }
       string const in_id = oi->get_arg("in");
-      // note: as this point: oi->get_dims("in") may not == rtc->get_var_dims( in_id ); see comment in init()
+      // note: as this point: oi->get_dims("in") may not == get_var_dims( in_id ); see comment in init()
       if( oi->get_func_name() == tconv_str ) {
 	// assume input needs the below xform and apply it. FIXME(?): fails if vars are in unexpected formats.
 	oi->reset_arg( "in", gen_apply_func_to_var( "in_ref", oi->get_arg("in"), "in", oi->get_dims("in"),
                                                     "tconv_xpose_in", oi ) );
       } else if( oi->get_func_name() == k1conv_str ) {
-	if( oi->get_dims("in") != rtc->get_var_dims( in_id ) ) {
+	if( oi->get_dims("in") != get_var_dims( in_id ) ) {
 	  // if dims not exactly right, assume they are 'normal' dims and convert. FIXME(?): fails if vars are in unexpected formats.
 	  oi->reset_arg( "in", gen_apply_func_to_var( "in_ref", oi->get_arg("in"), "in", oi->get_dims("in"), 
                                                       "k1conv_xpose_in", oi ) );
 	} 	
-      } 
+      } else if( oi->get_func_name() == wconv_str ) {
+	oi->reset_arg( "in", gen_apply_func_to_var( "in_ref", oi->get_arg("in"), "in", oi->get_dims("in"),
+                                                    "wconv_xpose_in", oi ) );
+      }
       // FIXME: perhaps all ops should create outputs. but for now, only conv can have non-reference output dims ...
-      rtc->create_var_with_dims( oi->get_arg("out"), oi->get_dims("out") ); 
-      gen_call( oi );
+      // note: a non-reference-dims output (i.e. from write_xpose) may rely on its initial zeroing for padding, so we
+      // don't plan it.
+      bool const fused_eltwise = maybe_fuse_eltwise( oi ); // if so, "out" is now bound to an existing var
+      string const out_id = oi->get_arg("out");
+      if( oi->get_func_name() == wconv_str ) {
+        // wconv writes winograd-domain output to an intermediate var, which is then xformed into the real output
+        string const wconv_out_id = out_id + "__wconv_out";
+        create_planned_var( wconv_out_id, oi->get_dims("out") );
+        if( !fused_eltwise ) { create_planned_var( out_id, get_node_dims( out_id ) ); }
+        oi->reset_arg( "out", wconv_out_id );
+        gen_call( oi );
+        oi->reset_arg( "out", out_id );
+        p_rcg_func_call_t rfc = codegen.gen_func_override_func_name( "wconv_xpose_out", *oi, 
+                                                                     map_str_rtc_arg_t{{"out",wconv_out_id},{"out_ref",out_id}} );
+        add_fwd_call( rfc, oi->tag + "__outxp" );
+      } else {
+        if( fused_eltwise ) { } 
+        else if( is_i8conv && gen_i8conv_i8_out( oi ) ) { } // if so, "out" is now bound to a new int8 var
+        else if( has( chan_view_base, out_id ) ) { gen_chan_view_var( out_id ); }
+        else if( oi->get_dims("out") == get_node_dims( out_id ) ) { create_planned_var( out_id, oi->get_dims("out") ); }
+        else { create_bound_var( out_id, oi->get_dims("out") ); }
+        gen_call( oi );
+      }
     } else if( oi->is( ReLU_coi ) ) {
       assert_st( oi->get_arg("in") == oi->get_arg("out") ); // check that this is a single in-out in-place operation
-      set_rtc_arg( oi, rtc, "inout", oi->get_arg("in") );
+      set_rtc_arg( oi, "inout", oi->get_arg("in") );
       gen_call( oi );
     } else if( oi->is( LRN_coi ) ) {
       assert_st( oi->get_dims("in") == oi->get_dims("out") ); // FIXME: better place/way for this check?
       if( oi->get_u32("emit_out_scale_base") == 1 ) {
 	string const out_scale_base = oi->get_arg("out") + "_scale_base"; 
-	rtc->create_var_with_dims( out_scale_base, oi->get_dims("out") ); // same size as out
-	set_rtc_arg( oi, rtc, "out_scale_base", out_scale_base );
+	create_planned_var( out_scale_base, oi->get_dims("out") ); // same size as out
+	set_rtc_arg( oi, "out_scale_base", out_scale_base );
       } else {
 	assert_st( oi->get_u32("emit_out_scale_base") == 0 );
 	oi->set_null_arg_dims( "out_scale_base", oi->get_dims("out") );
       }
       gen_call( oi );
     } else if( oi->is( BckLRN_coi ) ) {
-      set_rtc_arg( oi, rtc, "out_scale_base", oi->get_arg("out") + "_scale_base" ); // generated by matching LRN op
+      set_rtc_arg( oi, "out_scale_base", oi->get_arg("out") + "_scale_base" ); // generated by matching LRN op
       gen_call( oi );
     } else if( oi->is( Dropout_coi ) ) {
       assert_st( oi->get_arg("in") == oi->get_arg("out") ); // check that this is a single in-out in-place operation
-      set_rtc_arg( oi, rtc, "inout", oi->get_arg("in") );
+      set_rtc_arg( oi, "inout", oi->get_arg("in") );
       gen_call( oi );
       // FIXME: move this check (and others like it) to conv_util.cc or similar?
       float const dropout_ratio = SNE<float>( *oi->get("dropout_ratio") );
@@ -358,22 +633,22 @@ namespace boda
       dropout_cixs.push_back( fwd_calls.size() - 1 );
     } else if( oi->is( BckDropout_coi ) ) {
       assert_st( oi->get_arg("in") == oi->get_arg("out") ); // check that this is a single in-out in-place operation
-      set_rtc_arg( oi, rtc, "inout", oi->get_arg("in") );
+      set_rtc_arg( oi, "inout", oi->get_arg("in") );
       gen_call( oi ); // Backwards of dropout is dropout
       must_insert( fwd_calls.back().rfc->arg_map, "det_drop_seed", rtc_arg_t() );
       dropout_cixs.push_back( fwd_calls.size() - 1 );
     } else if( oi->is( SoftmaxWithLoss_coi ) ) {
       string const prob_node_name = oi->tag + "_prob";
       gen_node_var( prob_node_name, oi->get_arg("in") );
-      set_rtc_arg( oi, rtc, "prob", prob_node_name );
+      set_rtc_arg( oi, "prob", prob_node_name );
       string const loss_per_pel = oi->get_arg("loss") + "_per_pel"; // same size as label
       gen_node_var( loss_per_pel, oi->get_arg("label") );
-      set_rtc_arg( oi, rtc, "loss_per_pel", loss_per_pel );
+      set_rtc_arg( oi, "loss_per_pel", loss_per_pel );
       gen_call( "softmax", oi );
       gen_call( "sm_grad_and_loss", oi  );
       gen_call( "sum_loss_over_imgs", oi );
     } else if( oi->is( Spreading_coi ) ) {
-      set_rtc_arg( oi, rtc, "out_in_yx", oi->get_arg("out") + "_in_yx" ); // generated by matching Pooling op
+      set_rtc_arg( oi, "out_in_yx", oi->get_arg("out") + "_in_yx" ); // generated by matching Pooling op
       gen_call( oi );
     } else if( oi->is( BckConv_coi ) ) { 
       // { in, filts, biases, out_grad_loss } --> { in_grad_loss, filts_grad_loss, biases_grad_loss }
@@ -387,7 +662,7 @@ namespace boda
       // assert_st( oi->get_func_name() == conv_str );
       if( enable_bconv ) {
 #if 0
-	dims_t const & ogl_dims = rtc->get_var_dims( ogl_vn );
+	dims_t const & ogl_dims = get_var_dims( ogl_vn );
 	dims_t const & ogl_xp_dims = ogl_dims; // oi->dims_vals["out_grad_loss"];
 	string ogl_xp_fn = gen_func( op_base_t{ "btconv_ogl_xpose", {ogl_dims,ogl_xp_dims}, 
 	      oi->dims_vals, oi->str_vals } );
@@ -401,6 +676,11 @@ namespace boda
       gen_call( fgl_fn, oi );
     } else if( oi->is( ZeroIfNonPos_coi ) || oi->is( Softmax_coi ) || oi->is( Reduce_coi ) ) { 
       gen_call( oi ); // 'generic' cases (yes, there's only a few currently, but ya gotta dream, right?)
+    } else if( oi->is( Eltwise_coi ) ) {
+      if( !oi->has_func_name() ) { rt_err( "gen_op: unhandled Eltwise operation (only SUM is supported): " + oi->tag ); }
+      gen_call( oi );
+    } else if( oi->is( BatchNorm_coi ) || oi->is( Scale_coi ) ) { // these have no kernels; see fuse_ops()
+      rt_err( "gen_op: "+oi->get_type()+" op '"+oi->tag+"' could not be folded into a directly preceding Convolution" );
     } else { rt_err( "gen_op: unhandled op of type: " + oi->get_type() ); }
   }
 
@@ -425,7 +705,158 @@ namespace boda
   // gen_node_var() creates a var directly corresponding to a pipe node.  usually, but not always, name == node_node; in
   // that case the var is directly mirroring a pipe node
   void conv_pipe_fwd_t::gen_node_var( string const & name, string const & node_name ) { 
-    rtc->create_var_with_dims( name, cp->must_get_node(node_name)->dims );
+    create_planned_var( name, get_node_dims( node_name ) );
+  }
+
+  // with enable_mem_plan=1, the allocation of internal vars is deferred until plan_mem(), where they may be aliased
+  void conv_pipe_fwd_t::create_planned_var( string const & vn, dims_t const & dims ) {
+    if( enable_mem_plan ) { must_insert( plan_var_dims, vn, dims ); }
+    else { create_bound_var( vn, dims ); }
+  }
+  // allocate a planned var now (i.e. don't alias it). does nothing for non-planned vars.
+  void conv_pipe_fwd_t::alloc_planned_var( string const & vn ) {
+    map_str_dims_t::iterator i = plan_var_dims.find( vn );
+    if( i == plan_var_dims.end() ) { return; }
+    create_bound_var( vn, i->second );
+    plan_var_dims.erase( i );
+  }
+  // create vn as a view of base_vn, starting at byte_off. if base_vn is planned (or is itself such a view of a planned
+  // var), so is the view.
+  void conv_pipe_fwd_t::create_planned_alias_var( string const & vn, dims_t const & dims, string const & base_vn,
+                                                  uint64_t const & byte_off ) {
+    map_str_str::const_iterator a = plan_alias_base.find( base_vn );
+    string const planned_vn = ( a == plan_alias_base.end() ) ? base_vn : a->second;
+    if( has( plan_var_dims, planned_vn ) ) { 
+      must_insert( plan_alias_dims, vn, dims ); 
+      must_insert( plan_alias_base, vn, planned_vn );
+      must_insert( plan_alias_off, vn, byte_off + ( ( a == plan_alias_base.end() ) ? 0 : must_find( plan_alias_off, base_vn ) ) );
+    } else { create_bound_sub_view_var( vn, dims, base_vn, byte_off ); }
+  }
+
+  // the dims of Concat input vn as a view of its chans of the Concat output var: the same dims as the output var,
+  // including its strides, but with only vn's number of chans. the view ends just after its last element.
+  dims_t conv_pipe_fwd_t::get_chan_view_dims( string const & vn ) const {
+    dims_t ret = get_node_dims( must_find( chan_view_base, vn ) );
+    ret.must_get_dim_by_name( "chan" ).sz = get_node_dims( vn ).dsz( "chan" );
+    ret.strides_sz = 1;
+    for( uint32_t d = 0; d != ret.sz(); ++d ) { ret.strides_sz += uint64_t( ret.dims(d) - 1 ) * ret.strides(d); }
+    return ret;
+  }
+  // create Concat input vn as a view of the Concat output var. the first such view to be generated creates the output var.
+  void conv_pipe_fwd_t::gen_chan_view_var( string const & vn ) {
+    string const & base_vn = must_find( chan_view_base, vn );
+    if( chan_view_bases_done.insert( base_vn ).second ) { gen_node_var( base_vn, base_vn ); }
+    dims_t const dims = get_chan_view_dims( vn );
+    create_planned_alias_var( vn, dims, base_vn, uint64_t( must_find( chan_view_off, vn ) ) * dims.dstride( "chan" ) * dims.tsz() );
+  }
+
+  // static memory planning. fwd_calls is in the (topological) order generated by gen_ops_rec(), so we first take the
+  // live range of each planned var to be from the first to the last call that uses it. then, we greedily (largest var
+  // first) place each var at the lowest offset in a single arena var that doesn't overlap any already-placed var with
+  // an intersecting live range. pinned vars, as well as vars not used by any call, are allocated normally. views
+  // created with create_planned_alias_var() count as uses of their base var, and are placed with it (at their offset).
+  void conv_pipe_fwd_t::plan_mem( void ) {
+    if( !enable_mem_plan ) { assert_st( plan_var_dims.empty() ); return; }
+    timer_t t("conv_pipe_fwd_t::plan_mem");
+    if( !mem_plan_align ) { rt_err( "mem_plan_align must be non-zero" ); }
+    uint64_t naive_sz = 0;
+    for( map_str_dims_t::const_iterator i = plan_var_dims.begin(); i != plan_var_dims.end(); ++i ) { naive_sz += i->second.bytes_sz(); }
+    uint64_t unaliased_sz = 0;
+    vect_string pin_vns( cp->tops.begin(), cp->tops.end() );
+    pin_vns.insert( pin_vns.end(), dump_vars.begin(), dump_vars.end() );
+    pin_vns.insert( pin_vns.end(), mem_plan_pin_vars.begin(), mem_plan_pin_vars.end() );
+    for( vect_string::const_iterator i = pin_vns.begin(); i != pin_vns.end(); ++i ) { 
+      map_str_str::const_iterator a = plan_alias_base.find( *i );
+      string const & vn = ( a == plan_alias_base.end() ) ? *i : a->second;
+      if( has( plan_var_dims, vn ) ) { unaliased_sz += must_find( plan_var_dims, vn ).bytes_sz(); alloc_planned_var( vn ); }
+    }
+
+    vect_mem_plan_var_t pvs;
+    map_str_uint32_t pv_ixs; // index into pvs for each var
+    for( uint32_t cix = 0; cix != fwd_calls.size(); ++cix ) {
+      map_str_rtc_arg_t const & arg_map = fwd_calls[cix].rfc->arg_map;
+      for( map_str_rtc_arg_t::const_iterator i = arg_map.begin(); i != arg_map.end(); ++i ) {
+	if( (!i->second.is_valid()) || (!i->second.is_var()) ) { continue; } // note: unset det_drop_seed args are invalid
+	map_str_str::const_iterator a = plan_alias_base.find( i->second.n );
+	map_str_dims_t::const_iterator pvd = plan_var_dims.find( ( a == plan_alias_base.end() ) ? i->second.n : a->second );
+	if( pvd == plan_var_dims.end() ) { continue; }
+	map_str_uint32_t::const_iterator pvi = pv_ixs.find( pvd->first );
+	if( pvi != pv_ixs.end() ) { pvs[pvi->second].last_use = cix; continue; }
+	must_insert( pv_ixs, pvd->first, pvs.size() );
+	pvs.push_back( mem_plan_var_t{ pvd->first, u64_ceil_align( pvd->second.bytes_sz(), mem_plan_align ), cix, cix, 0 } );
+      }
+    }
+
+    std::sort( pvs.begin(), pvs.end() );
+    uint64_t arena_sz = 0;
+    for( vect_mem_plan_var_t::iterator i = pvs.begin(); i != pvs.end(); ++i ) {
+      vect_pair_uint64_t conflicts; // [begin,end) offsets of placed vars that are live at the same time as *i
+      for( vect_mem_plan_var_t::const_iterator j = pvs.begin(); j != i; ++j ) {
+	if( i->overlaps( *j ) ) { conflicts.push_back( std::make_pair( j->off, j->off + j->sz ) ); }
+      }
+      std::sort( conflicts.begin(), conflicts.end() );
+      i->off = 0;
+      for( vect_pair_uint64_t::const_iterator j = conflicts.begin(); j != conflicts.end(); ++j ) {
+	if( (i->off + i->sz) <= j->first ) { break; } // fits in gap before this conflict
+	max_eq( i->off, j->second );
+      }
+      max_eq( arena_sz, i->off + i->sz );
+    }
+
+    string const arena_vn = "__mem_plan_arena";
+    if( arena_sz ) { 
+      // note: we use a float arena (rather than uint8_t) only to allow larger arenas, since dims are 32-bit.
+      assert_st( !(arena_sz % sizeof(float)) ); // since mem_plan_align is a multiple of 4 
+      if( (arena_sz / sizeof(float)) > uint32_t_const_max ) { rt_err( "memory plan arena too large: arena_sz=" + str(arena_sz) ); }
+      create_bound_var( arena_vn, dims_t{ {uint32_t(arena_sz / sizeof(float))}, {"v"}, "float" } );
+    }
+    for( vect_mem_plan_var_t::const_iterator i = pvs.begin(); i != pvs.end(); ++i ) {
+      create_bound_sub_view_var( i->vn, must_find( plan_var_dims, i->vn ), arena_vn, i->off );
+      must_erase( plan_var_dims, i->vn );
+      mem_plan_aliased.insert( i->vn );
+    }
+    // anything left wasn't used by any call; just allocate it
+    for( map_str_dims_t::const_iterator i = plan_var_dims.begin(); i != plan_var_dims.end(); ++i ) { 
+      unaliased_sz += i->second.bytes_sz();
+      create_bound_var( i->first, i->second ); 
+    }
+    plan_var_dims.clear();
+    for( map_str_str::const_iterator i = plan_alias_base.begin(); i != plan_alias_base.end(); ++i ) {
+      dims_t const & dims = must_find( plan_alias_dims, i->first );
+      uint64_t const & byte_off = must_find( plan_alias_off, i->first );
+      vect_mem_plan_var_t::const_iterator pv = pvs.begin();
+      while( (pv != pvs.end()) && (pv->vn != i->second) ) { ++pv; }
+      if( pv == pvs.end() ) { create_bound_sub_view_var( i->first, dims, i->second, byte_off ); } // base not in arena
+      else {
+	create_bound_sub_view_var( i->first, dims, arena_vn, pv->off + byte_off );
+	mem_plan_aliased.insert( i->first );
+      }
+    }
+    plan_alias_base.clear();
+    plan_alias_dims.clear();
+    plan_alias_off.clear();
+    if( enable_stats ) {
+      printf( "mem_plan: naive_sz=%s planned_sz=%s (arena_sz=%s unaliased_sz=%s) num_aliased_vars=%s\n", 
+	      str(naive_sz).c_str(), str(arena_sz+unaliased_sz).c_str(), str(arena_sz).c_str(), str(unaliased_sz).c_str(), 
+	      str(mem_plan_aliased.size()).c_str() );
+    }
+  }
+
+  void conv_pipe_fwd_t::check_not_aliased( vect_string const & vns ) {
+    for( vect_string::const_iterator i = vns.begin(); i != vns.end(); ++i ) {
+      if( has( mem_plan_aliased, *i ) ) { 
+	rt_err( "var '"+*i+"' shares storage with other vars due to enable_mem_plan=1, so it can't be set/read by run_fwd(); "
+		"add it to mem_plan_pin_vars to allow this." );
+      }
+      if( has( fuse_clobbered, *i ) ) { 
+	rt_err( "var '"+*i+"' is overwritten by a fused Eltwise sum due to enable_fuse_ops=1, so it can't be set/read by "
+		"run_fwd(); add it to mem_plan_pin_vars to allow this." );
+      }
+      if( has( chan_view_base, *i ) ) { 
+	rt_err( "var '"+*i+"' is a strided view of the output of a Concat due to enable_chan_views=1, so it can't be set/read "
+		"by run_fwd(); add it to mem_plan_pin_vars to allow this." );
+      }
+    }
   }
 
   // quantize command line example:
@@ -435,7 +866,9 @@ namespace boda
 
   void conv_pipe_fwd_t::gen_ops_rec( string const & node_name ) {
     p_conv_node_t node = cp->must_get_node( node_name );
-    if( node->top_for.empty() ) { gen_node_var( node_name, node_name ); }
+    if( node->top_for.empty() ) { // inputs/params are set from outside, so they're never planned
+      if( !has( resident_vns, node_name ) ) { create_bound_var( node_name, get_node_dims( node_name ) ); }
+    }
     else { assert( node->top_for.size() == 1 ); } // multiple writers not handled
 
     // in-place ops for this node
@@ -452,57 +885,269 @@ namespace boda
       vect_string new_stats_names = gen_op_stats( node_name );
       stats_names.insert( stats_names.end(), new_stats_names.begin(), new_stats_names.end() );
     }
+    gen_done_nodes.insert( node_name );
 
     for( vect_string::const_iterator i = node->bot_for.begin(); i != node->bot_for.end(); ++i ) {
       p_conv_op_t const & cop = cp->get_op( *i );
       if( !cop->on_seen_bot() ) { continue; } // wait till we've seen all bottoms
-      for( vect_string::const_iterator j = cop->tops.begin(); j != cop->tops.end(); ++j ) {  // generate output nodes
-	if( !cop->is(Convolution_coi) ) { gen_node_var( *j, *j ); } // only if not conv (which explicitly/manually creates node var)
+      // generate output nodes, but not for conv (which explicitly/manually creates node var) or fused-away ops
+      // or for Concat outputs already created by a view of them (see gen_chan_view_var())
+      bool const gen_tops = !( cop->is(Convolution_coi) || must_find( *op_infos, cop->tag )->has( "fused" ) );
+      for( vect_string::const_iterator j = cop->tops.begin(); j != cop->tops.end(); ++j ) {
+	if( gen_tops && !has( chan_view_bases_done, *j ) ) { gen_node_var( *j, *j ); }
       }
       gen_op( cop );
       for( vect_string::const_iterator j = cop->tops.begin(); j != cop->tops.end(); ++j ) { gen_ops_rec( *j ); }
     }
   }
 
-  p_rtc_compute_t make_p_rtc_compute_t_init_and_check_unused_from_lexp( p_lexp_t const & lexp, nesi_init_arg_t * const nia );
-
-  void conv_pipe_fwd_t::init( p_conv_pipe_t const & cp_, nesi_init_arg_t * const nia ) {
-    cp = cp_;
-    assert_st( cp );
-
-    op_infos.reset( new map_str_p_conv_op_t ); // maybe we should have our own copy of cp, but instead we only copy convs
+  // these parts might go in init, but they need to know about the overall graph of operations. so we'll call these a
+  // set of post-init() but pre-codegen() graph operations on the set of conv_op_t's. both the whole graphs and all
+  // individual operations should be valid for codegen and correct both before and after this pass (i.e. it is stricty
+  // an optimzation pass). note that Eltwise fusion depends on the order of generation, so it happens later; see
+  // maybe_fuse_eltwise().
+  void conv_pipe_fwd_t::fuse_ops( void ) {
     for( map_str_p_conv_op_t::iterator i = cp->convs->begin(); i != cp->convs->end(); ++i ) { 
-      must_insert( *op_infos, i->first, make_shared< conv_op_t >( *i->second ) );
+      p_conv_op_t const & oi = must_find( *op_infos, i->first );
+      if( oi->is( Convolution_coi ) ) {
+	p_conv_node_t no = cp->must_get_node( oi->get_arg("out") ); // aka oi->coi->top_an(0) ...
+	// fold leading BatchNorm/Scale in-place ops into the conv's filts/biases (see get_folded_op_params()). note that,
+	// since they are in-place, nothing can read the conv's output before they are applied.
+	uint32_t num_fused = 0;
+	for( ; num_fused != no->in_place_ops.size(); ++num_fused ) {
+	  p_conv_op_t const & ipo = no->in_place_ops[num_fused];
+	  if( !( ipo->is(BatchNorm_coi) || ipo->is(Scale_coi) ) ) { break; }
+	  must_find( *op_infos, ipo->tag )->set_u32( "fused", 1 );
+	  conv_folded_ops[oi->tag].push_back( ipo->tag );
+	}
+	bool const conv_has_relu = (no->in_place_ops.size() > num_fused) && (no->in_place_ops[num_fused]->is(ReLU_coi));
+	// mark relu as fused-away; mark conv as having fused-on relu // NOTE/FIXME(?): relu may be not-init()-yet here ...
+	if( conv_has_relu ) { must_find( *op_infos, no->in_place_ops[num_fused]->tag )->set_u32( "fused", 1 ); ++num_fused; } 
+	oi->set_u32( "conv_has_relu", conv_has_relu );
+      }
     }
+    if( enable_write_xpose ) { select_layouts(); } // note: depends on which in-place ops were fused above
+    // note: this must follow the above, since it depends on which in-place ops were fused and on write xposing
     for( map_str_p_conv_op_t::iterator i = cp->convs->begin(); i != cp->convs->end(); ++i ) { 
       p_conv_op_t const & oi = must_find( *op_infos, i->first );
-      add_cnn_codegen_annotations( oi.get(), op_tune, 0 );
+      if( oi->is( Concat_coi ) ) { fuse_concat_ins( oi ); }
     }
+  }
 
-    // these parts might go in init, but they need to know about the overall graph of operations. so we'll call these a
-    // set of post-init() but pre-codegen() graph operations on the set of conv_op_t's. both the whole graphs and all
-    // individual operations should be valid for codegen and correct both before and after this pass (i.e. it is stricty
-    // an optimzation pass).
+  // the layout a reader op wants for its input var: for the variants that xpose their input (see gen_op()), the xposed
+  // layout; otherwise, the reference (node) layout.
+  dims_t get_wanted_in_layout( p_conv_op_t const & roi, dims_t const & ref_dims ) {
+    if( roi->is( Convolution_coi ) ) {
+      string const & fn = roi->get_func_name();
+      if( (fn == k1conv_str) || (fn == tconv_str) || (fn == wconv_str) ) { return roi->get_dims( "in" ); }
+    }
+    return ref_dims;
+  }
+
+  // greedy per-node layout selection. for each conv output node, we pick the reference layout unless all of these
+  // hold, in which case the producer writes the node in the one layout all its readers want, saving the one xpose
+  // they would otherwise share (see gen_apply_func_to_var()): (1) nothing needs the reference layout: the node isn't
+  // pinned (run_fwd() reads pinned vars in the reference layout), and all in-place ops on it are fused; (2) every
+  // reader is a k1conv, as only k1conv skips its input xpose when its input is already in the wanted layout (see
+  // gen_op()); (3) all readers want the same layout, since the xpose functions all assume a reference-layout input;
+  // and (4) the producer can write that layout. there is no cost model: the only choice is xpose-or-not, and a
+  // non-reference layout is only ever chosen when it removes the xpose entirely. if a layout other than the reference
+  // one is chosen, the producer's "out" arg dims are set to it; codegen notices this and writes in that layout.
+  void conv_pipe_fwd_t::select_layouts( void ) {
     for( map_str_p_conv_op_t::iterator i = cp->convs->begin(); i != cp->convs->end(); ++i ) { 
       p_conv_op_t const & oi = must_find( *op_infos, i->first );
-      if( oi->is( Convolution_coi ) ) {
-	p_conv_node_t no = cp->must_get_node( oi->get_arg("out") ); // aka oi->coi->top_an(0) ...
-	bool const conv_has_relu = (no->in_place_ops.size() > 0) && (no->in_place_ops[0]->is(ReLU_coi));
-	// mark relu as fused-away; mark conv as having fused-on relu // NOTE/FIXME(?): relu may be not-init()-yet here ...
-	if( conv_has_relu ) { must_find( *op_infos, no->in_place_ops[0]->tag )->set_u32( "fused", 1 ); } 
-	oi->set_u32( "conv_has_relu", conv_has_relu );
+      if( !oi->is( Convolution_coi ) ) { continue; }
+      string const out_id = oi->get_arg("out");
+      p_conv_node_t const & no = cp->must_get_node( out_id );
+      if( is_pinned( out_id ) || no->bot_for.empty() ) { continue; }
+      bool all_fused = 1;
+      for( vect_p_conv_op_t::const_iterator j = no->in_place_ops.begin(); j != no->in_place_ops.end(); ++j ) {
+        if( !must_find( *op_infos, (*j)->tag )->has( "fused" ) ) { all_fused = 0; }
+      }
+      if( !all_fused ) { continue; }
+      dims_t const ref_dims = get_node_dims( out_id );
+      dims_t wanted; // the one layout all readers want, if any
+      bool all_want_same = 1;
+      for( vect_string::const_iterator j = no->bot_for.begin(); j != no->bot_for.end(); ++j ) {
+        p_conv_op_t const & roi = must_find( *op_infos, *j );
+        if( !(roi->is( Convolution_coi ) && (roi->get_func_name() == k1conv_str)) ) { all_want_same = 0; break; }
+        dims_t const w = get_wanted_in_layout( roi, ref_dims );
+        if( wanted.empty() ) { wanted = w; }
+        else if( w != wanted ) { all_want_same = 0; break; }
+      }
+      if( (!all_want_same) || (wanted == ref_dims) ) { continue; }
+      // k1conv can write the input layout of a k1conv with the same pels blocking (see gen_op_k1conv())
+      bool const can_write = (oi->get_func_name() == k1conv_str) && wanted.get_dim_by_name("blk") && 
+        (wanted.dsz("blk_pel") == oi->get_dims( "in" ).dsz("blk_pel"));
+      if( can_write ) { oi->reset_arg_dims( "out", wanted ); }
+    }
+  }
+
+  // if enabled, for each input of Concat oi that is produced by a conv, has no other readers, and is otherwise
+  // unobservable, make it a view of its chans of oi's output var (see gen_chan_view_var()), so that the conv writes
+  // its output there directly, and oi need not copy it. the conv's "out" arg dims are set to the (strided) view's
+  // dims, so the conv is generated to store using the strides of oi's output.
+  void conv_pipe_fwd_t::fuse_concat_ins( p_conv_op_t const & oi ) {
+    if( (!enable_chan_views) || enable_stats ) { return; } // note: stats are gathered from (whole) node vars
+    string const out_id = oi->get_arg("out");
+    uint32_t chans_out_done = 0;
+    for( uint32_t bi = 0; bi != oi->get_u32("ins_num"); ++bi ) {
+      string const in_id = oi->get_arg( oi->coi->bot_an(bi) );
+      uint32_t const in_chan_off = chans_out_done;
+      chans_out_done += get_node_dims( in_id ).dsz("chan");
+      p_conv_node_t const & no = cp->must_get_node( in_id );
+      if( (no->top_for.size() != 1) || (no->bot_for.size() != 1) || is_pinned( in_id ) ) { continue; }
+      bool all_fused = 1;
+      for( vect_p_conv_op_t::const_iterator j = no->in_place_ops.begin(); j != no->in_place_ops.end(); ++j ) {
+        if( !must_find( *op_infos, (*j)->tag )->has( "fused" ) ) { all_fused = 0; }
+      }
+      if( !all_fused ) { continue; }
+      p_conv_op_t const & poi = must_find( *op_infos, no->top_for[0] ); // producer
+      if( !poi->is( Convolution_coi ) ) { continue; }
+      // these variants all store to "out" using its strides (see the CUCL OUT_STRIDED decls in their templates)
+      string const & fn = poi->get_func_name();
+      if( !( (fn == conv_str) || (fn == k1conv_str) || (fn == tconv_str) || (fn == dwconv_str) ) ) { continue; }
+      if( poi->get_dims("out") != get_node_dims( in_id ) ) { continue; } // i.e. write_xpose
+      must_insert( chan_view_base, in_id, out_id );
+      must_insert( chan_view_off, in_id, in_chan_off );
+      poi->reset_arg_dims( "out", get_chan_view_dims( in_id ) );
+    }
+  }
+
+  // net outputs, dump_vars, mem_plan_pin_vars, and quantized vars must keep their own (unshared) storage
+  bool conv_pipe_fwd_t::is_pinned( string const & vn ) const {
+    vect_string pin_vns( cp->tops.begin(), cp->tops.end() );
+    pin_vns.insert( pin_vns.end(), dump_vars.begin(), dump_vars.end() );
+    pin_vns.insert( pin_vns.end(), mem_plan_pin_vars.begin(), mem_plan_pin_vars.end() );
+    for( vect_p_quantize_ops_t::const_iterator i = quantize.begin(); i != quantize.end(); ++i ) { pin_vns.push_back( (*i)->name ); }
+    return std::find( pin_vns.begin(), pin_vns.end(), vn ) != pin_vns.end();
+  }
+
+  // if enabled and possible, fuse the Eltwise sum that reads the output of conv oi (and any ReLU on its result) into
+  // oi. if so, the Eltwise output var is created as a view of its other (residual) input var, "out" of oi is rebound
+  // to it, and oi is marked with conv_has_res=1, so that it adds its output into the residual in place. this is only
+  // valid if the residual is already computed and has no other readers left to generate, which depends on the order
+  // of generation, so we check it at gen_op() time, just before generating oi.
+  bool conv_pipe_fwd_t::maybe_fuse_eltwise( p_conv_op_t const & oi ) {
+    if( (!enable_fuse_ops) || enable_stats ) { return 0; }
+    string const & fn = oi->get_func_name();
+    if( !( (fn == conv_str) || (fn == k1conv_str) || (fn == tconv_str) || (fn == wconv_str) || (fn == dwconv_str) ) ) { return 0; }
+    string const out_id = oi->get_arg("out");
+    p_conv_node_t const & no = cp->must_get_node( out_id );
+    if( (fn != wconv_str) && (oi->get_dims("out") != get_node_dims( out_id )) ) { return 0; } // i.e. write_xpose
+    if( oi->get_u32( "conv_has_relu" ) ) { return 0; }
+    for( vect_p_conv_op_t::const_iterator i = no->in_place_ops.begin(); i != no->in_place_ops.end(); ++i ) {
+      if( !must_find( *op_infos, (*i)->tag )->has( "fused" ) ) { return 0; }
+    }
+    if( no->bot_for.size() != 1 ) { return 0; }
+    p_conv_op_t const & eoi = must_find( *op_infos, no->bot_for[0] );
+    if( (!eoi->is( Eltwise_coi )) || (!eoi->has_func_name()) || eoi->has( "fused" ) || (eoi->bots.size() != 2) ) { return 0; }
+    string const res_id = eoi->bots[ eoi->bots[0] == out_id ];
+    if( res_id == out_id ) { return 0; }
+    p_conv_node_t const & rn = cp->must_get_node( res_id );
+    if( rn->top_for.empty() || (!has( gen_done_nodes, res_id )) ) { return 0; } // not an already-computed internal var
+    for( vect_string::const_iterator i = rn->bot_for.begin(); i != rn->bot_for.end(); ++i ) {
+      if( (*i != eoi->tag) && (!has( gen_done_ops, *i )) ) { return 0; } // residual still has other readers to generate
+    }
+    if( std::find( oi->bots.begin(), oi->bots.end(), res_id ) != oi->bots.end() ) { return 0; } // oi reads residual
+    if( is_pinned( out_id ) || is_pinned( res_id ) ) { return 0; }
+
+    string const & eo_id = eoi->tops[0];
+    p_conv_node_t const & eon = cp->must_get_node( eo_id );
+    bool const has_relu = (!eon->in_place_ops.empty()) && eon->in_place_ops[0]->is( ReLU_coi );
+    eoi->set_u32( "fused", 1 );
+    if( has_relu ) { must_find( *op_infos, eon->in_place_ops[0]->tag )->set_u32( "fused", 1 ); }
+    oi->erase( "conv_has_relu" ); // was 0 (see above), but now applies to the sum
+    oi->set_u32( "conv_has_relu", has_relu );
+    oi->set_u32( "conv_has_res", 1 );
+    create_planned_alias_var( eo_id, get_node_dims( eo_id ), res_id, 0 );
+    fuse_clobbered.insert( res_id );
+    oi->reset_arg( "out", eo_id );
+    return 1;
+  }
+
+  nda_float_t const & get_fold_blob( map_str_p_nda_float_t const & op_params, string const & op_tag, 
+                                     uint32_t const & bix, uint32_t const & sz ) {
+    p_nda_float_t const & blob = must_find( op_params, op_tag + "_" + str(bix) );
+    if( blob->elems_sz() != sz ) { 
+      rt_err( strprintf( "can't fold op '%s' into conv: blob %s has %s elements, expected %s.", str(op_tag).c_str(), 
+                         str(bix).c_str(), str(blob->elems_sz()).c_str(), str(sz).c_str() ) ); 
+    }
+    return *blob;
+  }
 
-	if( oi->get_func_name() == k1conv_str ) { 
-	  if( ( no->in_place_ops.size() == conv_has_relu ) && ( no->bot_for.size() == 1) ) { // if output feeds single non-in-place operation
-	    p_conv_op_t const & noi = must_find( *op_infos, no->bot_for[0] ); // next operation
-	    if( enable_write_xpose && noi->is( Convolution_coi ) && (noi->get_func_name() == k1conv_str) ) { 
-	      // modify output argument dims to match user's input dims. codegen will notice this and write out correctly.
-	      oi->reset_arg_dims( "out", noi->get_dims( "in" ) );
-	    }
+  // returns op_params, but with the filts/biases of the convs in conv_folded_ops replaced by ones with the folded ops
+  // applied. each folded op is a per-chan affine xform out = a*in + c, so folding it scales the filts (per out_chan)
+  // and biases by a, and then adds c to the biases.
+  p_map_str_p_nda_float_t conv_pipe_fwd_t::get_folded_op_params( void ) {
+    if( conv_folded_ops.empty() ) { return cp->op_params; }
+    p_map_str_p_nda_float_t ret = make_shared< map_str_p_nda_float_t >( *cp->op_params ); // note: shallow copy
+    for( map_str_vect_string::const_iterator i = conv_folded_ops.begin(); i != conv_folded_ops.end(); ++i ) {
+      p_conv_op_t const & cop = cp->get_op( i->first ); // note: not annotated, so filts/biases are the original vars
+      string const filts_vn = cop->get_arg("filts");
+      string const biases_vn = cop->get_arg("biases");
+      nda_float_t const & filts = *must_find( *ret, filts_vn );
+      nda_float_t const & biases = *must_find( *ret, biases_vn );
+      uint32_t const num_oc = biases.elems_sz();
+      vect_float a( num_oc, 1.0f );
+      vect_float c( num_oc, 0.0f );
+      for( vect_string::const_iterator j = i->second.begin(); j != i->second.end(); ++j ) {
+	p_conv_op_t const & fop = cp->get_op( *j );
+	vect_float fa( num_oc, 1.0f );
+	vect_float fc( num_oc, 0.0f );
+	if( fop->is( BatchNorm_coi ) ) { // blobs are: mean, variance, and a scale factor for both
+	  float const * const mean = get_fold_blob( *ret, fop->tag, 0, num_oc ).elems_ptr();
+	  float const * const var = get_fold_blob( *ret, fop->tag, 1, num_oc ).elems_ptr();
+	  float const sf = get_fold_blob( *ret, fop->tag, 2, 1 ).elems_ptr()[0];
+	  float const inv_sf = (sf == 0.0f) ? 0.0f : (1.0f / sf); // as per caffe
+	  float const eps = SNE<float>( *fop->get( "eps" ) );
+	  for( uint32_t k = 0; k != num_oc; ++k ) { 
+	    fa[k] = 1.0f / sqrt( var[k]*inv_sf + eps );
+	    fc[k] = -mean[k]*inv_sf*fa[k];
+	  }
+	} else { 
+	  assert_st( fop->is( Scale_coi ) ); // blobs are: scale, [bias]
+	  float const * const scale = get_fold_blob( *ret, fop->tag, 0, num_oc ).elems_ptr();
+	  for( uint32_t k = 0; k != num_oc; ++k ) { fa[k] = scale[k]; }
+	  if( fop->get_u32( "bias_term" ) ) {
+	    float const * const bias = get_fold_blob( *ret, fop->tag, 1, num_oc ).elems_ptr();
+	    for( uint32_t k = 0; k != num_oc; ++k ) { fc[k] = bias[k]; }
 	  }
 	}
-
+	for( uint32_t k = 0; k != num_oc; ++k ) { a[k] *= fa[k]; c[k] = fa[k]*c[k] + fc[k]; }
       }
+      p_nda_float_t ffilts = make_shared< nda_float_t >( filts.dims );
+      uint32_t const oc_stride = filts.dims.dstride( "out_chan" );
+      assert_st( filts.dims.dsz( "out_chan" ) == num_oc );
+      for( uint32_t k = 0; k != filts.elems_sz(); ++k ) { ffilts->elems_ptr()[k] = a[(k/oc_stride)%num_oc] * filts.elems_ptr()[k]; }
+      p_nda_float_t fbiases = make_shared< nda_float_t >( biases.dims );
+      for( uint32_t k = 0; k != num_oc; ++k ) { fbiases->elems_ptr()[k] = a[k]*biases.elems_ptr()[k] + c[k]; }
+      (*ret)[filts_vn] = ffilts;
+      (*ret)[biases_vn] = fbiases;
+    }
+    return ret;
+  }
+
+  p_rtc_compute_t make_p_rtc_compute_t_init_and_check_unused_from_lexp( p_lexp_t const & lexp, nesi_init_arg_t * const nia );
+
+  // note: only the dims-only (i.e. arg) ndas are changed; they are replaced, since they may be shared with cp's ops
+  void conv_pipe_fwd_t::set_op_storage_tn( p_conv_op_t const & oi ) {
+    for( map_str_p_nda_t::const_iterator i = oi->nda_vals.begin(); i != oi->nda_vals.end(); ++i ) {
+      if( i->second->rp_elems() || (i->second->dims.tn != "float") ) { continue; }
+      dims_t dims = i->second->dims;
+      set_storage_tn( dims );
+      oi->nda_vals[i->first] = make_dims_nda( dims ); // note: doesn't invalidate i
+    }
+  }
+
+  void conv_pipe_fwd_t::init( p_conv_pipe_t const & cp_, nesi_init_arg_t * const nia ) {
+    cp = cp_;
+    assert_st( cp );
+    if( (storage_tn != "float") && (storage_tn != "half") ) { rt_err( "storage_tn must be float or half, but was: " + storage_tn ); }
+    if( storage_tn != "float" ) {
+      if( cp->has_bck_ops.v ) { rt_err( "storage_tn="+storage_tn+" is unsupported for pipes with bck ops" ); }
+      if( enable_stats || (!quantize.empty()) ) { rt_err( "storage_tn="+storage_tn+" is unsupported with enable_stats or quantize" ); }
+      if( op_tune.i8conv || (!i8conv_layers.empty()) ) { rt_err( "storage_tn="+storage_tn+" is unsupported with i8conv" ); }
     }
     if( !rtc ) { 
       string rtc_be;
@@ -513,25 +1158,102 @@ namespace boda
       if( 0 ) { }
       else if( is_feature_enabled("nvrtc") ) { rtc_be = "(be=nvrtc)"; }
       else if( is_feature_enabled("opencl") ) { rtc_be = "(be=ocl)"; }
+      else if( is_feature_enabled("cpu_rtc") ) { rtc_be = "(be=cpu)"; }
       else { rt_err("rtc-fwd: can't find enabled choice for default backend. specify, or update defaults list ..."); }
       rtc = make_p_rtc_compute_t_init_and_check_unused_from_lexp( parse_lexp( rtc_be ), nia ); 
     }
     rtc->init(); codegen.init( rtc, make_cnn_custom_codegen_t(), compile_opts );
+    if( op_tune_wisdom_fn ) { read_best_op_tunes( *op_tune_wisdom_fn, rtc->get_plat_tag(), per_op_tunes ); }
+    if( i8_calib_fn ) { read_i8_calib( *i8_calib_fn, i8_calib ); }
+    bind_pipe( cp );
+  }
+
+  // generate the calls and vars for pipe cp_, and set its op params. called once by init(), and again by rebind().
+  void conv_pipe_fwd_t::bind_pipe( p_conv_pipe_t const & cp_ ) {
+    cp = cp_;
+    op_infos.reset( new map_str_p_conv_op_t ); // maybe we should have our own copy of cp, but instead we only copy convs
+    for( map_str_p_conv_op_t::iterator i = cp->convs->begin(); i != cp->convs->end(); ++i ) { 
+      must_insert( *op_infos, i->first, make_shared< conv_op_t >( *i->second ) );
+    }
+    set_string const i8conv_tags_set( i8conv_layers.begin(), i8conv_layers.end() );
+    for( map_str_p_conv_op_t::iterator i = cp->convs->begin(); i != cp->convs->end(); ++i ) { 
+      p_conv_op_t const & oi = must_find( *op_infos, i->first );
+      per_op_tune_map_t::const_iterator pot = per_op_tunes.find( *i->second ); // note: keyed by op sig (see write_op_sigs)
+      op_tune_t lt = (pot == per_op_tunes.end()) ? op_tune : pot->second;
+      if( !i8conv_layers.empty() ) { lt.i8conv = oi->is( Convolution_coi ) && has( i8conv_tags_set, oi->tag ); }
+      add_cnn_codegen_annotations( oi.get(), lt, 0 );
+      set_op_storage_tn( oi );
+    }
+
+    fuse_ops();
     cp->topo_visit_setup();
     for( set_string::const_iterator i = cp->bots.begin(); i != cp->bots.end(); ++i ) { gen_ops_rec( *i ); }
     //codegen.write_rtc_func_sigs( rtc_func_sigs_fn );
     if( write_op_sigs ) { write_sigs( all_op_sigs, op_sigs_fn ); }
-    rtc->copy_ndas_to_vars( op_param_names, *cp->op_params ); // copy op_params in (FIXME/note: implicit  on names)
+    plan_mem();
+    p_map_str_p_nda_float_t const folded_op_params = get_folded_op_params();
+    vect_string to_set_names; // resident op params already hold their (folded) values
+    for( vect_string::const_iterator i = op_param_names.begin(); i != op_param_names.end(); ++i ) {
+      if( !has( resident_vns, *i ) ) { to_set_names.push_back( *i ); }
+    }
+    rtc->copy_ndas_to_vars( to_set_names, *folded_op_params ); // copy op_params in (FIXME/note: implicit  on names)
+    set_i8conv_params( *folded_op_params );
     for( set_string::const_iterator i = force_zero_names.begin(); i != force_zero_names.end(); ++i ) { rtc->set_var_to_zero( *i ); }
+    if( use_launch_plan ) { bind_fwd_calls(); }
     rtc->finish_and_sync();
   }
 
+  // re-bind to cp_, a pipe for the same net (and op params) as the current one, but (typically) with different input
+  // dims. all per-pipe state is regenerated as per init(), but: generated funcs are kept by codegen (and are reused for
+  // any ops whose signatures are unchanged), and op param vars whose dims are unchanged are kept resident on the
+  // device with their (folded) values, rather than being re-created and re-uploaded. all other vars are released.
+  void conv_pipe_fwd_t::rebind( p_conv_pipe_t const & cp_ ) {
+    timer_t t("conv_pipe_fwd_t::rebind");
+    assert_st( cp_ );
+    if( !in_flight.empty() ) { rt_err( "rebind(): can't be called while pipelined runs are in flight; call run_fwd_end() first" ); }
+    if( use_launch_plan ) { rtc->release_bound_calls(); }
+    set_string keep_vns;
+    for( vect_string::const_iterator i = op_param_names.begin(); i != op_param_names.end(); ++i ) {
+      map_str_p_conv_node_t::const_iterator ni = cp_->nodes->find( *i );
+      if( ni == cp_->nodes->end() ) { continue; }
+      dims_t dims = ni->second->dims;
+      set_storage_tn( dims );
+      if( dims == rtc->get_var_dims( *i ) ) { keep_vns.insert( *i ); }
+    }
+    for( set_string::const_iterator i = bound_vns.begin(); i != bound_vns.end(); ++i ) {
+      if( !has( keep_vns, *i ) ) { rtc->release_var( *i ); }
+    }
+    bound_vns = keep_vns;
+    resident_vns = keep_vns;
+    fwd_calls.clear(); dropout_cixs.clear(); staging_vns.clear(); stage_parity.v = 0;
+    op_param_names.clear(); conv_folded_ops.clear(); filts_names.clear(); inxp_names.clear(); force_zero_names.clear();
+    i8conv_tags.clear(); i8_in_names.clear(); stats_names.clear();
+    gen_done_nodes.clear(); gen_done_ops.clear(); fuse_clobbered.clear();
+    chan_view_base.clear(); chan_view_off.clear(); chan_view_bases_done.clear();
+    plan_var_dims.clear(); plan_alias_dims.clear(); plan_alias_base.clear(); plan_alias_off.clear(); mem_plan_aliased.clear();
+    bind_pipe( cp_ );
+    resident_vns.clear();
+  }
+
+  // compile the fwd calls into a flat launch plan. note: vars must not be released or re-created after this (plan_mem()
+  // must have already run). dropout seeds are bound as 0 here, and are patched in place by set_det_drop_seed().
+  void conv_pipe_fwd_t::bind_fwd_calls( void ) {
+    timer_t t("conv_pipe_fwd_t::bind_fwd_calls");
+    for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) {
+      rcg_func_call_t rfc = *i->rfc;
+      map_str_rtc_arg_t::iterator dds = rfc.arg_map.find( "det_drop_seed" );
+      if( (dds != rfc.arg_map.end()) && !dds->second.is_valid() ) { dds->second = make_scalar_nda( uint32_t(0) ); }
+      i->bcix = codegen.bind_func( rfc );
+    }
+  }
+
   void conv_pipe_fwd_t::run_fwd( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns ) {
+    if( !in_flight.empty() ) { rt_err( "run_fwd(): can't be called while pipelined runs are in flight; call run_fwd_end() first" ); }
+    check_not_aliased( to_set_vns );
+    check_not_aliased( to_get_vns );
     if( enable_double_run ) {
       // optional: run fwd rfc's one for testing/flushing/cache setup. note: ~*doubles* total run time ...
-      for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) { 
-        codegen.run_func( *i->rfc ); 
-      }
+      for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) { run_fwd_call( *i ); }
     }
     rtc->finish_and_sync();
     if( enable_prof ) { rtc->profile_start(); }
@@ -544,9 +1266,7 @@ namespace boda
     //printf("run_fwd() exec\n");
     {
       timer_t t("conv_pipe_fwd_t::run_fwd");
-      for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) { 
-        i->call_id = codegen.run_func( *i->rfc ); 
-      }
+      for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) { i->call_id = run_fwd_call( *i ); }
       rtc->finish_and_sync();
     }
     //printf("run_fwd() copy out\n");
@@ -571,11 +1291,58 @@ namespace boda
       cp->dump_ops( *out );
     }
     update_stats();
+    if( i8_calib_out_fn ) { write_i8_calib(); }
     rtc->release_per_call_id_data();
     rtc->finish_and_sync();
     //printf("run_fwd() done\n");
   }
   
+  string conv_pipe_fwd_t::get_staging_var( string const & vn, bool const & parity ) {
+    string const svn = vn + "__stage_" + str(uint32_t(parity));
+    if( staging_vns.insert( svn ).second ) { create_bound_var( svn, rtc->get_var_dims( vn ) ); }
+    return svn;
+  }
+
+  // each pipelined run uploads its inputs into (and reads its outputs back from) staging vars of its own parity. inputs
+  // are copied into place (on-device) just before the run's calls, and outputs into staging just after. so, the
+  // upload for run N+1 and the readback for run N-1 use different vars than run N, and can overlap run N's calls.
+  // note: enable_stats, per_call_fn, and enable_double_run are only handled by the non-pipelined run_fwd().
+  void conv_pipe_fwd_t::run_fwd_begin( vect_string const & to_set_vns, p_map_str_p_nda_float_t const & fwd, vect_string const & to_get_vns ) {
+    timer_t t("conv_pipe_fwd_t::run_fwd_begin");
+    if( in_flight.size() >= 2 ) { rt_err( "run_fwd_begin(): too many runs in flight; call run_fwd_end() first" ); }
+    if( storage_tn != "float" ) { rt_err( "run_fwd_begin(): unsupported with storage_tn="+storage_tn+"; use run_fwd()" ); }
+    check_not_aliased( to_set_vns );
+    check_not_aliased( to_get_vns );
+    rtc_fwd_pass_t pass{fwd};
+    bool const parity = stage_parity.v;
+    stage_parity.v = !stage_parity.v;
+    for( vect_string::const_iterator i = to_set_vns.begin(); i != to_set_vns.end(); ++i ) {
+      pass.xfer_ids.push_back( rtc->copy_nda_to_var_async( get_staging_var( *i, parity ), must_find( *fwd, *i ) ) );
+    }
+    for( vect_string::const_iterator i = to_set_vns.begin(); i != to_set_vns.end(); ++i ) {
+      rtc->copy_var_to_var( *i, get_staging_var( *i, parity ) );
+    }
+    for( vect_rtc_fwd_func_call_t::iterator i = fwd_calls.begin(); i != fwd_calls.end(); ++i ) { run_fwd_call( *i ); }
+    for( vect_string::const_iterator i = to_get_vns.begin(); i != to_get_vns.end(); ++i ) {
+      string const svn = get_staging_var( *i, parity );
+      rtc->copy_var_to_var( svn, *i );
+      p_nda_float_t & out = (*fwd)[*i];
+      if( !out ) { out = make_shared< nda_float_t >( rtc->get_var_dims( *i ) ); }
+      pass.xfer_ids.push_back( rtc->copy_var_to_nda_async( out, svn ) );
+    }
+    in_flight.push_back( pass );
+    rtc->release_per_call_id_data(); // call_ids are unused in pipelined mode
+  }
+
+  void conv_pipe_fwd_t::run_fwd_end( void ) {
+    timer_t t("conv_pipe_fwd_t::run_fwd_end");
+    if( in_flight.empty() ) { rt_err( "run_fwd_end(): no runs in flight" ); }
+    rtc_fwd_pass_t const & pass = in_flight.front();
+    // note: waiting for all of a run's xfers, including its uploads, ensures that the caller may reuse its input ndas
+    for( vect_uint32_t::const_iterator i = pass.xfer_ids.begin(); i != pass.xfer_ids.end(); ++i ) { rtc->wait_xfer( *i ); }
+    in_flight.pop_front();
+  }
+  
 #include"gen/rtc_fwd.cc.nesi_gen.cc"
 
 }
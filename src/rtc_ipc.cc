@@ -301,11 +301,43 @@ namespace boda
     uint32_t print_dont_fork; //NESI(default=0,help="if set, don't actually fork to create a fifo-based worker, just print the command to do so.")
     p_string spawn_str; //NESI(help="command to spawn worker process, passed to os.system(). if not set, boda will use fork() to create a local worker. the worker's arguments will be appended.")
     uint32_t spawn_shell_escape_args; //NESI(default=0,help="if set, escape each worker arg suitably for use as a shell argument .")
+    uint32_t shm_arena_sz; //NESI(default=0,help="if non-zero, set up a POSIX shared memory arena of this many bytes at init, and pass var data through it instead of over the stream (a var copy then sends only an offset). requires the worker to run on the same host. copies larger than the arena still use the stream.")
 
     p_map_str_ipc_var_info_t vis;
 
     p_stream_t worker;
 
+    // protocol notes: commands without results (including run(), since we assign call ids here) are only written to
+    // the stream, which buffers them; the stream is only flushed when we need a reply (i.e. for finish_and_sync(),
+    // get_dur(), or a copy-out). so, a sequence of such commands costs no round trips. errors from them are deferred
+    // by the worker until its next reply, which always ends with the first such error (or an empty string).
+    uint32_t next_call_id;
+    void end_reply( void ) { // call after reading the payload of any reply from the worker
+      string deferred_err;
+      bread( *worker, deferred_err );
+      reclaim_shm();
+      if( !deferred_err.empty() ) { unsup_err( "rtc_ipc: " + deferred_err ); }
+    }
+
+    // shm transport. the worker handles commands in order, so once it has replied to any command, it is done with
+    // all data passed in the arena for earlier commands. thus, we allocate arena space linearly for copies, and
+    // reclaim all of it after each reply (or, when it is full, after an explicit sync).
+    p_uint8_t shm_arena;
+    uint64_t shm_arena_used;
+    void reclaim_shm( void ) { shm_arena_used = 0; }
+    void sync_worker( void ) {
+      bwrite( *worker, string("sync") ); worker->flush();
+      end_reply();
+    }
+    // returns the arena offset of sz free bytes, or uint64_t_const_max if there is no arena or sz won't fit in it.
+    uint64_t alloc_shm( uint64_t const & sz ) {
+      if( (!shm_arena) || (sz > shm_arena_sz) ) { return uint64_t_const_max; }
+      if( (shm_arena_used + sz) > shm_arena_sz ) { sync_worker(); }
+      uint64_t const ret = shm_arena_used;
+      shm_arena_used = std::min( uint64_t( shm_arena_sz ), (ret + sz + 63) & ~uint64_t(63) ); // keep copies 64-byte aligned
+      return ret;
+    }
+
     void init( void ) {
       assert_st( !init_done.v );
       vis.reset( new map_str_ipc_var_info_t );
@@ -351,7 +383,13 @@ namespace boda
       worker->wait_for_worker(); // ... then wait for worker.
 
       bwrite( *worker, string("init") );
-      worker->flush();
+      shm_arena_used = 0;
+      next_call_id = 0;
+      if( shm_arena_sz ) { 
+        if( startswith( boda_parent_addr, "tcp:" ) ) { rt_err( "ipc_compute_t: shm_arena_sz is set, but shared memory can't be used with the tcp method" ); }
+        bwrite( *worker, string("setup_shm_arena") ); bwrite( *worker, shm_arena_sz ); 
+        shm_arena = make_and_share_p_uint8_t( *worker, shm_arena_sz ); 
+      }
 
       init_done.v = 1;
     }
@@ -361,6 +399,7 @@ namespace boda
       worker->flush();
       string ret;
       bread( *worker, ret );
+      end_reply();
       return ret;
     }
     
@@ -378,28 +417,48 @@ namespace boda
       uint32_t ret = 0;
       string err_str;
       bread( *worker, ret ); // 0 --> no error
-      if( ret ) { 
-        bread( *worker, err_str );
-        unsup_err( "rtc_ipc: " + err_str );
-      }
+      if( ret ) { bread( *worker, err_str ); }
+      end_reply();
+      if( ret ) { unsup_err( "rtc_ipc: " + err_str ); }
     }
     void copy_nda_to_var( string const & vn, p_nda_t const & nda ) {
       dims_t const & dims = get_var_dims( vn );
       assert_st( dims == nda->dims );
-      bwrite( *worker, string("copy_nda_to_var") ); 
-      bwrite( *worker, vn );
-      bwrite( *worker, dims );
-      bwrite_bytes( *worker, (char const *)nda->rp_elems(), dims.bytes_sz() ); 
-      worker->flush();
+      uint64_t const shm_off = alloc_shm( dims.bytes_sz() );
+      if( shm_off != uint64_t_const_max ) {
+        memcpy( shm_arena.get() + shm_off, nda->rp_elems(), dims.bytes_sz() );
+        bwrite( *worker, string("copy_nda_to_var_shm") ); 
+        bwrite( *worker, vn );
+        bwrite( *worker, dims );
+        bwrite( *worker, shm_off );
+      } else {
+        bwrite( *worker, string("copy_nda_to_var") ); 
+        bwrite( *worker, vn );
+        bwrite( *worker, dims );
+        bwrite_bytes( *worker, (char const *)nda->rp_elems(), dims.bytes_sz() ); 
+      }
     }
     void copy_var_to_nda( p_nda_t const & nda, string const & vn ) {
       dims_t const & dims = get_var_dims( vn );
       assert_st( dims == nda->dims );
+      uint64_t const shm_off = alloc_shm( dims.bytes_sz() );
+      if( shm_off != uint64_t_const_max ) {
+        bwrite( *worker, string("copy_var_to_nda_shm") ); 
+        bwrite( *worker, vn );
+        bwrite( *worker, dims );
+        bwrite( *worker, shm_off );
+        worker->flush();
+        uint8_t done; bread( *worker, done );
+        memcpy( nda->rp_elems(), shm_arena.get() + shm_off, dims.bytes_sz() );
+        end_reply();
+        return;
+      }
       bwrite( *worker, string("copy_var_to_nda") ); 
       bwrite( *worker, vn );
       bwrite( *worker, dims );
       worker->flush();
       bread_bytes( *worker, (char *)nda->rp_elems(), dims.bytes_sz() ); 
+      end_reply();
     }
     p_nda_t get_var_raw_native_pointer( string const & vn ) {
       rt_err( "get_var_raw_native_pointer()-over-ipc: not implemented (and not needed/sensible?)");
@@ -407,50 +466,45 @@ namespace boda
     void create_var_with_dims( string const & vn, dims_t const & dims ) { 
       must_insert( *vis, vn, ipc_var_info_t{dims} ); 
       bwrite( *worker, string("create_var_with_dims") ); bwrite( *worker, vn ); bwrite( *worker, dims ); 
-      worker->flush();
     }
     void create_var_with_dims_as_reshaped_view_of_var( string const & vn, dims_t const & dims, string const & src_vn ) {
       must_insert( *vis, vn, ipc_var_info_t{dims} ); 
       bwrite( *worker, string("create_var_with_dims_as_reshaped_view_of_var") ); 
       bwrite( *worker, vn ); bwrite( *worker, dims ); bwrite( *worker, src_vn ); 
-      worker->flush();
+    }
+    void create_var_with_dims_as_sub_view_of_var( string const & vn, dims_t const & dims, string const & src_vn, uint64_t const & byte_off ) {
+      must_insert( *vis, vn, ipc_var_info_t{dims} ); 
+      bwrite( *worker, string("create_var_with_dims_as_sub_view_of_var") ); 
+      bwrite( *worker, vn ); bwrite( *worker, dims ); bwrite( *worker, src_vn ); bwrite( *worker, byte_off ); 
     }
 
     void release_var( string const & vn ) {
       must_erase( *vis, vn ); 
       bwrite( *worker, string("release_var") ); bwrite( *worker, vn );
-      worker->flush();
     }
     dims_t get_var_dims( string const & vn ) { return must_find( *vis, vn ).dims; }
-    void set_var_to_zero( string const & vn ) { bwrite( *worker, string("set_var_to_zero") ); bwrite( *worker, vn ); worker->flush(); }
+    void set_var_to_zero( string const & vn ) { bwrite( *worker, string("set_var_to_zero") ); bwrite( *worker, vn ); }
     
     virtual float get_dur( uint32_t const & b, uint32_t const & e ) { 
       float ret;
       bwrite( *worker, string("get_dur") ); bwrite( *worker, b ); bwrite( *worker, e ); worker->flush(); bread( *worker, ret );
+      end_reply();
       return ret; 
     } 
     virtual float get_var_compute_dur( string const & vn ) { assert_st(0); } // not-yet-used-iface at higher level
     virtual float get_var_ready_delta( string const & vn1, string const & vn2 ) { assert_st(0); } // not-yet-used-iface at higher level
     void release_func( string const & func_name ) {
-      bwrite( *worker, string("release_func") ); bwrite( *worker, func_name ); worker->flush(); }
+      bwrite( *worker, string("release_func") ); bwrite( *worker, func_name ); }
     uint32_t run( rtc_func_call_t const & rfc ) { 
-      bwrite( *worker, string("run") ); bwrite( *worker, rfc ); worker->flush(); 
-      uint32_t ret = 0;
-      string err_str;
-      bread( *worker, ret ); // 0 --> no error
-      if( ret ) { 
-        bread( *worker, err_str );
-        unsup_err( "rtc_ipc: " + err_str );
-      }
-      uint32_t call_id; 
-      bread( *worker, call_id ); 
+      uint32_t const call_id = next_call_id++; // note: worker maps this to the backend's call id
+      bwrite( *worker, string("run") ); bwrite( *worker, rfc ); bwrite( *worker, call_id ); 
       return call_id; 
     } 
-    void finish_and_sync( void ) { bwrite( *worker, string("finish_and_sync") ); worker->flush(); }
-    void release_per_call_id_data( void ) { bwrite( *worker, string("release_per_call_id_data") ); worker->flush(); }
-    void release_all_funcs( void ) { bwrite( *worker, string("release_all_funcs") ); worker->flush(); }
+    void finish_and_sync( void ) { bwrite( *worker, string("finish_and_sync") ); worker->flush(); end_reply(); }
+    void release_per_call_id_data( void ) { bwrite( *worker, string("release_per_call_id_data") ); next_call_id = 0; }
+    void release_all_funcs( void ) { bwrite( *worker, string("release_all_funcs") ); }
 
-    void profile_start( void ) { bwrite( *worker, string("profile_start") ); worker->flush(); }
+    void profile_start( void ) { bwrite( *worker, string("profile_start") ); }
     void profile_stop( void ) { bwrite( *worker, string("profile_stop") ); worker->flush(); }
   };
 
@@ -553,11 +607,24 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
     p_img_t in_img;
     p_img_t out_img;
 
+    p_uint8_t shm_arena; // see ipc_compute_t::shm_arena_sz
+    uint32_t shm_arena_sz;
+    p_nda_t get_shm_nda( dims_t const & dims, uint64_t const & off ) { // note: refers to (doesn't copy) arena data
+      if( !shm_arena ) { rt_err( "ipc_compute_worker: shm copy requested, but no shm arena was set up" ); }
+      if( (off + dims.bytes_sz()) > shm_arena_sz ) { rt_err( "ipc_compute_worker: shm copy out of arena bounds" ); }
+      return make_shared<nda_t>( dims, shm_arena.get() + off );
+    }
+
+    // see ipc_compute_t protocol notes. call ids are assigned by the parent; we map them to our backend's ids.
+    map< uint32_t, uint32_t > call_ids;
+    string deferred_err; // first error from a command without a reply, if any
+    void end_reply( void ) { bwrite( *parent, deferred_err ); deferred_err.clear(); parent->flush(); }
+
     uint8_t proc_done;
     
     p_stream_t parent;
 
-    ipc_compute_worker_t( void ) : proc_done(1) { }
+    ipc_compute_worker_t( void ) : shm_arena_sz(0), proc_done(1) { }
 
     virtual void main( nesi_init_arg_t * nia ) { 
       global_timer_log_set_disable_finalize( 1 );
@@ -571,9 +638,11 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
 	if( 0 ) {} 
 	else if( cmd == "quit" ) { break; }
 	else if( cmd == "init" ) { rtc->init(); }
+	else if( cmd == "setup_shm_arena" ) { bread( *parent, shm_arena_sz ); shm_arena = recv_shared_p_uint8_t( *parent ); }
+	else if( cmd == "sync" ) { end_reply(); }
 	else if( cmd == "get_plat_tag" ) { 
           string const ret = rtc->get_plat_tag();
-	  bwrite( *parent, ret ); parent->flush(); 
+	  bwrite( *parent, ret ); end_reply(); 
         }
 	else if( cmd == "compile" ) {
 	  vect_rtc_func_info_t func_infos; rtc_compile_opts_t opts;
@@ -586,7 +655,7 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
           catch( unsup_exception const & rte ) { ret=1; err_str = rte.what(); } // FIXME: stacktrace lost 
           bwrite( *parent, ret ); // 0 --> no error
           if( ret ) { bwrite( *parent, err_str ); }
-	  parent->flush();
+	  end_reply();
 	}
 	else if( cmd == "copy_nda_to_var" ) {
 	  string vn;
@@ -607,7 +676,25 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
           assert_st( dims == vi.buf->dims );
 	  rtc->copy_var_to_nda( vi.buf, vn );
 	  bwrite_bytes( *parent, (char const *)vi.buf->rp_elems(), vi.buf->dims.bytes_sz() );
-	  parent->flush();
+	  end_reply();
+	}
+	else if( cmd == "copy_nda_to_var_shm" ) {
+	  string vn; dims_t dims; uint64_t off;
+	  bread( *parent, vn );
+	  bread( *parent, dims );
+	  bread( *parent, off );
+          assert_st( dims == must_find( *vis, vn ).dims );
+	  rtc->copy_nda_to_var( vn, get_shm_nda( dims, off ) );
+	}
+	else if( cmd == "copy_var_to_nda_shm" ) {
+	  string vn; dims_t dims; uint64_t off;
+	  bread( *parent, vn );
+	  bread( *parent, dims );
+	  bread( *parent, off );
+          assert_st( dims == must_find( *vis, vn ).dims );
+	  rtc->copy_var_to_nda( get_shm_nda( dims, off ), vn );
+          uint8_t const done = 1; 
+	  bwrite( *parent, done ); end_reply();
 	}
 	else if( cmd == "create_var_with_dims" ) {
 	  string vn; dims_t dims;
@@ -624,6 +711,15 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
 	  must_insert( *vis, vn, ipc_var_info_t{dims} );
 	  rtc->create_var_with_dims_as_reshaped_view_of_var( vn, dims, src_vn );
 	}
+	else if( cmd == "create_var_with_dims_as_sub_view_of_var" ) {
+	  string vn; dims_t dims; string src_vn; uint64_t byte_off;
+	  bread( *parent, vn ); 
+	  bread( *parent, dims );
+	  bread( *parent, src_vn );
+	  bread( *parent, byte_off );
+	  must_insert( *vis, vn, ipc_var_info_t{dims} );
+	  rtc->create_var_with_dims_as_sub_view_of_var( vn, dims, src_vn, byte_off );
+	}
 	else if( cmd == "release_var" ) {
 	  string vn;
 	  bread( *parent, vn ); 
@@ -637,29 +733,24 @@ moskewcz@maaya:~/git_work/boda/run/tr4$ boda cs_test_worker --boda-parent-addr=f
 	}
 	else if( cmd == "get_dur" ) { 
 	  uint32_t b,e; bread( *parent, b ); bread( *parent, e ); 
-	  float const ret = rtc->get_dur( b, e ); 
-	  bwrite( *parent, ret ); parent->flush(); 
+	  map< uint32_t, uint32_t >::const_iterator bi = call_ids.find( b ), ei = call_ids.find( e );
+	  // note: if either call failed (and so has no id), its error will be returned now via end_reply()
+	  float const ret = ( (bi == call_ids.end()) || (ei == call_ids.end()) ) ? NAN : rtc->get_dur( bi->second, ei->second );
+	  bwrite( *parent, ret ); end_reply(); 
 	}
 	else if( cmd == "release_func" ) { string func_name; bread( *parent, func_name ); rtc->release_func( func_name ); }
 	else if( cmd == "run" ) { 
           rtc_func_call_t rfc; bread( *parent, rfc ); 
-          uint32_t call_id;
-          uint32_t ret = 0;
-          string err_str;
-          try { call_id = rtc->run( rfc ); }
-          catch( unsup_exception const & rte ) { ret=1; err_str = rte.what(); } // FIXME: stacktrace lost 
-          bwrite( *parent, ret ); 
-          if( !ret ) {
-            bwrite( *parent, call_id ); 
-          } else {
-            bwrite( *parent, err_str ); 
-          }
-          parent->flush(); 
+          uint32_t call_id; bread( *parent, call_id ); 
+          try { must_insert( call_ids, call_id, rtc->run( rfc ) ); }
+          catch( unsup_exception const & rte ) { // FIXME: stacktrace lost 
+            if( deferred_err.empty() ) { deferred_err = rte.what(); } 
+          } 
         }
-	else if( cmd == "finish_and_sync" ) { rtc->finish_and_sync(); }
+	else if( cmd == "finish_and_sync" ) { rtc->finish_and_sync(); end_reply(); }
 	else if( cmd == "profile_start" ) { rtc->profile_start(); }
 	else if( cmd == "profile_stop" ) { rtc->profile_stop(); }
-	else if( cmd == "release_per_call_id_data" ) { rtc->release_per_call_id_data(); }
+	else if( cmd == "release_per_call_id_data" ) { rtc->release_per_call_id_data(); call_ids.clear(); }
 	else if( cmd == "release_all_funcs" ) { rtc->release_all_funcs(); }
 	else { rt_err("bad command:"+cmd); }
       }
@@ -14,6 +14,8 @@
 #include"comp_util.H"
 #include<iostream>
 #include<sstream>
+#include<thread>
+#include<atomic>
 
 namespace boda 
 {
@@ -49,6 +51,7 @@ namespace boda
     timer_t t("profile_rcg_call");
     string const anno_op_func_name = anno_op->get_func_name();
     p_rcg_func_call_t rfc = codegen.gen_func( *anno_op, map_str_rtc_arg_t() ); // FIXME: not passing in args here. yet?
+    codegen.compile(); // compile op under test alone (see rtc_codegen_t::compile() and ops_autotune_t)
     p_rtc_call_gen_t const & rcg = rfc->rcg;
     map_str_rtc_arg_t & arg_map = rfc->arg_map;
     for( vect_arg_decl_t::multi_iter i = rcg->rtc_func_template->arg_decls.multi_begin( &rcg->op ); !i.at_end(); ++i ) {
@@ -183,24 +186,9 @@ namespace boda
 
   p_rtc_compute_t make_p_rtc_compute_t_init_and_check_unused_from_lexp( p_lexp_t const & lexp, nesi_init_arg_t * const nia );
 
-  void on_op_err( std::ostream & out, bool & op_seen_errs, uint32_t const & op_ix, p_op_base_t const & op ) {
-    // if first err for this op, print out op
-    if( !op_seen_errs ) { 
-      out << "-----\n errors for op_ix=" << str(op_ix) << " op='" << str( op ) << "'\n"; 
-      op_seen_errs = 1; 
-    } 
-  }
-
-  void ops_prof_t::main( nesi_init_arg_t * nia ) {
-    p_ostream out = out_fn ? ofs_open( *out_fn ) : p_ostream( &std::cout, null_deleter<std::ostream>() );
-    p_ostream wout = wisdom_out_fn ? ofs_open( *wisdom_out_fn ) : p_ostream();
-    p_istream win;
-    if( wisdom_in_fn ) {
-      // if non-existant, don't load, but do complain
-      if( boost::filesystem::is_regular_file( wisdom_in_fn->exp ) ) { win = ifs_open( *wisdom_in_fn ); } 
-      else { (*out) << "warning: specified input wisdom file could not be loaded; ignoring. known-good testing disabled.\n"; } // 
-    }
-
+  // create (if needed), init, and add codegens to the backends used by ops-prof and ops-autotune
+  void init_ops_bes( map_str_ops_be_t & ops_bes, vect_p_rtc_compute_t const & rtcs, vect_string const & rtcns, 
+                     rtc_compile_opts_t const & compile_opts, nesi_init_arg_t * const nia ) {
     // by default, add all enabled/availible backends
     if( rtcs.size() != rtcns.size() ) { rt_err( strprintf( "must specific the same # of rtcs and rtcns, but rtcs.size()=%s and rtcns.size()=%s\n", str(rtcs.size()).c_str(), str(rtcns.size()).c_str() ) ); }
     if( rtcs.empty() ) {
@@ -212,18 +200,43 @@ namespace boda
         ops_be_t ops_be{ "ocl", make_p_rtc_compute_t_init_and_check_unused_from_lexp( parse_lexp( "(be=ocl)" ), nia ) };
         must_insert( ops_bes, ops_be.rtcn, ops_be );
       }
+      if( ops_bes.empty() && is_feature_enabled("cpu_rtc") ) { // only use host CPU backend if no GPU backend is availible
+        ops_be_t ops_be{ "cpu", make_p_rtc_compute_t_init_and_check_unused_from_lexp( parse_lexp( "(be=cpu)" ), nia ) };
+        must_insert( ops_bes, ops_be.rtcn, ops_be );
+      }
     } else { // otherwise, use exactly/only the specified backends
       for( uint32_t i = 0; i != rtcs.size(); ++i ) { must_insert( ops_bes, rtcns[i], ops_be_t{rtcns[i],rtcs[i]} ); }
     }
     // init backends
-    bool const enable_prof = 0;
     for( map_str_ops_be_t::iterator i = ops_bes.begin(); i != ops_bes.end(); ++i ) {
       ops_be_t & ops_be = i->second;
       ops_be.rtc->init();
       ops_be.codegen = make_shared<rtc_codegen_t>();
       ops_be.codegen->init( ops_be.rtc, make_cnn_custom_codegen_t(), compile_opts );
-      if( enable_prof ) { ops_be.rtc->profile_start(); }
     }
+  }
+
+  void on_op_err( std::ostream & out, bool & op_seen_errs, uint32_t const & op_ix, p_op_base_t const & op ) {
+    // if first err for this op, print out op
+    if( !op_seen_errs ) { 
+      out << "-----\n errors for op_ix=" << str(op_ix) << " op='" << str( op ) << "'\n"; 
+      op_seen_errs = 1; 
+    } 
+  }
+
+  void ops_prof_t::main( nesi_init_arg_t * nia ) {
+    p_ostream out = out_fn ? ofs_open( *out_fn ) : p_ostream( &std::cout, null_deleter<std::ostream>() );
+    p_ostream wout = wisdom_out_fn ? ofs_open( *wisdom_out_fn ) : p_ostream();
+    p_istream win;
+    if( wisdom_in_fn ) {
+      // if non-existant, don't load, but do complain
+      if( boost::filesystem::is_regular_file( wisdom_in_fn->exp ) ) { win = ifs_open( *wisdom_in_fn ); } 
+      else { (*out) << "warning: specified input wisdom file could not be loaded; ignoring. known-good testing disabled.\n"; } // 
+    }
+
+    init_ops_bes( ops_bes, rtcs, rtcns, compile_opts, nia );
+    bool const enable_prof = 0;
+    if( enable_prof ) { for( map_str_ops_be_t::iterator i = ops_bes.begin(); i != ops_bes.end(); ++i ) { i->second.rtc->profile_start(); } }
 
     uint32_t num_mad_fail = 0;
     p_istream ops = ifs_open( ops_fn );
@@ -370,6 +383,253 @@ namespace boda
 
   }
 
+  struct op_tune_space_t : virtual public nesi // NESI(help="search space of ops-autotune: the cartesian product of the listed op_tune_t field values, each applied on top of a base op_tune. an empty list uses the value from the base op_tune.")
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    vect_u32_pt_t MNt; //NESI(default="(_=4:4,_=8:8)",help="candidate MNt values")
+    vect_u32_pt_t MNb; //NESI(default="(_=8:8,_=8:16,_=16:16)",help="candidate MNb values")
+    vect_uint32_t Kb; //NESI(default="(_=4,_=8)",help="candidate Kb values")
+    vect_uint32_t vw; //NESI(default="()",help="candidate vw values")
+    vect_uint32_t use_local_mem; //NESI(default="()",help="candidate use_local_mem values")
+    vect_uint32_t k1conv; //NESI(default="(_=0,_=1)",help="candidate k1conv values")
+    vect_uint32_t tconv; //NESI(default="(_=0,_=1)",help="candidate tconv values")
+    vect_uint32_t wconv; //NESI(default="(_=0,_=1)",help="candidate wconv values")
+
+    template< typename T > static vector< T > or_base( vector< T > const & vs, T const & b ) { return vs.empty() ? vector< T >{b} : vs; }
+    void get_op_tunes( op_tune_t const & base, vect_p_op_tune_t & out ) const {
+      out.push_back( make_shared< op_tune_t >( base ) ); // reference tune is always first
+      for( u32_pt_t const & MNt_ : or_base( MNt, base.MNt ) ) { for( u32_pt_t const & MNb_ : or_base( MNb, base.MNb ) ) {
+      for( uint32_t const & Kb_ : or_base( Kb, base.Kb ) ) { for( uint32_t const & vw_ : or_base( vw, base.vw ) ) {
+      for( uint32_t const & ulm_ : or_base( use_local_mem, base.use_local_mem ) ) { 
+      for( uint32_t const & k1conv_ : or_base( k1conv, base.k1conv ) ) { for( uint32_t const & tconv_ : or_base( tconv, base.tconv ) ) {
+      for( uint32_t const & wconv_ : or_base( wconv, base.wconv ) ) {
+        p_op_tune_t ot = make_shared< op_tune_t >( base );
+        ot->MNt = MNt_; ot->MNb = MNb_; ot->Kb = Kb_; ot->vw = vw_; ot->use_local_mem = ulm_;
+        ot->k1conv = k1conv_; ot->tconv = tconv_; ot->wconv = wconv_;
+        out.push_back( ot );
+      } } } } } } } }
+    }
+  };
+
+  // a candidate tuning of one op. note that candidates are unique by annotated op, since it alone determines the
+  // generated code: op_tune is just the first point in the search space that produced anno_op.
+  struct tune_cand_t {
+    p_conv_op_base_t anno_op;
+    p_op_tune_wisdom_t otw; // op_tune and (per-backend) runs
+    string compile_err; // set by precompile() on failure for the backend currently being tuned
+  };
+  typedef vector< tune_cand_t > vect_tune_cand_t; 
+
+  struct tune_op_t {
+    p_op_base_t op;
+    vect_tune_cand_t cands; // first is the reference
+  };
+  typedef vector< tune_op_t > vect_tune_op_t; 
+
+  struct ops_autotune_t : virtual public nesi, public has_main_t // NESI(help="autotune set of operations: for each op and backend, search a space of op_tune_t values, time each (checked-correct) candidate, and write the fastest as wisdom. conv_pipe_fwd_t can use the result via its op_tune_wisdom_fn option.",
+			 // bases=["has_main_t"], type_id="ops-autotune" )
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    p_filename_t out_fn; //NESI(help="output file (output goes to stdout if not specified)")
+    filename_t wisdom_out_fn; //NESI(default="%(boda_output_dir)/autotune.wis",help="wisdom output file")
+    uint32_t write_all_runs; //NESI(default="0",help="if non-zero, write runs of all candidates into output wisdom. if zero, write only the fastest candidate per op per backend.")
+    p_filename_t wisdom_check_fn; //NESI(help="if specified, read back the output wisdom and write a timing-independent summary of it to this file: for each op and backend, the number of runs and of error-free runs (used for testing)")
+
+    vect_p_rtc_compute_t rtcs; //NESI(help="list of compute backends to use")
+    vect_string rtcns; //NESI(help="list of names of compute backends (must have same # of elements as --rtcs option")
+    rtc_compile_opts_t compile_opts; // NESI(default="()",help="runtime compilation options")
+    filename_t ops_fn; //NESI(default="op_sigs_full.txt",help="file to read ops from (i.e. as written by an rtc mode run with write_op_sigs=1)")
+
+    op_tune_t op_tune; //NESI(default="()",help="values of all op_tune_t fields that are not searched. also the reference tune that all other candidates are checked against.")
+    op_tune_space_t tune_space; //NESI(default="()",help="op_tune_t search space")
+    uint32_t num_workers; //NESI(default="0",help="number of parallel compile workers (if 0, use the number of hardware threads)")
+    uint32_t timed_runs; //NESI(default="3",help="time each candidate (at most) this many times, and use the fastest run")
+    filename_t prog_cache_dir; //NESI(default="%(boda_output_dir)/autotune-prog-cache",help="precompiled candidates are passed to the timing pass via the program cache. for backends that don't have enable_prog_cache=1, it is enabled using this directory, which is removed when tuning is done.")
+    double early_term_factor; //NESI(default="1.5",help="stop re-timing a candidate if its first run is more than this many times slower than the fastest candidate so far")
+
+    p_op_base_t gen_data; //NESI(help="test-pattern data generation parameters (if not provided, inputs will be zeros)")
+    double mrd_toler; //NESI(default="2e-3",help="maximum maximum-absolute-difference vs. the reference tune over which a candidate is rejected")
+    uint32_t max_err; //NESI(default="10",help="print at most this many differing elems")
+
+    map_str_ops_be_t ops_bes;
+    vect_tune_op_t tune_ops;
+
+    p_ostream out;
+
+    void precompile( ops_be_t const & ops_be, nesi_init_arg_t * const nia );
+    void time_cands( ops_be_t const & ops_be, tune_op_t & to );
+    void check_wisdom( void );
+    virtual void main( nesi_init_arg_t * nia );
+  };
+
+  // compile all candidates in parallel, each worker using its own instance of the backend. the compiled programs are
+  // passed back only via the on-disk program cache, where the serial timing pass will find them.
+  void ops_autotune_t::precompile( ops_be_t const & ops_be, nesi_init_arg_t * const nia ) {
+    timer_t t("ops_autotune_precompile");
+    vector< tune_cand_t * > cands;
+    for( vect_tune_op_t::iterator i = tune_ops.begin(); i != tune_ops.end(); ++i ) {
+      for( vect_tune_cand_t::iterator j = i->cands.begin(); j != i->cands.end(); ++j ) { j->compile_err.clear(); cands.push_back( &*j ); }
+    }
+    assert_st( ops_be.rtc->enable_prog_cache ); // see main()
+    uint32_t const nw = std::min( size_t( num_workers ? num_workers : std::max( 1U, std::thread::hardware_concurrency() ) ),
+                                  cands.size() );
+    vect_p_rtc_compute_t wrtcs; // note: NESI init isn't thread safe, so create worker backends here.
+    for( uint32_t w = 0; w != nw; ++w ) {
+      wrtcs.push_back( make_p_rtc_compute_t_init_and_check_unused_from_lexp( parse_lexp( str(ops_be.rtc) ), nia ) );
+      wrtcs.back()->enable_prog_cache = 1;
+      wrtcs.back()->prog_cache_dir = ops_be.rtc->prog_cache_dir;
+    }
+    std::atomic< uint32_t > next_cix( 0 );
+    vector< std::thread > workers;
+    for( uint32_t w = 0; w != nw; ++w ) {
+      workers.emplace_back( [&,w]() {
+          rtc_codegen_t codegen;
+          try { wrtcs[w]->init(); codegen.init( wrtcs[w], make_cnn_custom_codegen_t(), compile_opts ); }
+          catch( rt_exception const & rte ) { return; } // unusable worker; others will take its share of candidates
+          for( uint32_t cix; (cix = next_cix++) < cands.size(); ) {
+            try { p_rcg_func_call_t rfc = codegen.gen_func( *cands[cix]->anno_op, map_str_rtc_arg_t() ); codegen.compile(); }
+            catch( rt_exception const & rte ) { cands[cix]->compile_err = rte.err_msg; }
+            codegen.clear();
+          }
+        } );
+    }
+    for( vector< std::thread >::iterator i = workers.begin(); i != workers.end(); ++i ) { i->join(); }
+  }
+
+  // time candidates for one op (serially, on the backend's main instance) and record their runs
+  void ops_autotune_t::time_cands( ops_be_t const & ops_be, tune_op_t & to ) {
+    rtc_codegen_t & codegen = *ops_be.codegen;
+    string const plat_tag = codegen.rtc->get_plat_tag();
+    p_map_str_p_nda_t vs_ref;
+    double best_rt_secs = std::numeric_limits<double>::max();
+    for( vect_tune_cand_t::iterator i = to.cands.begin(); i != to.cands.end(); ++i ) {
+      std::ostringstream err;
+      prc_ret_t prc_ret{0,NAN};
+      p_map_str_p_nda_t vsi = make_shared<map_str_p_nda_t>();
+      if( !i->compile_err.empty() ) { err << "compile failure: " << i->compile_err; }
+      else if( (i != to.cands.begin()) && !vs_ref ) { err << "reference tune failed; can't check results"; }
+      else {
+        try { 
+          prc_ret = profile_rcg_call( i->anno_op, codegen, gen_data, vsi.get(), 1, 0 ); 
+          for( uint32_t r = 1; r < timed_runs; ++r ) {
+            if( prc_ret.rt_secs > (best_rt_secs * early_term_factor) ) { break; } // clearly not the winner; stop early
+            min_eq( prc_ret.rt_secs, profile_rcg_call( i->anno_op, codegen, gen_data, 0, 1, 0 ).rt_secs );
+          }
+        }
+        catch( rt_exception const & rte ) { err << "profile call failure: " << rte.err_msg; }
+      }
+      if( err.str().empty() ) {
+        if( i == to.cands.begin() ) { vs_ref = vsi; }
+        else {
+          uint32_t num_mad_fail = 0;
+          comp_vars( &err, num_mad_fail, mrd_toler, 0, 0, max_err, get_keys( *vs_ref ), vs_ref, vsi );
+        }
+      }
+      codegen.clear();
+      // note: keep err to one line, as it goes into the wisdom file
+      string err_str = err.str();
+      std::replace( err_str.begin(), err_str.end(), '\n', ' ' );
+      i->otw->runs[plat_tag] = op_run_t{plat_tag,prc_ret.op,prc_ret.rt_secs,err_str};
+      if( err_str.empty() ) { min_eq( best_rt_secs, prc_ret.rt_secs ); }
+    }
+  }
+
+  void ops_autotune_t::main( nesi_init_arg_t * nia ) {
+    out = out_fn ? ofs_open( *out_fn ) : p_ostream( &std::cout, null_deleter<std::ostream>() );
+    p_ostream wout = ofs_open( wisdom_out_fn ); // open early to check for fn/fs errors
+    get_cur_time(); // timers aren't thread safe unless the clock is set up before other threads start (see timers.cc)
+    init_ops_bes( ops_bes, rtcs, rtcns, compile_opts, nia );
+    bool used_tmp_prog_cache = 0;
+    for( map_str_ops_be_t::iterator i = ops_bes.begin(); i != ops_bes.end(); ++i ) {
+      p_rtc_compute_t const & rtc = i->second.rtc;
+      if( rtc->enable_prog_cache ) { continue; } // use the backend's own cache (and leave it in place)
+      rtc->enable_prog_cache = 1;
+      rtc->prog_cache_dir = prog_cache_dir;
+      used_tmp_prog_cache = 1;
+    }
+
+    vect_p_op_tune_t op_tunes;
+    tune_space.get_op_tunes( op_tune, op_tunes );
+    p_istream ops = ifs_open( ops_fn );
+    string line;
+    for( uint32_t op_ix = 0; !ifs_getline( ops_fn.exp, ops, line ); op_ix++ ) {
+      tune_op_t to{ make_p_op_base_t_init_and_check_unused_from_lexp( parse_lexp( line ), 0 ) };
+      set< op_base_t > seen_anno_ops;
+      uint32_t num_unsup = 0;
+      for( vect_p_op_tune_t::const_iterator i = op_tunes.begin(); i != op_tunes.end(); ++i ) {
+        p_conv_op_base_t anno_op = make_shared<conv_op_base_t>( *to.op );
+        try { add_codegen_annotations( anno_op, **i, 0 ); }
+        catch( unsup_exception const & us_exp ) { ++num_unsup; continue; } // prune invalid points before compiling
+        if( !seen_anno_ops.insert( *anno_op ).second ) { continue; } // same code as an earlier candidate
+        to.cands.push_back( tune_cand_t{ anno_op, p_op_tune_wisdom_t( new op_tune_wisdom_t{*i} ) } );
+      }
+      (*out) << strprintf( "op_ix=%s type=%s: %s candidates (%s unsupported, %s duplicates)\n", str(op_ix).c_str(), 
+                           to.op->get_type().c_str(), str(to.cands.size()).c_str(), str(num_unsup).c_str(), 
+                           str(op_tunes.size() - num_unsup - to.cands.size()).c_str() );
+      if( to.cands.size() > 1 ) { tune_ops.push_back( to ); } // otherwise, nothing to tune
+    }
+
+    for( map_str_ops_be_t::iterator i = ops_bes.begin(); i != ops_bes.end(); ++i ) {
+      ops_be_t const & ops_be = i->second;
+      precompile( ops_be, nia );
+      timer_t t("ops_autotune_time_cands");
+      for( vect_tune_op_t::iterator j = tune_ops.begin(); j != tune_ops.end(); ++j ) { time_cands( ops_be, *j ); }
+    }
+
+    for( vect_tune_op_t::iterator i = tune_ops.begin(); i != tune_ops.end(); ++i ) {
+      op_wisdom_t op_wisdom{ i->op };
+      if( write_all_runs ) { 
+        for( vect_tune_cand_t::iterator j = i->cands.begin(); j != i->cands.end(); ++j ) { op_wisdom.wisdoms.push_back( j->otw ); }
+      }
+      by_op_tune_set_p_op_tune_wisdom_t winners; // merges runs of tunes that win on more than one backend
+      for( map_str_ops_be_t::iterator b = ops_bes.begin(); b != ops_bes.end(); ++b ) {
+        string const plat_tag = b->second.rtc->get_plat_tag();
+        tune_cand_t const * best = 0;
+        uint32_t num_errs = 0;
+        for( vect_tune_cand_t::iterator j = i->cands.begin(); j != i->cands.end(); ++j ) {
+          op_run_t const & r = must_find( j->otw->runs, plat_tag );
+          if( !r.err.empty() ) { ++num_errs; continue; }
+          if( (!best) || (r.rt_secs < must_find( best->otw->runs, plat_tag ).rt_secs) ) { best = &*j; }
+        }
+        (*out) << strprintf( "op=%s\n  be=%s: ", str(i->op).c_str(), b->first.c_str() );
+        if( !best ) { (*out) << "all candidates failed. first error: " << i->cands.front().otw->runs[plat_tag].err << "\n"; continue; }
+        op_run_t const & best_r = must_find( best->otw->runs, plat_tag );
+        op_run_t const & ref_r = must_find( i->cands.front().otw->runs, plat_tag );
+        (*out) << strprintf( "best op_tune=%s rt_secs=%s (ref rt_secs=%s, %s/%s candidates failed)\n", 
+                             str(best->otw->op_tune).c_str(), str(best_r.rt_secs).c_str(), str(ref_r.rt_secs).c_str(),
+                             str(num_errs).c_str(), str(i->cands.size()).c_str() );
+        winners.add_runs( vect_p_op_tune_wisdom_t{ p_op_tune_wisdom_t( new op_tune_wisdom_t{best->otw->op_tune, 
+                  map_str_op_run_t{{plat_tag,best_r}}} ) } );
+      }
+      if( !write_all_runs ) { op_wisdom.wisdoms.insert( op_wisdom.wisdoms.end(), winners.begin(), winners.end() ); }
+      write_op_wisdom( op_wisdom, *wout );
+    }
+    wout.reset(); // close, so that check_wisdom() can read it back
+    if( used_tmp_prog_cache ) { boost::filesystem::remove_all( prog_cache_dir.exp ); }
+    if( wisdom_check_fn ) { check_wisdom(); }
+  }
+
+  void ops_autotune_t::check_wisdom( void ) {
+    p_ostream cout = ofs_open( *wisdom_check_fn );
+    p_istream win = ifs_open( wisdom_out_fn );
+    uint32_t num_ops = 0;
+    for( p_op_wisdom_t owi; owi = read_next_wisdom( win ); ++num_ops ) {
+      (*cout) << strprintf( "op=%s\n", str(owi->op).c_str() );
+      for( map_str_ops_be_t::iterator b = ops_bes.begin(); b != ops_bes.end(); ++b ) {
+        string const plat_tag = b->second.rtc->get_plat_tag();
+        uint32_t num_runs = 0, num_ok = 0;
+        for( vect_p_op_tune_wisdom_t::const_iterator i = owi->wisdoms.begin(); i != owi->wisdoms.end(); ++i ) {
+          map_str_op_run_t::const_iterator ri = (*i)->runs.find( plat_tag );
+          if( ri == (*i)->runs.end() ) { continue; }
+          ++num_runs;
+          if( ri->second.err.empty() ) { ++num_ok; }
+        }
+        (*cout) << strprintf( "  be=%s: %s runs, %s error-free\n", b->first.c_str(), str(num_runs).c_str(), str(num_ok).c_str() );
+      }
+    }
+    (*cout) << strprintf( "num_ops=%s (%s tuned)\n", str(num_ops).c_str(), str(tune_ops.size()).c_str() );
+  }
+
   void add_to_with_prefix( vect_pair_str_str & out, vect_pair_str_str const & in, pair_str_str const & prefix ) {
     for( vect_pair_str_str::const_iterator i = in.begin(); i != in.end(); ++i ) {
       out.push_back( {prefix.first+i->first,prefix.second+i->second} );
@@ -410,13 +670,21 @@ namespace boda
                                              {"AMD4", // guess4 at tune for AMD/GCN
                                               "use_culibs=0,MNt=4:4,MNb=8:8"},
     };
+    // grouped convs don't support culibs, but have their own variant choice (dwconv) to test
+    vect_pair_str_str op_tune_grouped_bases = op_tune_conv_bases;
+    op_tune_grouped_bases.push_back( {"nodw","dwconv=0"} );
+    // wconv (winograd) only applies to 3x3 stride-1 (non-grouped) convs; others will run the non-wconv variants
+    op_tune_conv_bases.push_back( {"wconv-m2","wconv=1,wconv_m=2"} );
+    op_tune_conv_bases.push_back( {"wconv-m4","wconv=1,wconv_m=4"} );
     vect_pair_str_str op_tunes_sgemm;
     vect_pair_str_str op_tunes_conv;
+    vect_pair_str_str op_tunes_grouped;
     string kg_tune_tag;
     if( is_feature_enabled("opencl") ) { 
       if( kg_tune_tag.empty() ) { kg_tune_tag = "ocl-def"; }
       add_to_with_prefix( op_tunes_sgemm, op_tune_sgemm_bases, {"ocl-","use_be=ocl,"} );
       add_to_with_prefix( op_tunes_conv, op_tune_conv_bases, {"ocl-","use_be=ocl,"} );
+      add_to_with_prefix( op_tunes_grouped, op_tune_grouped_bases, {"ocl-","use_be=ocl,"} );
       // FIXME/NOTE: (some?) vector widths don't work with the nvrtc backend (only opencl) currently, due to syntax
       // issues / language support issues. revisit/investigate?
       op_tunes_conv.push_back( pair_str_str{"8-16-1-lm2-vm8",  // general tune for SD820 
@@ -427,13 +695,14 @@ namespace boda
       add_to_with_prefix( op_tunes_sgemm, op_tune_sgemm_bases, {"nvrtc-","use_be=nvrtc,"} );
       op_tunes_sgemm.push_back( {"culibs","use_be=nvrtc,use_culibs=1"} ); 
       add_to_with_prefix( op_tunes_conv, op_tune_conv_bases, {"nvrtc-","use_be=nvrtc,"} );
+      add_to_with_prefix( op_tunes_grouped, op_tune_grouped_bases, {"nvrtc-","use_be=nvrtc,"} );
       op_tunes_conv.push_back( {"culibs","use_be=nvrtc,use_culibs=1"} ); 
     }
     if( kg_tune_tag.empty() ) { 
       rt_err( "no known-good tune tag set; can't generate ops-prof test command lines. are no operation-level backends enabled? i.e. both OpenCL and nvrtc are disabled?" ); 
     }
     string cli_base = "boda ops-prof --out-fn='%(boda_output_dir)/cnn_op_info.txt' --kg-tune-tag=" + kg_tune_tag;
-    cli_base += " --func-mrd-toler='(cudnn_conv=4e-4)'"; // FIXME: should be 4e-4 for non-winograd cudnn_conv, but 2e-3 for winograd ones.
+    cli_base += " --func-mrd-toler='(cudnn_conv=4e-4,wconv=2e-3)'"; // FIXME: should be 4e-4 for non-winograd cudnn_conv, but 2e-3 for winograd ones.
     if( output_wisdom ) { cli_base += " --wisdom-out-fn='%(boda_output_dir)/wisdom.wis'"; }
     string const sgemm_ops = " --ops-fn='%(boda_test_dir)/sgemm-ops-debug.txt'";
     string const cnn_ops = " --ops-fn='%(boda_test_dir)/conv-ops-debug.txt'";
@@ -448,9 +717,12 @@ namespace boda
       run_bases_conv.push_back( {"conv-full-gen5", cli_base + " --ops-fn='%(boda_test_dir)/conv-ops-1-5-20-nin-alex-gn.txt'" +gen_data_mode_5});
     }
     run_bases_conv.push_back( {"conv-debug", cli_base + " --ops-fn='%(boda_test_dir)/conv-ops-debug-tmp.txt'" +gen_data_mode_5});
+    vect_pair_str_str run_bases_grouped; // grouped and depthwise convs
+    run_bases_grouped.push_back( {"conv-grouped-gen5", cli_base + " --ops-fn='%(boda_test_dir)/conv-ops-grouped.txt'" +gen_data_mode_5});
     (*out) << "<root>\n";
     emit_clis( out, run_bases_sgemm, op_tunes_sgemm );
     emit_clis( out, run_bases_conv, op_tunes_conv );
+    emit_clis( out, run_bases_grouped, op_tunes_grouped );
     (*out) << "</root>\n";                                
   }
 
@@ -10,10 +10,11 @@
 #include"img_io.H"
 #include"imagenet_util.H"
 #include"nesi.H" // for str(nesi)
+#include"lexp.H"
 
 namespace boda 
 {
-
+  p_has_conv_fwd_t make_p_has_conv_fwd_t_init_and_check_unused_from_lexp( p_lexp_t const & lexp, nesi_init_arg_t * const nia );
 
   // example test_compute command line for testing nvrtc:
   // time boda test_compute --model-name=nin_imagenet_nopad --wins-per-image=1 --imgs='(pil_fn=%(boda_test_dir)/pascal/head_1/%%s.txt)' --run-cnet='(in_dims=(img=256),ptt_fn=%(models_dir)/%(model_name)/train_val.prototxt,trained_fn=%(models_dir)/%(model_name)/best.caffemodel,out_node_name=pool4)' --use-nvrtc=1 --max-err=10 && cat test_compute.txt
@@ -40,10 +41,14 @@ namespace boda
     uint32_t tpd; //NESI(default="0",help="if non-zero, use test-pattern data. 1 == const, 2 == const + x co-ord")
     u32_pt_t tpd_in_sz; //NESI(default="15 15",help="x,y size of test-pattern data to use")
     double tpd_const; //NESI(default="1.0",help="test-pattern data constant offset")
+    vect_u32_pt_t tpd_rebind_in_szs; //NESI(default="()",help="with tpd, after the first batch, for each x,y size here: re-bind the net and all compute backends to that input size (without re-init) and test another batch")
+    uint32_t tpd_rebind_cmp_fresh; //NESI(default="1",help="with tpd_rebind_in_szs, after each re-bind, also compare every backend against a new instance of the first backend, initialized (not re-bound) on a new pipe with the same input size")
+    uint32_t tpd_pipe_batches; //NESI(default="0",help="with tpd, if non-zero, after the first batch, run this many more batches (each with a different tpd_const) and test each. the first backend runs them one at a time with run_fwd() as a reference; the others run them using run_fwd_begin()/run_fwd_end() with two batches in flight")
 
     uint32_t diff_show_mrd_only; //NESI(default="0",help="if 1, print only MAD for diffs, not full sds_diff_t. usefull for making test outputs for 'pseudo-failure' consistent (such as quantization tests where specific numerical errors are expected.")
     double mrd_toler; //NESI(default="5e-4",help="maximum maximum-absolute-difference over which a failure is declared")
     map_str_double var_mrd_toler; //NESI(default="()",help="per-layer custom maximum maximum-absolute-differences over which a failure is declared (overrides mrd_toler per-layer if specified")
+    map_str_double cf_mrd_toler; //NESI(default="()",help="per-backend (by cfn name) custom maximum maximum-absolute-differences over which a failure is declared (overrides mrd_toler for that backend if specified). useful for reduced-precision backends (i.e. rtc with storage_tn=half). var_mrd_toler still takes precedence.")
 
     uint32_t max_err; //NESI(default="10",help="print at most this many differing elems")
 
@@ -103,6 +108,16 @@ namespace boda
       if( tpd ) {
 	make_tpd_batch( run_cnet->in_batch );
 	comp_batch();
+	if( tpd_pipe_batches ) { comp_pipe_batches(); }
+	for( vect_u32_pt_t::const_iterator sz = tpd_rebind_in_szs.begin(); sz != tpd_rebind_in_szs.end(); ++sz ) {
+	  map_str_uint32_t in_dims = run_cnet->in_dims;
+	  in_dims["y"] = sz->d[1]; in_dims["x"] = sz->d[0];
+	  run_cnet->rebind_in_dims( in_dims );
+	  for( uint32_t i = 0; i != num_cf; ++i ) { cf[i]->rebind( run_cnet->conv_pipe ); }
+	  make_tpd_batch( run_cnet->in_batch );
+	  vect_p_map_str_p_nda_float_t const fwd = comp_batch();
+	  if( tpd_rebind_cmp_fresh ) { comp_fresh( in_dims, fwd, nia ); }
+	}
       } else {
 	for( vect_p_img_info_t::const_iterator i = imgs->img_db->img_infos.begin(); i != imgs->img_db->img_infos.end(); ++i ) {
 	  for( uint32_t cf = 0; cf != num_cf; ++cf ) { (*outs[cf]) << strprintf( "(*i)->sz=%s\n", str((*i)->img->sz).c_str() ); }
@@ -156,7 +171,7 @@ namespace boda
 	subtract_mean_and_copy_img_to_batch( run_cnet->in_batch, i, in_img );
       }
     }
-    void comp_batch( void ) {
+    vect_p_map_str_p_nda_float_t comp_batch( void ) {
       uint32_t const num_cf = cf.size();
       vect_p_map_str_p_nda_float_t fwd;
       vect_vect_string to_set_vns;
@@ -171,15 +186,63 @@ namespace boda
         run_cnet->conv_pipe->run_setup_input( run_cnet->in_batch, fwd[i], to_set_vns[i] );
         cf[i]->run_fwd( to_set_vns[i], fwd[i], tops );
       }
+      comp_fwd( fwd );
+      return fwd;
+    }
+    // compare the results of the current batch (fwd, as returned by comp_batch()) from each (re-bound) backend against
+    // those of a new instance of the first backend, initialized on a new pipe with the given in_dims.
+    void comp_fresh( map_str_uint32_t const & in_dims, vect_p_map_str_p_nda_float_t const & fwd, nesi_init_arg_t * const nia ) {
+      p_conv_pipe_t const fresh_cp = run_cnet->create_pipe_sharing_blobs( in_dims );
+      p_has_conv_fwd_t const fresh_cf = make_p_has_conv_fwd_t_init_and_check_unused_from_lexp( parse_lexp( str(cf[0]) ), nia );
+      fresh_cf->init( fresh_cp, nia );
+      p_map_str_p_nda_float_t const fresh_fwd = make_shared<map_str_p_nda_float_t>();
+      vect_string to_set_vns;
+      fresh_cp->run_setup_input( run_cnet->in_batch, fresh_fwd, to_set_vns );
+      fresh_cf->run_fwd( to_set_vns, fresh_fwd, tops );
+      for( uint32_t i = 0; i != cf.size(); ++i ) {
+        (*outs[i]) << strprintf( "vars_to_compare (vs. new '%s' on new pipe): %s\n", cfn[0].c_str(), str(tops).c_str() );
+	comp_vars( outs[i].get(), num_mad_fails[i], get( cf_mrd_toler, cfn[i], mrd_toler ), &var_mrd_toler,
+		   diff_show_mrd_only, max_err, tops, fresh_fwd, fwd[i] );
+      }
+    }
+    // run tpd_pipe_batches batches on each backend (keeping two in flight on all but the first), then compare each batch
+    // as per comp_batch()
+    void comp_pipe_batches( void ) {
+      uint32_t const num_cf = cf.size();
+      double const orig_tpd_const = tpd_const;
+      vect_p_nda_float_t in_batches;
+      for( uint32_t b = 0; b != tpd_pipe_batches; ++b ) {
+	in_batches.push_back( make_shared< nda_float_t >( run_cnet->in_batch->dims ) );
+	tpd_const = orig_tpd_const + b + 1;
+	make_tpd_batch( in_batches.back() );
+      }
+      tpd_const = orig_tpd_const;
+      vector< vect_p_map_str_p_nda_float_t > fwds( tpd_pipe_batches ); // indexed by batch, then backend
+      for( uint32_t i = 0; i != num_cf; ++i ) { 
+	uint32_t num_pend = 0;
+	for( uint32_t b = 0; b != tpd_pipe_batches; ++b ) {
+	  if( num_pend == 2 ) { cf[i]->run_fwd_end(); --num_pend; }
+	  fwds[b].push_back( make_shared<map_str_p_nda_float_t>() ); 
+	  vect_string to_set_vns;
+	  run_cnet->conv_pipe->run_setup_input( in_batches[b], fwds[b][i], to_set_vns );
+	  if( !i ) { cf[i]->run_fwd( to_set_vns, fwds[b][i], tops ); continue; }
+	  cf[i]->run_fwd_begin( to_set_vns, fwds[b][i], tops );
+	  ++num_pend;
+	}
+	for( ; num_pend; --num_pend ) { cf[i]->run_fwd_end(); }
+      }
+      for( uint32_t b = 0; b != tpd_pipe_batches; ++b ) { comp_fwd( fwds[b] ); }
+    }
+    void comp_fwd( vect_p_map_str_p_nda_float_t const & fwd ) {
+      uint32_t const num_cf = cf.size();
       for( uint32_t i = 0; i < num_cf; ++i ) {  // compare cf[0] against others (i.e. cf[1:])
         (*outs[i]) << strprintf( "vars_to_compare: %s\n", str(tops).c_str() );
 	comp_vars( outs[i].get(), num_mad_fails[i],
-		   mrd_toler, &var_mrd_toler,
+		   get( cf_mrd_toler, cfn[i], mrd_toler ), &var_mrd_toler,
 		   diff_show_mrd_only, max_err, 
 		   tops, fwd[0], fwd[i] );
       }
       for( vect_string::const_iterator tn = tops.begin(); tn != tops.end(); ++tn ) {
-        double vmt = get( var_mrd_toler, *tn, mrd_toler );
         size_t const digest_seed = std::hash<string>()(*tn);
         vect_p_nda_digest_t digest;
 	p_nda_digest_t kg_digest;
@@ -200,6 +263,7 @@ namespace boda
             bwrite( *digest_outs[i], digest[i] ); 
           }
           if( kg_digest ) {
+            double const vmt = get( var_mrd_toler, *tn, get( cf_mrd_toler, cfn[i], mrd_toler ) );
             string const comp_res = kg_digest->mrd_comp( digest[i], vmt );
             if( !comp_res.empty() ) { (*outs[i]) << (*tn) + " digest mrd_comp() failure '"+kg_digests_fn->in+"' vs '"+cfn[i]+"':\n" + comp_res + "\n";}
           } else {
@@ -232,6 +296,7 @@ namespace boda
     if( is_feature_enabled("caffe") ) { run_cfgs.push_back( {"caffe","mode=caffe"} ); }
     if( is_feature_enabled("nvrtc") ) { run_cfgs.push_back( {"rtc_nvrtc","mode=rtc,rtc=(be=nvrtc)"} ); }
     if( is_feature_enabled("opencl") ) { run_cfgs.push_back( {"rtc_ocl","mode=rtc,rtc=(be=ocl)"} ); }
+    if( is_feature_enabled("cpu_rtc") ) { run_cfgs.push_back( {"rtc_cpu","mode=rtc,rtc=(be=cpu)"} ); }
 
     string const rtc_opt = ",op_tune=(k1conv=1,tconv=1),enable_write_xpose=1"; // for rtc mode; orig. tests only for rtc+nvrtc submode
     string const rtc_bconv = ",enable_bconv=1"; // for rtc mode, enables optimized bck ops
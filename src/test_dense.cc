@@ -11,6 +11,7 @@
 #include"rand_util.H"
 #include"timers.H"
 #include"imagenet_util.H"
+#include"nesi.H" // for str(nesi)
 
 namespace boda 
 {
@@ -238,7 +239,198 @@ namespace boda
     }
   };
 
+  struct test_tiled_t : virtual public nesi, public has_main_t // NESI( help="test tiled vs. untiled net runs",
+			// bases=["has_main_t"], type_id="test_tiled")
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    filename_t out_fn; //NESI(default="%(boda_output_dir)/test_tiled.txt",help="output: text summary of differences between tiled and untiled net outputs.")
+    p_run_cnet_t run_cnet; //NESI(default="(in_dims=(img=1,y=227,x=227),out_node_name=cccp8)",help="CNN model params (untiled)")
+    p_run_cnet_t run_cnet_tiled; //NESI(default="(in_dims=(img=1,y=227,x=227),out_node_name=cccp8,tile_out_sz=4:4)",help="CNN model params (tiled)")
+    uint32_t num_runs; //NESI(default="2",help="number of random inputs to test")
+    p_double mrd_toler; //NESI(help="maximum maximum-relative-difference over which a failure is declared. if not set, 0 if both nets use the same conv_fwd mode (tiles then run the same kernels as the untiled net, so outputs must match exactly), else 1e-5 (to allow for rounding).")
+
+    uint32_t num_mad_fail;
+    
+    p_ostream out;
+    virtual void main( nesi_init_arg_t * nia ) {
+      out = ofs_open( out_fn.exp );
+      run_cnet->setup_cnet( nia ); 
+      run_cnet_tiled->setup_cnet( nia );
+      if( !run_cnet_tiled->is_tiled() ) { rt_err( "run_cnet_tiled must set tile_out_sz" ); }
+      double const toler = mrd_toler ? *mrd_toler : ( (str(run_cnet->conv_fwd) == str(run_cnet_tiled->conv_fwd)) ? 0.0 : 1e-5 );
+
+      boost::random::mt19937 gen;
+      boost::random::uniform_real_distribution<float> dist( -128.0f, 128.0f );
+      num_mad_fail = 0;
+      for( uint32_t rix = 0; rix != num_runs; ++rix ) {
+	p_nda_float_t const & in_batch = run_cnet->in_batch;
+	for( uint32_t i = 0; i != in_batch->elems_sz(); ++i ) { in_batch->elems_ptr()[i] = dist(gen); }
+	run_cnet_tiled->in_batch->copy_elems_with_reshape( *in_batch );
+	p_nda_float_t out_batch;
+	{
+	  timer_t t1("untiled_cnn");
+	  out_batch = run_cnet->run_one_blob_in_one_blob_out();
+	}
+	p_nda_float_t out_batch_tiled;
+	{
+	  timer_t t1("tiled_cnn");
+	  out_batch_tiled = run_cnet_tiled->run_one_blob_in_one_blob_out();
+	}
+	assert_st( out_batch->dims == out_batch_tiled->dims );
+	ssds_diff_t const ssds_diff(out_batch,out_batch_tiled);
+	if( (ssds_diff.mrd > toler) || ssds_diff.has_nan() ) { 
+	  ++num_mad_fail; 
+	  (*out) << strprintf( "ssds_diff_t(out_batch,out_batch_tiled)=%s\n", str(ssds_diff).c_str() );
+	}
+      }
+      if( !num_mad_fail ) { (*out) << strprintf( "***ALL IS WELL***\n" ); }
+      else { (*out) << strprintf( "***MAD FAILS*** num_mad_fail=%s\n", str(num_mad_fail).c_str() ); }
+      out.reset();
+    }
+  };
+
+  struct test_incr_t : virtual public nesi, public has_main_t // NESI( help="test incremental vs. full net runs on a sequence of partly-changing inputs",
+			// bases=["has_main_t"], type_id="test_incr")
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    filename_t out_fn; //NESI(default="%(boda_output_dir)/test_incr.txt",help="output: text summary of differences between incremental and full net outputs.")
+    p_run_cnet_t run_cnet; //NESI(default="(in_dims=(img=1,y=739,x=739),out_node_name=cccp8)",help="CNN model params (full)")
+    p_run_cnet_t run_cnet_incr; //NESI(default="(in_dims=(img=1,y=739,x=739),out_node_name=cccp8,incr_out_blk_sz=4:4,incr_tile_out_sz=8:8)",help="CNN model params (incremental). note: the input must be large compared to the net's support for tiles to be cheaper than full runs.")
+    uint32_t num_runs; //NESI(default="8",help="number of inputs in sequence to test")
+    uint32_t max_change_sz; //NESI(default="8",help="max size of (random) box of input to change between runs")
+    double mrd_toler; //NESI(default="1e-5",help="maximum maximum-relative-difference over which a failure is declared (recomputed blocks may use different kernel variants than the full net, so allow for rounding)")
+
+    uint32_t num_mad_fail;
+    
+    p_ostream out;
+    virtual void main( nesi_init_arg_t * nia ) {
+      out = ofs_open( out_fn.exp );
+      run_cnet->setup_cnet( nia ); 
+      run_cnet_incr->setup_cnet( nia );
+      if( !run_cnet_incr->is_incr() ) { rt_err( "run_cnet_incr must set incr_out_blk_sz" ); }
+
+      boost::random::mt19937 gen;
+      boost::random::uniform_real_distribution<float> dist( -128.0f, 128.0f );
+      p_nda_float_t const & in_batch = run_cnet->in_batch;
+      u32_pt_t const in_sz = get_xy_dims( in_batch->dims );
+      for( uint32_t i = 0; i != in_batch->elems_sz(); ++i ) { in_batch->elems_ptr()[i] = dist(gen); }
+      num_mad_fail = 0;
+      for( uint32_t rix = 0; rix != num_runs; ++rix ) {
+	if( rix ) { // change a random box of the input (which, for the last run, is the entire input)
+	  u32_box_t change_box{ {}, in_sz };
+	  if( (rix + 1) != num_runs ) { 
+	    change_box.p[1] = min( random_pt( u32_pt_t( max_change_sz, max_change_sz ), gen ) + u32_pt_t(1,1), in_sz );
+	    change_box += random_pt( in_sz - change_box.p[1], gen );
+	  }
+	  dims_t const & id = in_batch->dims;
+	  for( uint32_t ic = 0; ic != id.dsz("img")*id.dsz("chan"); ++ic ) {
+	    for( uint32_t y = change_box.p[0].d[1]; y != change_box.p[1].d[1]; ++y ) {
+	      for( uint32_t x = change_box.p[0].d[0]; x != change_box.p[1].d[0]; ++x ) {
+		in_batch->elems_ptr()[ic*id.dstride("chan") + y*id.dstride("y") + x*id.dstride("x")] = dist(gen);
+	      }
+	    }
+	  }
+	  (*out) << strprintf( "change_box=%s\n", str(change_box).c_str() );
+	}
+	run_cnet_incr->in_batch->copy_elems_with_reshape( *in_batch );
+	p_nda_float_t out_batch;
+	{
+	  timer_t t1("full_cnn");
+	  out_batch = run_cnet->run_one_blob_in_one_blob_out();
+	}
+	p_nda_float_t out_batch_incr;
+	{
+	  timer_t t1("incr_cnn");
+	  out_batch_incr = run_cnet_incr->run_one_blob_in_one_blob_out();
+	}
+	assert_st( out_batch->dims == out_batch_incr->dims );
+	ssds_diff_t const ssds_diff(out_batch,out_batch_incr);
+	if( (ssds_diff.mrd > mrd_toler) || ssds_diff.has_nan() ) { 
+	  ++num_mad_fail; 
+	  (*out) << strprintf( "ssds_diff_t(out_batch,out_batch_incr)=%s\n", str(ssds_diff).c_str() );
+	}
+      }
+      // check that the incremental runs actually did less work than the full ones. note that the first and last runs
+      // are full ones in both cases.
+      uint64_t const full_in_pels = uint64_t( num_runs ) * in_sz.dims_prod();
+      uint64_t const incr_in_pels = run_cnet_incr->incr_in_pels;
+      (*out) << strprintf( "full_in_pels=%s incr_in_pels=%s\n", str(full_in_pels).c_str(), str(incr_in_pels).c_str() );
+      bool const incr_cheaper = incr_in_pels < full_in_pels;
+      if( !incr_cheaper ) { (*out) << strprintf( "***INCR NOT CHEAPER***\n" ); }
+      if( num_mad_fail ) { (*out) << strprintf( "***MAD FAILS*** num_mad_fail=%s\n", str(num_mad_fail).c_str() ); }
+      if( !num_mad_fail && incr_cheaper ) { (*out) << strprintf( "***ALL IS WELL***\n" ); }
+      out.reset();
+    }
+  };
+
 
+  struct test_yuyv_to_batch_t : virtual public nesi, public has_main_t // NESI( help="test fused YUYV-to-input-batch conversion vs. the unfused (via images) path",
+			// bases=["has_main_t"], type_id="test_yuyv_to_batch")
+  {
+    virtual cinfo_t const * get_cinfo( void ) const; // required declaration for NESI support
+    filename_t out_fn; //NESI(default="%(boda_output_dir)/test_yuyv_to_batch.txt",help="output: text summary of differences between fused and unfused conversions.")
+    u32_pt_t yuyv_sz; //NESI(default="640 480",help="size of (synthetic) YUYV input frames; x must be even")
+    u32_pt_t in_sz; //NESI(default="227 227",help="size of input batch images (frames are resampled to this size)")
+    uint32_t num_runs; //NESI(default="4",help="number of random input frames to test")
+    double max_err; //NESI(default="2.0",help="maximum absolute difference over which a failure is declared (the unfused path rounds to u8 after the YUYV conversion and after each resampling step, but the fused path doesn't, so allow for some difference)")
+
+    uint32_t num_mad_fail;
+
+    p_ostream out;
+    virtual void main( nesi_init_arg_t * nia ) {
+      out = ofs_open( out_fn.exp );
+      if( yuyv_sz.d[0] & 1 ) { rt_err( "yuyv_sz x must be even" ); }
+      dims_t const in_batch_dims( vect_uint32_t{ 1, 3, in_sz.d[1], in_sz.d[0] }, vect_string{ "img", "chan", "y", "x" }, 
+				  "float" );
+      p_nda_float_t in_batch( new nda_float_t( in_batch_dims ) );
+      p_nda_float_t in_batch_fused( new nda_float_t( in_batch_dims ) );
+      vect_uint8_t yuyv( yuyv_sz.d[0]*yuyv_sz.d[1]*2 );
+      p_img_t img = make_p_img_t( yuyv_sz );
+
+      boost::random::mt19937 gen;
+      boost::random::uniform_real_distribution<float> dist( 0.0f, 1.0f );
+      num_mad_fail = 0;
+      for( uint32_t rix = 0; rix != num_runs; ++rix ) {
+	// make a smooth-ish random frame (so the different resampling filters mostly agree), with the full range of
+	// values (so clipping is exercised)
+	float fx[3], fy[3], ph[3];
+	for( uint32_t i = 0; i != 3; ++i ) { fx[i] = dist(gen)*0.05f; fy[i] = dist(gen)*0.05f; ph[i] = dist(gen)*6.0f; }
+	for( uint32_t y = 0; y != yuyv_sz.d[1]; ++y ) {
+	  for( uint32_t x = 0; x != yuyv_sz.d[0]; ++x ) {
+	    uint8_t * const p = &yuyv[(y*yuyv_sz.d[0]+x)*2];
+	    p[0] = clip_to_u8( 128.0f + 150.0f*sin( fx[0]*x + fy[0]*y + ph[0] ) ); // y
+	    uint32_t const cix = 1 + (x & 1); // u for even x, v for odd x
+	    p[1] = clip_to_u8( 128.0f + 150.0f*sin( fx[cix]*(x&~1U) + fy[cix]*y + ph[cix] ) );
+	  }
+	}
+	{
+	  timer_t t1("unfused_yuyv_to_batch");
+	  // convert to image (as capture_t::process_image() does), resample, and copy to batch
+#pragma omp parallel for
+	  for( uint32_t y = 0; y < yuyv_sz.d[1]; ++y ) {
+	    for( uint32_t x = 0; x != yuyv_sz.d[0]; x += 2 ) {
+	      uint8_t const * const p = &yuyv[(y*yuyv_sz.d[0]+x)*2];
+	      img->set_pel( {x+0, y}, yuva2rgba(p[0],p[1],p[3]) );
+	      img->set_pel( {x+1, y}, yuva2rgba(p[2],p[1],p[3]) );
+	    }
+	  }
+	  subtract_mean_and_copy_img_to_batch( in_batch, 0, resample_to_size( img, in_sz ) );
+	}
+	{
+	  timer_t t1("fused_yuyv_to_batch");
+	  yuyv_resample_subtract_mean_to_batch( in_batch_fused, 0, &yuyv[0], yuyv_sz );
+	}
+	ssds_diff_t const ssds_diff(in_batch,in_batch_fused);
+	if( (ssds_diff.mad > max_err) || ssds_diff.has_nan() ) { 
+	  ++num_mad_fail; 
+	  (*out) << strprintf( "ssds_diff_t(in_batch,in_batch_fused)=%s\n", str(ssds_diff).c_str() );
+	}
+      }
+      if( !num_mad_fail ) { (*out) << strprintf( "***ALL IS WELL***\n" ); }
+      else { (*out) << strprintf( "***MAD FAILS*** num_mad_fail=%s\n", str(num_mad_fail).c_str() ); }
+      out.reset();
+    }
+  };
   
 #include"gen/test_dense.cc.nesi_gen.cc"
   
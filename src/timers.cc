@@ -125,5 +125,9 @@ namespace boda
   }
   uint64_t timer_t::cur( void ) const { return get_cur_time() - bt; }
   timer_t::~timer_t( void ) { if( !ended ) { stop(); } } 
+  void log_timer_since( std::string const & tag, uint64_t const bt ) { 
+    timer_t t( tag ); 
+    if( bt < t.bt ) { t.bt = bt; } // note: guard against bt in the (very near) future, i.e. from a racing thread
+  }
 
 }